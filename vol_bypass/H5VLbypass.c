@@ -28,17 +28,40 @@
 
 /* Header files needed */
 /* Do NOT include private HDF5 files here! */
+
+/* For sync_file_range() and fallocate() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <assert.h>
+#include <dirent.h>
+#include <dlfcn.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYPASS_SIMD_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BYPASS_SIMD_NEON
+#endif
 
 /* Public HDF5 headers */
 #include "hdf5.h"
@@ -72,6 +95,21 @@ typedef struct H5VL_bypass_wrap_ctx_t {
     void *under_wrap_ctx; /* Object wrapping context for under VOL */
 } H5VL_bypass_wrap_ctx_t;
 
+/* A regular hyperslab (or "all") selection flattened into its per-dimension
+ * start/stride/count/block, so that the selection falling into each chunk can be
+ * computed without creating dataspaces */
+typedef struct hyper_box_t {
+    int     rank;
+    hsize_t dims[DIM_RANK_MAX];      /* Extent of the dataspace */
+    hsize_t start[DIM_RANK_MAX];
+    hsize_t stride[DIM_RANK_MAX];
+    hsize_t count[DIM_RANK_MAX];
+    hsize_t block[DIM_RANK_MAX];
+    hsize_t sel_pitch[DIM_RANK_MAX]; /* Number of selected elements spanned by one step in each dimension */
+    hsize_t pitch[DIM_RANK_MAX];     /* Number of elements of the extent spanned by one step in each dimension */
+    hsize_t npoints;                 /* Total number of selected elements */
+} hyper_box_t;
+
 /* Struct to store info for chunk iteration.*/
 typedef struct chunk_cb_info_t {
     hid_t file_space;
@@ -81,11 +119,36 @@ typedef struct chunk_cb_info_t {
     H5S_sel_type select_type;
     hsize_t dset_dims[DIM_RANK_MAX];
     hsize_t chunk_dims[DIM_RANK_MAX]; // TBD: Assumes chunk dims are treated as constant even for edge chunks
+    hsize_t chunk_pitch[DIM_RANK_MAX]; /* Number of elements in a chunk spanned by one step in each dimension */
+    bool use_boxes;                    /* Both selections are regular: map chunks with the box engine */
+    hyper_box_t file_box;
+    hyper_box_t mem_box;
     sel_info_t *selection_info;
     void *rbuf;
     task_queue_t *task_queue;
+    const filter_info_t *filters;      /* Filter pipeline of the dataset, if any */
+    int nfilters;
+    size_t chunk_nbytes;               /* Size of a chunk once its filters are undone */
+    const void *chunk_data;            /* If set, the decoded chunk the selected data is copied from instead of read */
+    void *chunk_out;                   /* If set, the chunk being encoded the selected data is copied into instead of written */
+    bool fill_chunk;                   /* The chunk isn't allocated: its selection is set to the fill value */
 } chunk_cb_info_t;
 
+/* The chunks touched by a selection, collected during chunk iteration so that the thread pool
+ * can translate them into I/O in parallel */
+typedef struct chunk_xlate_t {
+    chunk_cb_info_t cb_info;          /* Selection boxes and chunk geometry, copied by each partition */
+    sel_info_t      selection_info;   /* Copy of the caller's info, which is reset for the next dataset */
+    hsize_t        *chunk_offsets;    /* 'dset_dim_rank' offsets per chunk */
+    haddr_t        *chunk_addrs;
+    hsize_t        *chunk_sizes;      /* Stored sizes and filter masks, only kept for filtered chunks */
+    unsigned       *filter_masks;
+    void          **encoded;          /* Chunks encoded for a write, handed to the library once they're all done */
+    size_t          nchunks;
+    size_t          nalloc;
+    atomic_int      ref_count;        /* Number of partitions not finished yet */
+} chunk_xlate_t;
+
 /********************* */
 /* Function prototypes */
 /********************* */
@@ -239,8 +302,34 @@ static herr_t H5VL_bypass_token_from_str(void *obj, H5I_type_t obj_type, const c
 /* Generic optional callback */
 static herr_t H5VL_bypass_optional(void *obj, H5VL_optional_args_t *args, hid_t dxpl_id, void **req);
 
-/* Flush the file containing the provided dataset */
-static herr_t flush_containing_file(H5VL_bypass_t *file);
+/* Record that the library may hold data written to a dataset in its caches */
+static herr_t mark_dirty_range(H5VL_bypass_t *dset_obj, haddr_t start, haddr_t end);
+
+/* Whether a read of a dataset, stored at [addr, addr + size) if contiguous, needs the library to flush first */
+static bool dirty_range_hit(H5VL_bypass_t *dset_obj, haddr_t addr, hsize_t size);
+
+/* Flush the datasets whose dirty ranges a read of a dataset overlaps, and forget the ranges */
+static herr_t flush_dirty_ranges(H5VL_bypass_t *dset_obj, haddr_t addr, hsize_t size, hid_t dxpl_id, void **req);
+
+/* Forget the dirty range of a dataset being closed, which the library flushes */
+static void forget_dirty_range(H5VL_bypass_t *dset_obj);
+
+/* Make the data written to a file durable, sharing the sync with the other writers waiting for it */
+static herr_t sync_file_data(Bypass_file_t *file);
+
+/* Start writing back data just written, so the next sync has less left to do */
+static void start_writeback(int fd, haddr_t addr, size_t len);
+
+/* Preallocate the storage of a contiguous dataset in the file before the first large write */
+static void preallocate_dset(H5VL_bypass_t *dset_obj, haddr_t addr);
+
+/* Follow the selections read from a dataset and prefetch the next one once they move by a steady step */
+static void track_read_pattern(H5VL_bypass_t *dset_obj, const Bypass_dset_snapshot_t *snapshot,
+                               const hsize_t *start, const hsize_t *end);
+
+/* Ask the system to read ahead the storage of a box of a dataset, within "BYPASS_VOL_PREFETCH" */
+static void prefetch_box(Bypass_file_t *file, const Bypass_dset_snapshot_t *snapshot, const hsize_t *start,
+                         const hsize_t *end);
 
 /* Populate the dataset structure on the bypass object */
 static herr_t dset_open_helper(H5VL_bypass_t *obj, hid_t dxpl_id, void **req);
@@ -251,6 +340,24 @@ static herr_t release_dset_info(Bypass_dataset_t *dset);
 /* Release the structures associated with the file object */
 static herr_t release_file_info(Bypass_file_t *file);
 
+/* Find the record of a file shared by all its handles, adding it for the first one */
+static herr_t attach_shared_file(Bypass_file_t *file);
+
+/* Let go the record of a file, removed with its last handle */
+static void detach_shared_file(Bypass_file_t *file);
+
+/* Unlink and free the record of a file.  Called with shared_files_mutex. */
+static void free_shared_file(Bypass_shared_file_t *shared);
+
+/* Find the record of a dataset shared by all its handles, adding it for the first one */
+static herr_t attach_dset_object(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req);
+
+/* Let go the record of a dataset, removed with its last handle */
+static void detach_dset_object(Bypass_dataset_t *dset);
+
+/* Drop a reference to the record of a dataset, removing it with the last one */
+static void put_dset_object(Bypass_shared_file_t *shared, Bypass_object_t *object);
+
 /* Release the structures associated with the group object */
 static herr_t release_group_info(Bypass_group_t *group);
 
@@ -263,6 +370,15 @@ static herr_t should_dset_use_native(Bypass_dataset_t *dset, bool read_data);
 /* Compare two datatype instances for equivalence*/
 static bool bypass_types_equal(dtype_info_t *type_info1, dtype_info_t *type_info2);
 
+/* Check if two datatypes differ only in byte order, so the data can be swapped in place */
+static bool bypass_types_swapped(dtype_info_t *type_info1, dtype_info_t *type_info2);
+
+/* Find the function converting the numbers of a datatype in the file to one in memory, if any */
+static conv_func_t get_conv_func(dtype_info_t *file_type_info, dtype_info_t *mem_type_info, bool *swapped);
+
+/* Describe the native types the conversion functions go between, once when the connector starts */
+static herr_t init_conv_types(void);
+
 /* Retrieve and store datatype information on a dataset object */
 static herr_t get_dtype_info(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req);
 
@@ -279,6 +395,293 @@ static Bypass_task_t * bypass_queue_pop(task_queue_t *queue, bool need_mutex);
 static Bypass_task_t * bypass_task_create(sel_info_t *sel_info, haddr_t addr, size_t io_len, void *buf);
 static herr_t bypass_task_release(Bypass_task_t *task);
 
+/* Create a task for one piece of I/O and put it into the queue */
+static herr_t submit_io_task(task_queue_t *task_queue, sel_info_t *selection_info, haddr_t addr, size_t io_len,
+                             void *buf, int *local_count_for_signal);
+
+/* Put a task into the queue, signaling the thread pool every nsteps_tpool tasks */
+static herr_t push_io_task(task_queue_t *task_queue, Bypass_task_t *task, int *local_count_for_signal);
+
+/* Copy the data of a task writing behind into a staging buffer, within the cap of "BYPASS_VOL_WRITE_BEHIND" */
+static herr_t stage_write_behind(Bypass_task_t *task);
+
+/* Give back the space of a staging buffer freed by a task writing behind */
+static void release_write_behind_space(size_t size);
+
+/* Wait for the writes done behind to a dataset to finish and report their failures */
+static herr_t wait_write_behind(Bypass_object_t *object);
+
+/* Wait for the writes done behind to the datasets of a file, or of all the files if it's NULL */
+static herr_t wait_file_write_behind(Bypass_shared_file_t *shared);
+
+/* Wait for the writes done behind if the selection of a new write overlaps the pending ones of the dataset */
+static herr_t order_write_behind(Bypass_dataset_t *dset, hid_t file_space_id);
+
+/* Copy a small write into the aggregation buffer of its file, writing out what was there first if it doesn't follow */
+static herr_t aggregate_write(H5VL_bypass_t *file, haddr_t addr, const void *buf, size_t len);
+
+/* Write out the aggregation buffer of a file, all of it or only up to the last WRITE_AGG_ALIGN boundary.
+ * Called with the file's agg_mutex. */
+static herr_t drain_write_agg(Bypass_file_t *file, bool keep_tail);
+
+/* Write out the aggregation buffers of the handles of a file holding any of the bytes of a write not
+ * aggregated, or of a write aggregated by another handle */
+static herr_t order_write_agg(H5VL_bypass_t *file, haddr_t addr, size_t len, bool others_only);
+
+/* Write out the aggregation buffers of all the handles of a file */
+static herr_t flush_write_agg(H5VL_bypass_t *file);
+
+/* Write out the aggregation buffers of all the files, for reads and for the library */
+static herr_t flush_all_write_agg(void);
+
+/* Queue tasks setting 'nbytes' bytes of memory to the fill value of the selection */
+static herr_t submit_fill_run(task_queue_t *task_queue, sel_info_t *selection_info, void *buf, size_t nbytes,
+                              int *local_count_for_signal);
+
+/* Queue tasks setting the whole memory selection to the fill value, for datasets with no storage */
+static herr_t submit_fill_selection(task_queue_t *task_queue, void *buf, hid_t mem_space_id,
+                                    sel_info_t *selection_info);
+
+/* Repeat a value of 'size' bytes over a buffer */
+static void fill_pattern(void *buf, size_t nbytes, const void *value, size_t size);
+
+/* Find whether the storage of a dataset not allocated yet reads as the fill value, and get the value
+ * in the memory datatype */
+static herr_t get_read_fill_value(Bypass_dataset_t *dset, hid_t mem_type_id, sel_info_t *selection_info);
+
+/* Find the prefix of the names of the external files or the source files of a dataset.  Returns
+ * false if it's too long. */
+static htri_t get_file_prefix(H5VL_bypass_t *dset_obj, bool vds_prefix, char *prefix, size_t size, hid_t dxpl_id,
+                              void **req);
+
+/* Copy the directory part of a file name, "." if it has none */
+static void get_file_dir(const char *file_name, char *dir, size_t size);
+
+/* Put a prefix in front of a relative file name */
+static void combine_file_path(const char *prefix, const char *name, char *path, size_t size);
+
+/* Open the external files holding the raw data of a dataset (H5Pset_external), unless it's done.
+ * Returns false if some file can't be opened, for the library to read the data and report it. */
+static htri_t open_external_files(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req);
+
+/* Close the external files of a dataset */
+static void close_external_files(Bypass_dataset_t *dset);
+
+/* Queue the tasks of a piece of I/O in the external files, split at the boundaries of the segments */
+static herr_t submit_external_io(task_queue_t *task_queue, sel_info_t *selection_info, hsize_t off, size_t io_len,
+                                 void *buf, int *local_count_for_signal);
+
+/* Read from an external file, where anything past the end of the file reads as zeros */
+static herr_t read_external_data(int fd, void *buf, size_t size, off_t offset);
+
+/* Open the source datasets of the mappings of a virtual dataset, unless some mapping is left to the library */
+static herr_t resolve_vds_sources(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req);
+
+/* Close the source datasets of a virtual dataset and the files opened for them */
+static void close_vds_sources(vds_source_t *sources, int nsources);
+
+/* Check if any element of a virtual dataset is in more than one of its mappings */
+static htri_t vds_mappings_overlap(const vds_source_t *sources, int nsources);
+
+/* Read the selection of a virtual dataset from its source datasets in a single request.  Returns false
+ * if the library must read it. */
+static htri_t read_virtual_dataset(H5VL_bypass_t *dset_obj, hid_t mem_type_id, hid_t mem_space_id,
+                                   hid_t file_space_id, hid_t dxpl_id, void *buf, void **req);
+
+/* Wake up the thread pool for the tasks which haven't been signaled yet */
+static herr_t signal_leftover_tasks(int local_count_for_signal);
+
+/* Whether the tasks put into a queue are run by the thread pool */
+static bool queue_runs_in_pool(const task_queue_t *task_queue);
+
+/* Whether a task only reads or writes the HDF5 file, so it can be put together with the tasks next to it */
+static bool task_fusable(const Bypass_task_t *task);
+
+/* Order tasks by file, then by offset in the file */
+static int compare_task_addrs(const void *a, const void *b);
+
+/* Make a task do the I/O of the task right after it in the file as well */
+static herr_t append_task_memory(Bypass_task_t *task, const Bypass_task_t *next);
+
+/* Hand the tasks gathered by a fused request to the thread pool, sorted and put together by file offset */
+static herr_t submit_fused_tasks(task_queue_t *fused_queue);
+
+/* Drop the tasks of a fused request which failed before handing them to the thread pool */
+static void drop_fused_tasks(task_queue_t *fused_queue);
+
+/* Read or write the pieces of memory of a task put together from others, from the file offset on */
+static herr_t operate_vector_io(int fd, struct iovec *iov, int iovcnt, off_t offset, bool read_data);
+
+/* Do the I/O of a task.  Data to be converted is read into a staging buffer handed to the next stage */
+static herr_t run_io_task(Bypass_task_t *task);
+
+/* Swap the bytes of the data read by a task or convert it */
+static herr_t decode_task_data(Bypass_task_t *task);
+
+/* Run the current pipeline stage of a task */
+static herr_t run_task_stage(Bypass_task_t *task);
+
+/* The pipeline stage after the current one of a task, or NSTAGES when the task is done */
+static int next_task_stage(Bypass_task_t *task);
+
+/* Run the stages of a task in the calling thread until one that has threads of its own in the pool
+ * (all of them if 'all_stages') */
+static herr_t run_task_stages(Bypass_task_t *task, bool all_stages);
+
+/* Get one of the staging buffers of the calling thread, at least 'size' bytes big */
+static void *get_thread_buf(int which, size_t size);
+
+/* Take a staging buffer away from the calling thread, to hand it to another stage.  The thread gets a
+ * spare buffer in its place if there is one. */
+static void *take_thread_buf(int which, size_t *size);
+
+/* Make a buffer taken from another thread one of the staging buffers of the calling thread.  The
+ * buffer it replaces becomes a spare one. */
+static void put_thread_buf(int which, void *buf, size_t size);
+
+/* Free the staging buffers of the calling thread */
+static void release_thread_bufs(void);
+
+/* Free the spare staging buffers once the thread pool is gone */
+static void release_spare_bufs(void);
+
+/* Reverse the byte order of 2-, 4- or 8-byte elements in place */
+static void swap_bytes(void *buf, size_t nelmts, size_t size);
+
+/* Flatten a regular hyperslab or "all" selection into a box description */
+static htri_t get_hyper_box(hid_t space_id, hyper_box_t *box);
+
+/* Fill in the selection of the whole extent and the pitches of a box */
+static void set_box_all(hyper_box_t *box);
+static void set_box_pitches(hyper_box_t *box);
+
+/* Helpers for walking a box one dimension at a time */
+static inline hsize_t box_coords_before(const hyper_box_t *box, int d, hsize_t x);
+static inline bool box_first_in_range(const hyper_box_t *box, int d, hsize_t lo, hsize_t hi, hsize_t *k_out,
+                                      hsize_t *x_out);
+
+/* Queue a piece of I/O found by the box engine, split into tasks of at most nelmts_max */
+static herr_t submit_box_run(chunk_cb_info_t *cb_info, haddr_t chunk_addr, hsize_t file_off, hsize_t mem_off,
+                             hsize_t len, int *local_count_for_signal);
+
+/* Map the selection falling into one chunk to file and memory sequences without dataspace calls */
+static herr_t process_chunk_boxes(chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets, haddr_t chunk_addr);
+
+/* Chunk iteration callback recording the chunks touched by the selection */
+static int collect_chunk_cb(const hsize_t *chunk_offsets, unsigned filter_mask, haddr_t chunk_addr,
+                            hsize_t chunk_size, void *op_data);
+
+/* Add a chunk to the chunk list, enlarging it as needed */
+static herr_t append_xlate_chunk(chunk_xlate_t *xlate, const hsize_t *chunk_offsets, haddr_t chunk_addr,
+                                 hsize_t chunk_size, unsigned filter_mask);
+
+/* Add the chunks touched by the selection that chunk iteration didn't report, as unallocated */
+static herr_t add_missing_chunks(chunk_xlate_t *xlate);
+
+/* Create the chunks of the list not allocated yet through the library and look up their addresses */
+static herr_t allocate_missing_chunks(H5VL_bypass_t *dset_obj, chunk_xlate_t *xlate, hid_t dxpl_id, void **req);
+
+/* Partition the collected chunks into tasks for the thread pool */
+static herr_t submit_xlate_tasks(task_queue_t *task_queue, chunk_xlate_t *xlate, size_t nparts);
+
+/* Map the selection in one of the collected chunks to I/O, or decode the chunk if it's filtered */
+static herr_t process_xlate_chunk(chunk_cb_info_t *cb_info, chunk_xlate_t *xlate, size_t c);
+
+/* Whether the connector can undo a filter itself, or call the plugin with the filter */
+static bool filter_supported(const filter_info_t *filter);
+
+/* Look up the plugin with a filter in the plugin path of the HDF5 library, NULL if there's none */
+static filter_plugin_t *find_filter_plugin(H5Z_filter_t filter_id);
+
+/* Undo a filter by calling the 'filter' callback of its plugin on the chunk data in the thread buffer 'cur' */
+static herr_t decode_plugin_filter(const filter_info_t *filter, int cur, size_t *nbytes);
+
+/* Read a filtered chunk, undo its filters and copy the selected part to the application's buffer */
+static herr_t read_filtered_chunk(chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets, haddr_t chunk_addr,
+                                  hsize_t chunk_size, unsigned filter_mask);
+
+/* Undo one filter on the chunk data in the thread buffer 'cur', possibly moving it to the other buffer */
+static herr_t decode_chunk_filter(const filter_info_t *filter, int *cur, size_t *nbytes, size_t max_nbytes,
+                                  bool skip_edc);
+
+/* The stages of reading a filtered chunk: read it into the chunk buffer of the calling thread, undo
+ * its filters (returning the staging buffer with the result) and copy the selection out of it */
+static herr_t read_chunk_stage(sel_info_t *selection_info, haddr_t chunk_addr, hsize_t chunk_size);
+static int decode_chunk_stage(chunk_cb_info_t *cb_info, size_t nbytes, unsigned filter_mask);
+static herr_t scatter_chunk_stage(chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets, haddr_t chunk_addr,
+                                  const void *chunk_data);
+
+/* Undo the shuffle filter, putting the bytes of each element back together */
+static void unshuffle_bytes(unsigned char *dst, const unsigned char *src, size_t nbytes, size_t size);
+
+/* Whether the connector can apply a filter to the chunks written */
+static bool filter_encodable(const filter_info_t *filter);
+
+/* Whether the chunks of a dataset can be encoded by the connector for a write */
+static htri_t filters_writable(Bypass_dataset_t *dset);
+
+/* Whether a selection covers all of a chunk lying inside the dataset extent */
+static bool chunk_covered(const chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets);
+
+/* Put together a chunk written in the thread buffers, apply the filters and keep the result in the chunk list */
+static herr_t encode_filtered_chunk(chunk_cb_info_t *cb_info, chunk_xlate_t *xlate, size_t c);
+
+/* Apply one filter to the chunk data in the thread buffer 'cur', moving it to the other buffer */
+static herr_t encode_chunk_filter(const filter_info_t *filter, int *cur, size_t *nbytes);
+
+/* Encode the chunks of a write in the thread pool, then have the library store them in one batch */
+static herr_t write_filtered_chunks(task_queue_t *task_queue, chunk_xlate_t *xlate, size_t nparts,
+                                    H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req, bool *acquired_global,
+                                    unsigned int *lock_count);
+
+/* Apply the shuffle filter, storing byte j of every element in the j-th plane */
+static void shuffle_bytes(unsigned char *dst, const unsigned char *src, size_t nbytes, size_t size);
+
+/* The Fletcher32 checksum as computed by the HDF5 library */
+static uint32_t checksum_fletcher32(const unsigned char *data, size_t len);
+
+/* Check if the selections of a read are regular hyperslabs (or "all") */
+static htri_t selections_are_regular(Bypass_dataset_t *dset, hid_t mem_space_id, hid_t file_space_id);
+
+/* Look up the chunks touched by a regular selection in batches, dropping the library lock in between */
+static herr_t process_chunks_pipelined(chunk_cb_info_t *cb_info, H5VL_bypass_t *dset_obj, hid_t dxpl_id,
+                                       void **req, bool *acquired_global, unsigned int *lock_count);
+
+/* Take and let go the global lock of the HDF5 library */
+static herr_t acquire_global_mutex(unsigned int lock_count, bool *acquired_global);
+static herr_t release_global_mutex(unsigned int *lock_count, bool *acquired_global);
+
+/* Translate a partition of chunks into I/O and do the I/O, in a thread of the pool */
+static herr_t translate_chunk_partition(Bypass_task_t *task);
+
+/* Drop a reference to the collected chunks, freeing them with the last one */
+static void release_chunk_xlate(chunk_xlate_t *xlate);
+
+/* Take a new snapshot of the dataset's metadata and publish it, with the library lock held */
+static herr_t refresh_dset_snapshot(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req);
+
+/* Retrieve the dataspace of a dataset again, after its extent was changed through any handle */
+static herr_t refresh_dset_space(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req);
+
+/* Replace the dataset's snapshot (NULL removes it) */
+static void publish_dset_snapshot(Bypass_dataset_t *dset, Bypass_dset_snapshot_t *snapshot);
+
+/* Take and drop a reference to the dataset's current snapshot */
+static Bypass_dset_snapshot_t *grab_dset_snapshot(Bypass_dataset_t *dset);
+static void release_dset_snapshot(Bypass_dset_snapshot_t *snapshot);
+
+/* Chunk iteration callback filling the chunk map of a snapshot */
+static int snapshot_chunk_cb(const hsize_t *chunk_offsets, unsigned filter_mask, haddr_t chunk_addr,
+                             hsize_t chunk_size, void *op_data);
+
+/* Map the selections of a read to boxes using only the snapshot */
+static htri_t get_snapshot_boxes(const Bypass_dset_snapshot_t *snapshot, hid_t file_space_id,
+                                 hid_t mem_space_id, chunk_cb_info_t *cb_info);
+
+/* Read the datasets without holding the library lock if their snapshots allow it */
+static htri_t dataset_read_fast(size_t count, void *dset[], hid_t mem_type_id[], hid_t mem_space_id[],
+                                hid_t file_space_id[], void *buf[]);
+
 /*******************/
 /* Local variables */
 /*******************/
@@ -618,8 +1021,24 @@ H5VL_bypass_init(hid_t vipl_id)
     char *nsteps_str   = NULL;
     char *nelmts_str   = NULL;
     char *no_tpool_str = NULL;
+    char *xlate_str    = NULL;
+    char *pipeline_str = NULL;
+    char *write_behind_str = NULL;
+    char *write_agg_str = NULL;
+    char *write_agg_ms_str = NULL;
+    char *durability_str = NULL;
+    char *durability_ms_str = NULL;
+    char *fallocate_str = NULL;
+    char *prefetch_str = NULL;
+    char *lock_stats_str = NULL;
+    char *no_simd_str  = NULL;
+    char *nthreads_decode_str  = NULL;
+    char *nthreads_scatter_str = NULL;
+    char *allowlist_str = NULL;
+    char *allowlist_next = NULL;
     pthread_mutexattr_t attr;
-    int i;
+    int nthreads_total;
+    int i, k, stage;
 
 #ifdef ENABLE_BYPASS_LOGGING
     printf("------- BYPASS  VOL INIT\n");
@@ -675,24 +1094,162 @@ H5VL_bypass_init(hid_t vipl_id)
     if (no_tpool_str && !strcmp(no_tpool_str, "true"))
         no_tpool = true;
 
-    /* Initialize the task queue for the thread pool */
-    memset(&queue_for_tpool, 0, sizeof(task_queue_t));
+    /* Retrieve the minimal number of chunks for each thread translating chunk selections in the
+     * thread pool.  Fewer chunks than twice this number are translated by the calling thread. */
+    xlate_str = getenv("BYPASS_VOL_XLATE_MIN_CHUNKS");
+
+    if (xlate_str)
+        xlate_min_chunks = atoi(xlate_str);
+
+    if (xlate_min_chunks < 0)
+        xlate_min_chunks = 0;
+
+    /* Retrieve the number of chunks looked up at a time in the pipelined mode.  Set it to enable the
+     * pipelined mode for chunked datasets */
+    pipeline_str = getenv("BYPASS_VOL_PIPELINE_CHUNKS");
+
+    if (pipeline_str)
+        pipeline_chunks = atoi(pipeline_str);
+
+    if (pipeline_chunks < 0)
+        pipeline_chunks = 0;
+
+    /* Retrieve the cap in MB of the staging buffers for writing behind.  Set it to let H5Dwrite return
+     * before the thread pool writes the data out */
+    write_behind_str = getenv("BYPASS_VOL_WRITE_BEHIND");
+
+    if (write_behind_str && atoll(write_behind_str) > 0)
+        write_behind_max = (size_t)atoll(write_behind_str) * MB;
+
+    /* Retrieve the size in KB of the buffer of each file gathering small writes, and the longest time
+     * in milliseconds the data waits there */
+    write_agg_str = getenv("BYPASS_VOL_WRITE_AGG");
+
+    if (write_agg_str && atoll(write_agg_str) > 0)
+        write_agg_size = (size_t)atoll(write_agg_str) * 1024;
+
+    write_agg_ms_str = getenv("BYPASS_VOL_WRITE_AGG_MS");
+
+    if (write_agg_ms_str && atol(write_agg_ms_str) >= 0)
+        write_agg_ms = atol(write_agg_ms_str);
+
+    /* Retrieve the durability policy ("none", "close" or "group"), the time in milliseconds a sync
+     * waits for more writers in the group mode, and the size in MB of the contiguous datasets whose
+     * storage is preallocated */
+    durability_str = getenv("BYPASS_VOL_DURABILITY");
+
+    if (durability_str && !strcmp(durability_str, "close"))
+        durability = DURABILITY_CLOSE;
+    else if (durability_str && !strcmp(durability_str, "group"))
+        durability = DURABILITY_GROUP;
+    else if (durability_str && strcmp(durability_str, "none"))
+        fprintf(stderr, "unknown durability policy %s, using none\n", durability_str);
+
+    durability_ms_str = getenv("BYPASS_VOL_DURABILITY_MS");
+
+    if (durability_ms_str && atol(durability_ms_str) >= 0)
+        durability_window_ms = atol(durability_ms_str);
+
+    fallocate_str = getenv("BYPASS_VOL_FALLOCATE");
+
+    if (fallocate_str && atoll(fallocate_str) > 0)
+        prealloc_min = (size_t)atoll(fallocate_str) * MB;
+
+    /* Retrieve the most MB prefetched for the next selection of a dataset read step by step */
+    prefetch_str = getenv("BYPASS_VOL_PREFETCH");
+
+    if (prefetch_str && atoll(prefetch_str) > 0)
+        prefetch_max = (size_t)atoll(prefetch_str) * MB;
+
+    /* Retrieve the flag for collecting the wait time for the global lock of the HDF5 library */
+    lock_stats_str = getenv("BYPASS_VOL_LOCK_STATS");
 
-    info_for_thread = malloc(nthreads_tpool * sizeof(info_for_thread_t));
+    if (lock_stats_str && !strcmp(lock_stats_str, "true"))
+        lock_stats = true;
+
+    memset(&global_lock_stats, 0, sizeof(lock_stats_t));
+
+    /* Pick the SIMD instructions for swapping the bytes of data in the opposite byte order, unless the
+     * application turns them off with "BYPASS_VOL_NO_SIMD" */
+    no_simd_str = getenv("BYPASS_VOL_NO_SIMD");
+
+    if (!no_simd_str || strcmp(no_simd_str, "true")) {
+#if defined(BYPASS_SIMD_X86)
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            simd_level = 2;
+        else if (__builtin_cpu_supports("ssse3"))
+            simd_level = 1;
+#elif defined(BYPASS_SIMD_NEON)
+        simd_level = 1;
+#endif
+    }
+
+    /* Reads needing conversions are left to the library if the native types can't be described */
+    if (init_conv_types() < 0)
+        fprintf(stderr, "numeric conversions are done by the HDF5 library\n");
+
+    /* Retrieve the numbers of threads decoding the data read and scattering decoded chunks into the
+     * application's buffers.  With none, the threads of the stage before do the work themselves. */
+    nthreads_stage[STAGE_IO]      = nthreads_tpool;
+    nthreads_stage[STAGE_DECODE]  = 0;
+    nthreads_stage[STAGE_SCATTER] = 0;
+
+    nthreads_decode_str = getenv("BYPASS_VOL_NTHREADS_DECODE");
+
+    if (nthreads_decode_str)
+        nthreads_stage[STAGE_DECODE] = MIN(MAX(atoi(nthreads_decode_str), 0), NTHREADS_MAX);
+
+    nthreads_scatter_str = getenv("BYPASS_VOL_NTHREADS_SCATTER");
+
+    if (nthreads_scatter_str)
+        nthreads_stage[STAGE_SCATTER] = MIN(MAX(atoi(nthreads_scatter_str), 0), NTHREADS_MAX);
+
+    nthreads_total = nthreads_stage[STAGE_IO] + nthreads_stage[STAGE_DECODE] + nthreads_stage[STAGE_SCATTER];
+
+    /* Retrieve the filters whose plugins can be called by many threads at once without the global lock
+     * of the HDF5 library, as a comma-separated list of filter IDs.  Other plugins are left to the
+     * library. */
+    allowlist_str = getenv("BYPASS_VOL_FILTER_ALLOWLIST");
+
+    while (allowlist_str && *allowlist_str && nfilter_allowlist < FILTER_ALLOWLIST_MAX) {
+        long filter_id = strtol(allowlist_str, &allowlist_next, 10);
+
+        if (allowlist_next == allowlist_str)
+            allowlist_next++;
+        else if (filter_id > 0)
+            filter_allowlist[nfilter_allowlist++] = (H5Z_filter_t)filter_id;
+
+        allowlist_str = allowlist_next;
+    }
+
+    /* Initialize the task queues for the thread pool */
+    for (stage = 0; stage < NSTAGES; stage++)
+        memset(stage_queues[stage], 0, sizeof(task_queue_t));
+
+    info_for_thread = malloc(nthreads_total * sizeof(info_for_thread_t));
 
     pthread_mutexattr_init(&attr);
     pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&mutex_local, &attr);
 
-    pthread_cond_init(&cond_local, NULL);
+    for (stage = 0; stage < NSTAGES; stage++)
+        pthread_cond_init(stage_conds[stage], NULL);
 
-    /* Start threads for the thread pool to process the data */
-    for (i = 0; i < nthreads_tpool; i++) {
-        info_for_thread[i].thread_id = i; /* Remove info_for_thread and pass in the
-                                             thread_id directly to pthread_create */
+    pthread_mutex_init(&global_lock_mutex, NULL);
+    pthread_cond_init(&global_lock_cond, NULL);
 
-        if (pthread_create(&th[i], NULL, &start_thread_for_pool, &info_for_thread[i]) != 0)
-            fprintf(stderr, "failed to create thread %d\n", i);
+    /* Start threads for the thread pool to process the data, the I/O stage first */
+    for (stage = 0, i = 0; stage < NSTAGES; stage++) {
+        for (k = 0; k < nthreads_stage[stage]; k++, i++) {
+            info_for_thread[i].thread_id = i; /* Remove info_for_thread and pass in the
+                                                 thread_id directly to pthread_create */
+            info_for_thread[i].stage = stage;
+
+            if (pthread_create(&th[i], NULL, &start_thread_for_pool, &info_for_thread[i]) != 0)
+                fprintf(stderr, "failed to create thread %d\n", i);
+        }
     }
 
     pthread_mutexattr_destroy(&attr);
@@ -744,7 +1301,8 @@ H5VL_bypass_term(void)
 
     locked = true;
 
-    pthread_cond_broadcast(&cond_local);
+    for (i = 0; i < NSTAGES; i++)
+        pthread_cond_broadcast(stage_conds[i]);
 
     if (pthread_mutex_unlock(&mutex_local) < 0) {
         printf("In %s of %s at line %d: pthread_mutex_unlock failed\n", __func__, __FILE__, __LINE__);
@@ -755,7 +1313,7 @@ H5VL_bypass_term(void)
     locked = false;
 
     /* Doesn't stop if an error happens */
-    for (i = 0; i < nthreads_tpool; i++) {
+    for (i = 0; i < nthreads_stage[STAGE_IO] + nthreads_stage[STAGE_DECODE] + nthreads_stage[STAGE_SCATTER]; i++) {
         if (pthread_join(th[i], &thread_ret) != 0)
             fprintf(stderr, "failed to join thread %d\n", i);
         
@@ -798,17 +1356,42 @@ H5VL_bypass_term(void)
     fclose(log_fp);
 #endif
 
-    /* pthread_join has been called, just destroy the queue directly */
-    bypass_queue_destroy(&queue_for_tpool, true);
+    /* pthread_join has been called, just destroy the queues directly */
+    for (i = 0; i < NSTAGES; i++)
+        bypass_queue_destroy(stage_queues[i], true);
 
     if (info_stuff)
         free(info_stuff);
     if (info_for_thread)
         free(info_for_thread);
 
+    /* Report how much the threads waited for the global lock of the HDF5 library */
+    if (lock_stats)
+        fprintf(stderr, "Bypass VOL global lock: %llu acquisitions, %llu contended, %llu blocked, "
+                "%.3f ms total wait, %.3f ms longest wait\n",
+                (unsigned long long)atomic_load(&global_lock_stats.acquires),
+                (unsigned long long)atomic_load(&global_lock_stats.contended),
+                (unsigned long long)atomic_load(&global_lock_stats.blocked),
+                (double)atomic_load(&global_lock_stats.wait_ns) / 1e6,
+                (double)atomic_load(&global_lock_stats.max_wait_ns) / 1e6);
+
+    /* The threads calling the plugins are gone */
+    for (i = 0; i < nfilter_plugins; i++) {
+        if (filter_plugins[i].handle)
+            dlclose(filter_plugins[i].handle);
+    }
+
+    nfilter_plugins = 0;
+
+    release_spare_bufs();
+
     /* Release thread resources */
     pthread_mutex_destroy(&mutex_local);
-    pthread_cond_destroy(&cond_local);
+
+    for (i = 0; i < NSTAGES; i++)
+        pthread_cond_destroy(stage_conds[i]);
+    pthread_mutex_destroy(&global_lock_mutex);
+    pthread_cond_destroy(&global_lock_cond);
 
 done:
     if (locked)
@@ -1522,6 +2105,7 @@ dset_open_helper(H5VL_bypass_t *obj, hid_t dxpl_id, void **req) {
     herr_t ret_value = 0;
     H5VL_dataset_get_args_t get_args;
     Bypass_dataset_t *dset = NULL;
+    int i;
 
     assert(obj->type == H5I_DATASET);
     dset = &obj->u.dataset;
@@ -1533,6 +2117,29 @@ dset_open_helper(H5VL_bypass_t *obj, hid_t dxpl_id, void **req) {
     dset->layout = H5D_LAYOUT_ERROR;
     dset->use_native = false;
     dset->use_native_checked = false;
+    dset->object = NULL;
+    dset->snapshot = NULL;
+    dset->num_external = 0;
+    dset->external = NULL;
+    dset->vds_resolved = false;
+    dset->num_vds_sources = 0;
+    dset->vds_sources = NULL;
+    dset->preallocated = false;
+    dset->pattern_rank = 0;
+    dset->pattern_hits = 0;
+
+    pthread_mutex_init(&dset->pattern_mutex, NULL);
+
+    /* The metadata snapshot is taken by the first read after the storage is allocated */
+    pthread_mutex_init(&dset->snapshot_mutex, NULL);
+
+    /* The handles of the dataset see the changes made through the others by its generation */
+    if (attach_dset_object(obj, dxpl_id, req) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    dset->space_gen = atomic_load(&dset->object->gen);
 
     /* Retrieve dataset's DCPL, copied from H5Dget_create_plist */
     get_args.op_type               = H5VL_DATASET_GET_DCPL;
@@ -1572,6 +2179,46 @@ dset_open_helper(H5VL_bypass_t *obj, hid_t dxpl_id, void **req) {
         goto done;
     }
 
+    if (dset->num_filters > H5Z_MAX_NFILTERS) {
+        fprintf(stderr, "dataset has too many filters\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* Keep the filter pipeline, so chunks can be decoded without asking the library */
+    for (i = 0; i < dset->num_filters; i++) {
+        dset->filters[i].cd_nelmts = FILTER_CD_VALUES_MAX;
+
+        if ((dset->filters[i].id = H5Pget_filter2(dset->dcpl_id, (unsigned)i, &dset->filters[i].flags,
+                                                  &dset->filters[i].cd_nelmts, dset->filters[i].cd_values, 0,
+                                                  NULL, NULL)) < 0) {
+            fprintf(stderr, "unable to get opened dataset's filter\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        /* Other filters are undone by their plugins if they are on the allowlist, unless some client data
+         * values didn't fit */
+        dset->filters[i].plugin = NULL;
+
+        if (dset->filters[i].cd_nelmts <= FILTER_CD_VALUES_MAX && dset->filters[i].id != H5Z_FILTER_DEFLATE &&
+            dset->filters[i].id != H5Z_FILTER_SHUFFLE && dset->filters[i].id != H5Z_FILTER_FLETCHER32)
+            dset->filters[i].plugin = find_filter_plugin(dset->filters[i].id);
+    }
+
+    /* Storage not allocated yet is read as the fill value, depending on these two */
+    if (H5Pget_fill_time(dset->dcpl_id, &dset->fill_time) < 0) {
+        fprintf(stderr, "unable to get opened dataset's fill time\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (H5Pfill_value_defined(dset->dcpl_id, &dset->fill_status) < 0) {
+        fprintf(stderr, "unable to get opened dataset's fill value status\n");
+        ret_value = -1;
+        goto done;
+    }
+
     /* Retrieve layout */
     if ((dset->layout = H5Pget_layout(dset->dcpl_id)) < 0) {
         fprintf(stderr, "unable to get dataset's layout\n");
@@ -1585,6 +2232,13 @@ dset_open_helper(H5VL_bypass_t *obj, hid_t dxpl_id, void **req) {
         goto done;
     }
 
+    /* The external files themselves are opened by the first read */
+    if ((dset->num_external = H5Pget_external_count(dset->dcpl_id)) < 0) {
+        fprintf(stderr, "unable to get dataset's external file count\n");
+        ret_value = -1;
+        goto done;
+    }
+
 done:
     if (ret_value < 0) {
         H5E_BEGIN_TRY {
@@ -1598,6 +2252,115 @@ done:
     return ret_value;
 } /* dset_open_helper */
 
+/* The handles of a dataset are told apart from other datasets by the location of its object header,
+ * which is the same whichever handle of the file they were opened through */
+static herr_t
+attach_dset_object(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req)
+{
+    Bypass_dataset_t      *dset = &dset_obj->u.dataset;
+    Bypass_shared_file_t  *shared = dset->file->u.file.shared;
+    Bypass_object_t       *object;
+    H5VL_object_get_args_t args;
+    H5VL_loc_params_t      loc_params;
+    H5O_info2_t            oinfo;
+    bool                   locked = false;
+    int                    cmp = 1;
+    herr_t                 ret_value = 0;
+
+    assert(shared);
+
+    /* Set location parameters */
+    loc_params.type     = H5VL_OBJECT_BY_SELF;
+    loc_params.obj_type = H5I_DATASET;
+
+    /* Set up VOL callback arguments */
+    args.op_type              = H5VL_OBJECT_GET_INFO;
+    args.args.get_info.oinfo  = &oinfo;
+    args.args.get_info.fields = H5O_INFO_BASIC;
+
+    if (H5VLobject_get(dset_obj->under_object, &loc_params, dset_obj->under_vol_id, &args, dxpl_id, req) < 0) {
+        fprintf(stderr, "unable to get dataset's object info\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    pthread_mutex_lock(&shared_files_mutex);
+    locked = true;
+
+    for (object = shared->objects; object; object = object->next) {
+        if (H5VLtoken_cmp(dset_obj->under_object, dset_obj->under_vol_id, &object->token, &oinfo.token, &cmp) < 0) {
+            fprintf(stderr, "unable to compare object tokens\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if (cmp == 0)
+            break;
+    }
+
+    if (!object) {
+        if ((object = (Bypass_object_t *)calloc(1, sizeof(Bypass_object_t))) == NULL) {
+            fprintf(stderr, "failed to allocate dataset record\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        object->token = oinfo.token;
+        atomic_init(&object->gen, 0);
+        atomic_init(&object->wb_tasks, 0);
+        atomic_init(&object->wb_errors, 0);
+        pthread_cond_init(&object->wb_cond, NULL);
+
+        object->next    = shared->objects;
+        shared->objects = object;
+    }
+
+    object->ref_count++;
+    dset->object = object;
+
+done:
+    if (locked)
+        pthread_mutex_unlock(&shared_files_mutex);
+
+    return ret_value;
+} /* end attach_dset_object() */
+
+static void
+detach_dset_object(Bypass_dataset_t *dset)
+{
+    if (!dset->object)
+        return;
+
+    put_dset_object(dset->file->u.file.shared, dset->object);
+
+    dset->object = NULL;
+} /* end detach_dset_object() */
+
+/* A barrier waiting for the writes of a dataset keeps its record, and the record of its file, until
+ * it's done, even if the handles were closed meanwhile */
+static void
+put_dset_object(Bypass_shared_file_t *shared, Bypass_object_t *object)
+{
+    Bypass_object_t **prev;
+
+    pthread_mutex_lock(&shared_files_mutex);
+
+    if (--object->ref_count == 0) {
+        for (prev = &shared->objects; *prev != object; prev = &(*prev)->next)
+            ;
+
+        *prev = object->next;
+
+        pthread_cond_destroy(&object->wb_cond);
+        free(object);
+
+        if (shared->ref_count == 0 && shared->objects == NULL)
+            free_shared_file(shared);
+    }
+
+    pthread_mutex_unlock(&shared_files_mutex);
+} /* end put_dset_object() */
+
 /*-------------------------------------------------------------------------
  * Function:    H5VL_bypass_dataset_create
  *
@@ -2009,605 +2772,5437 @@ done:
     return ret_value;
 }
 
-static void *
-start_thread_for_pool(void *args)
+/* The pieces are consumed as they're done, so the array of the task is changed */
+static herr_t
+operate_vector_io(int fd, struct iovec *iov, int iovcnt, off_t offset, bool read_data)
 {
-    int thread_id = ((info_for_thread_t *)args)->thread_id;
-    void    *ret_value = (void*) 0;
-    Bypass_task_t **tasks = NULL; /* An array of tasks to be queued */
-    int      local_count = 0;
-    int      load_task_count = 0;
-    int      i;
+    ssize_t bytes_processed;
+    size_t  nbytes;
+    int     n;
+    herr_t  ret_value = 0;
 
-    // fprintf(stderr, "In start_thread_for_pool: %d\n", thread_id);
+    while (iovcnt > 0) {
+#ifdef IOV_MAX
+        n = MIN(iovcnt, IOV_MAX);
+#else
+        n = iovcnt;
+#endif
 
-    if ((tasks = (Bypass_task_t **)malloc(nsteps_tpool * sizeof(Bypass_task_t*))) == NULL) {
-        fprintf(stderr, "failed to allocate a squence of tasks\n");
-        ret_value = (void*) -1;
-        goto done;
-    }
+        if (read_data)
+            bytes_processed = preadv(fd, iov, n, offset);
+        else
+            bytes_processed = pwritev(fd, iov, n, offset);
 
-    /* stop_tpool is only turned on in H5VL_bypass_term when the application finishes */
-    while (!stop_tpool) {
-        if (pthread_mutex_lock(&mutex_local) != 0) {
-            fprintf(stderr, "failed to lock mutex\n");
-            ret_value = (void*) -1;
+        if (bytes_processed == 0) {
+            fprintf(stderr, "file read encountered EOF\n");
+            ret_value = -1;
             goto done;
         }
 
-	//fprintf(stderr, "\t%s: %d: thread %d before wait\n", __func__, __LINE__, thread_id);
+        if (bytes_processed < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
 
-	/* If no tasks are available to work on, just wait.  Not sure if stop_tpool is useful. */
-        while (queue_for_tpool.tasks_in_queue == 0 && !stop_tpool) {
-            pthread_cond_wait(&cond_local, &mutex_local);
+            fprintf(stderr, "%s, %d: preadv/pwritev failed with error: %s\n", __func__, __LINE__, strerror(errno));
+            ret_value = -1;
+            goto done;
         }
 
-	//fprintf(stderr, "\t%s: %d: thread %d after wait\n", __func__, __LINE__, thread_id);
-
-        /* tasks_in_queue can be smaller (LEFTOVER being passed into
-         * submit_task() in process_vectors()) or larger (submit_task() keeps adding
-         * more before they are processed) than nsteps_tpool. Choose the smaller
-         * value */
-        local_count = MIN(queue_for_tpool.tasks_in_queue, nsteps_tpool);
-
-        for (i = 0; i < local_count; i++) {
-            /* Get the task in queue */
-            if ((tasks[i] = bypass_queue_pop(&queue_for_tpool, false)) == NULL) {
-                fprintf(stderr, "failed to pop task from queue\n");
-                ret_value = (void*) -1;
-                goto done;
-            }
+        offset += bytes_processed;
+        nbytes = (size_t)bytes_processed;
 
-            tasks[i]->file->u.file.num_reads++;
-            tasks[i]->file->u.file.read_started = true;
+        /* Skip the pieces done, and the part done of the next one */
+        while (iovcnt > 0 && nbytes >= iov->iov_len) {
+            nbytes -= iov->iov_len;
+            iov++;
+            iovcnt--;
         }
 
-        if (pthread_mutex_unlock(&mutex_local) != 0) {
-            fprintf(stderr, "failed to unlock mutex\n");
-            ret_value = (void*) -1;
-            goto done;
+        if (nbytes > 0) {
+            iov->iov_base = (char *)iov->iov_base + nbytes;
+            iov->iov_len -= nbytes;
         }
+    }
 
-	//fprintf(stderr, "\t%s: %d: thread %d before reading data, local_count = %d\n", __func__, __LINE__, thread_id, local_count);
+done:
+    return ret_value;
+} /* end operate_vector_io() */
 
-	for (i = 0; i < local_count; i++) {
-	    if (operate_data_io(tasks[i]->file->u.file.fd, tasks[i]->vec_buf, tasks[i]->size,
-		       tasks[i]->addr, tasks[i]->read_data) < 0) {
-	        fprintf(stderr, "operate_data_io failed within file %s, read_data = %d\n", tasks[i]->file->u.file.name, tasks[i]->read_data);
-	        /* Return a failure code, but try to complete the rest of the read request.
-	         * This is important to properly decrement the reference count/num_reads on the local file object */
-	        ret_value = (void *)-1;
-	    }
+/* Reverse the bytes of the elements one at a time, for the elements left over by the SIMD kernels */
+static void
+swap_bytes_scalar(unsigned char *buf, size_t nelmts, size_t size)
+{
+    size_t i;
 
-            if (pthread_mutex_lock(&mutex_local) != 0) {
-                fprintf(stderr, "failed to lock mutex\n");
-                ret_value = (void*) -1;
-                goto done;
-            }
+    switch (size) {
+        case 2:
+            for (i = 0; i < nelmts; i++, buf += 2) {
+                uint16_t v;
 
-            tasks[i]->file->u.file.num_reads--;
+                memcpy(&v, buf, 2);
+                v = __builtin_bswap16(v);
+                memcpy(buf, &v, 2);
+            }
+            break;
+        case 4:
+            for (i = 0; i < nelmts; i++, buf += 4) {
+                uint32_t v;
 
-	    //load_task_count = atomic_load(tasks[i]->task_count_ptr);
-	    //fprintf(stderr, "\t%s: %d: thread %d, i = %d load_task_count = %d\n", __func__, __LINE__, thread_id, i, load_task_count);
+                memcpy(&v, buf, 4);
+                v = __builtin_bswap32(v);
+                memcpy(buf, &v, 4);
+            }
+            break;
+        case 8:
+            for (i = 0; i < nelmts; i++, buf += 8) {
+                uint64_t v;
 
-	    /* Decrement the task count that this pointer points to */
-	    atomic_fetch_sub(tasks[i]->task_count_ptr, 1);
+                memcpy(&v, buf, 8);
+                v = __builtin_bswap64(v);
+                memcpy(buf, &v, 8);
+            }
+            break;
+        default:
+            break;
+    }
+}
 
-	    load_task_count = atomic_load(tasks[i]->task_count_ptr);
+#ifdef BYPASS_SIMD_X86
+/* Byte shuffle patterns reversing each 2-, 4- or 8-byte element of a 16-byte lane */
+static const unsigned char swap_masks[3][16] = {
+    {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+    {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+    {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8}};
 
-	    /* When the task count drops to zerp, notify the invoking thread to finish the dataset
-	     * read function.  Use the signal function instead of broadcast because it's notifying
-	     * one thread only.
-	     */
-	    if (load_task_count == 0)
-	        //pthread_cond_broadcast(tasks[i]->local_condition_ptr);
-	        pthread_cond_signal(tasks[i]->local_condition_ptr);
+/* Swap 16 bytes at a time and return the number of bytes done */
+__attribute__((target("ssse3"))) static size_t
+swap_bytes_ssse3(unsigned char *buf, size_t nbytes, const unsigned char *mask_bytes)
+{
+    __m128i mask = _mm_loadu_si128((const __m128i *)mask_bytes);
+    size_t  i;
 
-	    //fprintf(stderr, "\t%s: %d: thread %d, i = %d, load_task_count = %d\n", __func__, __LINE__, thread_id, i, load_task_count);
+    for (i = 0; i + 16 <= nbytes; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
 
-            /* When there is no task left in the queue and all the reads finish for
-             * the current file, signal the main process that this file can be closed.
-             */
-	    if ((queue_for_tpool.tasks_in_queue == 0) && tasks[i]->file->u.file.num_reads == 0) {
-                /* There are currently no reads active on this file - it may be closed */
-                tasks[i]->file->u.file.read_started = false;
+        _mm_storeu_si128((__m128i *)(buf + i), _mm_shuffle_epi8(v, mask));
+    }
 
-                pthread_cond_broadcast(&(tasks[i]->file->u.file.close_ready));
-            }
+    return i;
+}
 
-            if (pthread_mutex_unlock(&mutex_local) != 0) {
-                fprintf(stderr, "failed to unlock mutex\n");
-                ret_value = (void*) -1;
-                goto done;
-            }
+/* Swap 32 bytes at a time and return the number of bytes done.  The shuffle works within each
+ * 16-byte half, which holds whole elements. */
+__attribute__((target("avx2"))) static size_t
+swap_bytes_avx2(unsigned char *buf, size_t nbytes, const unsigned char *mask_bytes)
+{
+    __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)mask_bytes));
+    size_t  i;
 
-            if (bypass_task_release(tasks[i]) < 0) {
-                fprintf(stderr, "failed to release task\n");
-                ret_value = (void*) -1;
-                goto done;
-            }
+    for (i = 0; i + 32 <= nbytes; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
 
-            tasks[i] = NULL;
-        }
+        _mm256_storeu_si256((__m256i *)(buf + i), _mm256_shuffle_epi8(v, mask));
     }
 
-done:
-    /* Attempt to clean up queue memory that we took ownership of */
-    if (ret_value < (void*) 0) {
-        fprintf(stderr, "thread idx %d in pool failed\n", thread_id);
-
-        for (i = 0; i < local_count; i++) {
-            if (tasks[i] != NULL) {
-                bypass_task_release(tasks[i]);
-                tasks[i] = NULL;
-            }
-        }
-    }
+    return i;
+}
+#endif
 
-    free(tasks);
+#ifdef BYPASS_SIMD_NEON
+/* Swap 16 bytes at a time and return the number of bytes done */
+static size_t
+swap_bytes_neon(unsigned char *buf, size_t nbytes, size_t size)
+{
+    size_t i;
 
-    return ret_value;
-} /* end start_thread_for_pool() */
+    for (i = 0; i + 16 <= nbytes; i += 16) {
+        uint8x16_t v = vld1q_u8(buf + i);
 
-static herr_t
-process_vectors(task_queue_t *task_queue, void *rbuf, sel_info_t *selection_info)
-{
-    hid_t      file_iter_id, mem_iter_id;
-    size_t     file_seq_i, mem_seq_i, file_nseq, mem_nseq;
-    hssize_t   hss_nelmts;
-    size_t     nelmts; 
-    size_t     seq_nelem;
-    hsize_t    file_off[SEL_SEQ_LIST_LEN], mem_off[SEL_SEQ_LIST_LEN];
-    size_t     file_len[SEL_SEQ_LIST_LEN], mem_len[SEL_SEQ_LIST_LEN];
-    size_t     io_len;
-    int        local_count_for_signal = 0;
-    Bypass_task_t *task = NULL;
-    haddr_t    task_addr   = HADDR_UNDEF;
-    void       *task_buf    = NULL;
-    herr_t     ret_value = 0;
+        if (size == 2)
+            v = vrev16q_u8(v);
+        else if (size == 4)
+            v = vrev32q_u8(v);
+        else
+            v = vrev64q_u8(v);
 
-    /* Contiguous is treated as a single chunk */
-    if ((hss_nelmts = H5Sget_select_npoints(selection_info->file_space_id)) < 0) {
-        fprintf(stderr, "H5Sget_select_npoints on filespace failed\n");
-        ret_value = -1;
-        goto done;
+        vst1q_u8(buf + i, v);
     }
 
-    nelmts     = hss_nelmts;
+    return i;
+}
+#endif
 
-    if ((hss_nelmts = H5Sget_select_npoints(selection_info->mem_space_id)) < 0) {
-        fprintf(stderr, "H5Sget_select_npoints on memspace failed\n");
-        ret_value = -1;
-        goto done;
-    }
+static void
+swap_bytes(void *buf, size_t nelmts, size_t size)
+{
+    unsigned char *p      = (unsigned char *)buf;
+    size_t         nbytes = nelmts * size;
+    size_t         done   = 0;
 
-    if (nelmts != hss_nelmts) {
-        fprintf(stderr, "the number of selected elements in file (%ld) isn't equal to the number in memory (%" PRIdHSIZE")\n", nelmts,
-               hss_nelmts);
-        ret_value = -1;
-        goto done;
-    }
+    assert(size == 2 || size == 4 || size == 8);
 
-    if ((file_iter_id =
-        H5Ssel_iter_create(selection_info->file_space_id, 
-        selection_info->dtype_size, H5S_SEL_ITER_SHARE_WITH_DATASPACE)) < 0)
+#ifdef BYPASS_SIMD_X86
     {
-        fprintf(stderr, "H5Ssel_iter_create on filespace failed\n");
-        ret_value = -1;
-        goto done;
-    }
+        const unsigned char *mask = swap_masks[size == 2 ? 0 : (size == 4 ? 1 : 2)];
 
-    if ((mem_iter_id =
-        H5Ssel_iter_create(selection_info->mem_space_id, 
-        selection_info->dtype_size, H5S_SEL_ITER_SHARE_WITH_DATASPACE)) < 0)
-    {
-        fprintf(stderr, "H5Ssel_iter_create on memspace failed\n");
-        ret_value = -1;
-        goto done;
+        if (simd_level >= 2)
+            done = swap_bytes_avx2(p, nbytes, mask);
+
+        if (simd_level >= 1)
+            done += swap_bytes_ssse3(p + done, nbytes - done, mask);
     }
+#elif defined(BYPASS_SIMD_NEON)
+    if (simd_level >= 1)
+        done = swap_bytes_neon(p, nbytes, size);
+#endif
 
-    /* Initialize values so sequence lists are retrieved on the first iteration */
-    file_seq_i = mem_seq_i = SEL_SEQ_LIST_LEN;
-    file_nseq = mem_nseq = 0;
+    /* The tail of fewer than 16 bytes */
+    swap_bytes_scalar(p + done, (nbytes - done) / size, size);
+}
 
-    /* Loop until all elements are processed. The algorithm is copied from the
-     * function H5FD__read_selection_translate in H5FDint.c, which is somewhat
-     * similar to H5D__select_io in H5Dselect.c
-     */
-    while (file_seq_i < file_nseq || nelmts > 0) {
-        if (file_seq_i == SEL_SEQ_LIST_LEN) {
-            if (H5Ssel_iter_get_seq_list(file_iter_id, SEL_SEQ_LIST_LEN, SIZE_MAX, &file_nseq, &seq_nelem,
-                                         file_off, file_len) < 0)
-            {
-                fprintf(stderr, "file sequence length retrieval failed\n");
-                ret_value = -1;
-                goto done;
-            }
+/* The shuffle filter stores byte j of every element in the j-th plane of the chunk.  Putting the
+ * elements back together is a transpose of the planes, done 16 elements at a time by interleaving
+ * the planes pairwise: bytes first, then pairs of bytes, then groups of four. */
+#ifdef BYPASS_SIMD_X86
+/* Return the number of elements done */
+__attribute__((target("sse2"))) static size_t
+unshuffle_sse2(unsigned char *dst, const unsigned char *src, size_t nelmts, size_t size)
+{
+    __m128i a[8], t[8], u[4];
+    size_t  i = 0;
+    size_t  j;
 
-        if (file_nseq == 0) {
-            fprintf(stderr, "no file sequences retrieved from iteration\n");
-            ret_value = -1;
-            goto done;
+    for (i = 0; i + 16 <= nelmts; i += 16) {
+        for (j = 0; j < size; j++)
+            a[j] = _mm_loadu_si128((const __m128i *)(src + j * nelmts + i));
+
+        if (size == 2) {
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(a[0], a[1]));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(a[0], a[1]));
+            continue;
         }
 
-	    nelmts -= seq_nelem;
-	    file_seq_i = 0;
-	}
+        /* Bytes 2j and 2j + 1 of elements 0-7 in t[2j], of elements 8-15 in t[2j + 1] */
+        for (j = 0; j < size; j += 2) {
+            t[j]     = _mm_unpacklo_epi8(a[j], a[j + 1]);
+            t[j + 1] = _mm_unpackhi_epi8(a[j], a[j + 1]);
+        }
 
-        /* Fill/refill memory sequence list if necessary */
-        if (mem_seq_i == SEL_SEQ_LIST_LEN) {
-            if (H5Ssel_iter_get_seq_list(mem_iter_id, SEL_SEQ_LIST_LEN, SIZE_MAX, &mem_nseq, &seq_nelem,
-                                         mem_off, mem_len) < 0)
-            {
-                fprintf(stderr, "memory sequence length retrieval failed\n");
-                ret_value = -1;
-                goto done;
-            }
+        if (size == 4) {
+            _mm_storeu_si128((__m128i *)(dst + 4 * i), _mm_unpacklo_epi16(t[0], t[2]));
+            _mm_storeu_si128((__m128i *)(dst + 4 * i + 16), _mm_unpackhi_epi16(t[0], t[2]));
+            _mm_storeu_si128((__m128i *)(dst + 4 * i + 32), _mm_unpacklo_epi16(t[1], t[3]));
+            _mm_storeu_si128((__m128i *)(dst + 4 * i + 48), _mm_unpackhi_epi16(t[1], t[3]));
+            continue;
+        }
 
-        if (mem_nseq == 0) {
-            fprintf(stderr, "no memory sequences retrieved from iteration\n");
-            ret_value = -1;
-            goto done;
+        /* Eight bytes: elements 0-7 first, then 8-15 */
+        for (j = 0; j < 2; j++) {
+            u[0] = _mm_unpacklo_epi16(t[j], t[j + 2]);
+            u[1] = _mm_unpackhi_epi16(t[j], t[j + 2]);
+            u[2] = _mm_unpacklo_epi16(t[j + 4], t[j + 6]);
+            u[3] = _mm_unpackhi_epi16(t[j + 4], t[j + 6]);
+
+            _mm_storeu_si128((__m128i *)(dst + 8 * i + 64 * j), _mm_unpacklo_epi32(u[0], u[2]));
+            _mm_storeu_si128((__m128i *)(dst + 8 * i + 64 * j + 16), _mm_unpackhi_epi32(u[0], u[2]));
+            _mm_storeu_si128((__m128i *)(dst + 8 * i + 64 * j + 32), _mm_unpacklo_epi32(u[1], u[3]));
+            _mm_storeu_si128((__m128i *)(dst + 8 * i + 64 * j + 48), _mm_unpackhi_epi32(u[1], u[3]));
         }
+    }
 
-	   mem_seq_i = 0;
-	}
+    return i;
+}
+#endif
 
-        /* Calculate length of this IO */
-        io_len = MIN(file_len[file_seq_i], mem_len[mem_seq_i]);
+#ifdef BYPASS_SIMD_NEON
+/* Return the number of elements done */
+static size_t
+unshuffle_neon(unsigned char *dst, const unsigned char *src, size_t nelmts, size_t size)
+{
+    uint8x16_t  a[8];
+    uint8x16x2_t t[4];
+    uint16x8x2_t u[2];
+    uint32x4x2_t v;
+    size_t      i = 0;
+    size_t      j, k;
+
+    for (i = 0; i + 16 <= nelmts; i += 16) {
+        for (j = 0; j < size; j++)
+            a[j] = vld1q_u8(src + j * nelmts + i);
+
+        if (size == 2) {
+            uint8x16x2_t planes = {{a[0], a[1]}};
+
+            vst2q_u8(dst + 2 * i, planes);
+        } else if (size == 4) {
+            uint8x16x4_t planes = {{a[0], a[1], a[2], a[3]}};
+
+            vst4q_u8(dst + 4 * i, planes);
+        } else {
+            for (j = 0; j < 4; j++)
+                t[j] = vzipq_u8(a[2 * j], a[2 * j + 1]);
+
+            /* Elements 0-7 from the low halves, then 8-15 from the high halves */
+            for (k = 0; k < 2; k++) {
+                u[0] = vzipq_u16(vreinterpretq_u16_u8(t[0].val[k]), vreinterpretq_u16_u8(t[1].val[k]));
+                u[1] = vzipq_u16(vreinterpretq_u16_u8(t[2].val[k]), vreinterpretq_u16_u8(t[3].val[k]));
+
+                for (j = 0; j < 2; j++) {
+                    v = vzipq_u32(vreinterpretq_u32_u16(u[0].val[j]), vreinterpretq_u32_u16(u[1].val[j]));
+
+                    vst1q_u8(dst + 8 * i + 64 * k + 32 * j, vreinterpretq_u8_u32(v.val[0]));
+                    vst1q_u8(dst + 8 * i + 64 * k + 32 * j + 16, vreinterpretq_u8_u32(v.val[1]));
+                }
+            }
+        }
+    }
 
-        /* Make sure the data length isn't greater than user's input
-         * (default to 1024 * 1024), mainly for contiguous datasets */
-        io_len = MIN(io_len, nelmts_max);
+    return i;
+}
+#endif
 
-	if (no_tpool) {
-	    if ((task = malloc(sizeof(Bypass_task_t))) == NULL) {
-		fprintf(stderr, "Failed to allocate memory for a task\n");
-		ret_value = -1;
-		goto done;
-	    }
+static void
+unshuffle_bytes(unsigned char *dst, const unsigned char *src, size_t nbytes, size_t size)
+{
+    size_t nelmts = nbytes / size;
+    size_t done   = 0;
+    size_t i, j;
+
+    /* The library leaves single elements and single bytes alone */
+    if (size <= 1 || nelmts <= 1) {
+        memcpy(dst, src, nbytes);
+        return;
+    }
+
+#ifdef BYPASS_SIMD_X86
+    if (simd_level >= 1 && (size == 2 || size == 4 || size == 8))
+        done = unshuffle_sse2(dst, src, nelmts, size);
+#elif defined(BYPASS_SIMD_NEON)
+    if (simd_level >= 1 && (size == 2 || size == 4 || size == 8))
+        done = unshuffle_neon(dst, src, nelmts, size);
+#endif
 
-	    /* Populate task and append to queue */
-	    task_addr = selection_info->chunk_addr + file_off[file_seq_i];
-	    task_buf = (void *)((uint8_t *)rbuf + mem_off[mem_seq_i]);
+    for (j = 0; j < size; j++)
+        for (i = done; i < nelmts; i++)
+            dst[i * size + j] = src[j * nelmts + i];
 
-	    if ((task = bypass_task_create(selection_info, task_addr, io_len, task_buf)) == NULL) {
-		fprintf(stderr, "Failed to assemble task while processing vectors\n");
-		ret_value = -1;
-		goto done;
-	    }
+    /* Bytes left over past the last whole element aren't shuffled */
+    memcpy(dst + nelmts * size, src + nelmts * size, nbytes - nelmts * size);
+}
 
-	    //printf("%s: %d: task_queue->tasks_in_queue = %d\n", __func__, __LINE__, task_queue->tasks_in_queue);
+/* Chunks are shuffled once per write, before being deflated, so this stays a plain loop */
+static void
+shuffle_bytes(unsigned char *dst, const unsigned char *src, size_t nbytes, size_t size)
+{
+    size_t nelmts = nbytes / size;
+    size_t i, j;
 
-	    if (bypass_queue_push(task_queue, task, false) < 0) {
-		fprintf(stderr, "Failed to push task to queue\n");
-		ret_value = -1;
-		goto done;
-	    }
-	} else {
-	    /* Lock in order to append a task to the task queue */
-	    if (pthread_mutex_lock(&mutex_local) != 0) {
-		fprintf(stderr, "failed to lock local mutex\n");
-		ret_value = -1;
-		goto done;
-	    }
+    if (size <= 1 || nelmts <= 1) {
+        memcpy(dst, src, nbytes);
+        return;
+    }
 
-	    if ((task = malloc(sizeof(Bypass_task_t))) == NULL) {
-		fprintf(stderr, "Failed to allocate memory for a task\n");
-		ret_value = -1;
-		goto done;
-	    }
+    for (j = 0; j < size; j++)
+        for (i = 0; i < nelmts; i++)
+            dst[j * nelmts + i] = src[i * size + j];
 
-	    /* Populate task and append to queue */
-	    task_addr = selection_info->chunk_addr + file_off[file_seq_i];
-	    task_buf = (void *)((uint8_t *)rbuf + mem_off[mem_seq_i]);
+    memcpy(dst + nelmts * size, src + nelmts * size, nbytes - nelmts * size);
+}
 
-	    if ((task = bypass_task_create(selection_info, task_addr, io_len, task_buf)) == NULL) {
-		fprintf(stderr, "Failed to assemble task while processing vectors\n");
-		ret_value = -1;
-		goto done;
-	    }
+static uint32_t
+checksum_fletcher32(const unsigned char *data, size_t len)
+{
+    size_t   nwords = len / 2;
+    size_t   block;
+    uint32_t sum1 = 0, sum2 = 0;
 
-	    if (bypass_queue_push(task_queue, task, false) < 0) {
-		fprintf(stderr, "Failed to push task to queue\n");
-		ret_value = -1;
-		goto done;
-	    }
+    /* The sums are folded before they can overflow, every 360 words */
+    while (nwords) {
+        block = nwords > 360 ? 360 : nwords;
+        nwords -= block;
 
-	    local_count_for_signal++;
+        do {
+            sum1 += (uint32_t)(((uint16_t)data[0]) << 8) | ((uint16_t)data[1]);
+            data += 2;
+            sum2 += sum1;
+        } while (--block);
 
-	    /* Let the queue accumulate nsteps_tpool entries then signal the thread pool
-	     * to read them */
-	    if (local_count_for_signal >= nsteps_tpool) {
-		pthread_cond_broadcast(&cond_local);
-		local_count_for_signal = 0;
-	    }
+        sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+        sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    }
 
-	    if (pthread_mutex_unlock(&mutex_local) != 0) {
-		fprintf(stderr, "failed to unlock local mutex\n");
-		ret_value = -1;
-		goto done;
+    /* An odd byte at the end counts as the high byte of a word */
+    if (len % 2) {
+        sum1 += (uint32_t)(((uint16_t)*data) << 8);
+        sum2 += sum1;
+        sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+        sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    }
+
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+
+    return (sum2 << 16) | sum1;
+}
+
+/* Conversions between the numeric types follow the hard conversions of the HDF5 library when no
+ * exception handler is set: integers out of range are clamped to the range of the destination,
+ * floating-point numbers are truncated toward zero when converted to integers (NaN becomes 0), and
+ * doubles out of the range of floats become infinity.  The loops are left simple for the compiler to
+ * vectorize them. */
+#define CONV_S_S(ST, DT, V, DMIN, DMAX) ((V) < (DMIN) ? (DT)(DMIN) : ((V) > (DMAX) ? (DT)(DMAX) : (DT)(V)))
+#define CONV_S_U(ST, DT, V, DMIN, DMAX) ((V) < 0 ? (DT)0 : ((uint64_t)(V) > (DMAX) ? (DT)(DMAX) : (DT)(V)))
+#define CONV_U_S(ST, DT, V, DMIN, DMAX) ((V) > (uint64_t)(DMAX) ? (DT)(DMAX) : (DT)(V))
+#define CONV_U_U(ST, DT, V, DMIN, DMAX) ((V) > (DMAX) ? (DT)(DMAX) : (DT)(V))
+#define CONV_S_F(ST, DT, V, DMIN, DMAX) ((DT)(V))
+#define CONV_U_F(ST, DT, V, DMIN, DMAX) ((DT)(V))
+#define CONV_F_S(ST, DT, V, DMIN, DMAX)                                                                      \
+    (isnan(V) ? (DT)0 : ((V) <= (ST)(DMIN) ? (DT)(DMIN) : ((V) >= (ST)(DMAX) ? (DT)(DMAX) : (DT)(V))))
+#define CONV_F_U(ST, DT, V, DMIN, DMAX) CONV_F_S(ST, DT, V, DMIN, DMAX)
+#define CONV_F_F(ST, DT, V, DMIN, DMAX)                                                                      \
+    ((V) > (ST)(DMAX) ? (DT)INFINITY : ((V) < -(ST)(DMAX) ? -(DT)INFINITY : (DT)(V)))
+
+#define DEFINE_CONV(SN, ST, SK, DN, DT, DK, DMIN, DMAX)                                                      \
+    static void conv_##SN##_##DN(const void *src, void *dst, size_t nelmts)                                \
+    {                                                                                                      \
+        const ST *s = (const ST *)src;                                                                     \
+        DT       *d = (DT *)dst;                                                                           \
+        size_t    i;                                                                                       \
+                                                                                                           \
+        for (i = 0; i < nelmts; i++)                                                                       \
+            d[i] = CONV_##SK##_##DK(ST, DT, s[i], DMIN, DMAX);                                             \
+    }
+
+#define DEFINE_CONVS_FROM(SN, ST, SK)                                                                        \
+    DEFINE_CONV(SN, ST, SK, int8, int8_t, S, INT8_MIN, INT8_MAX)                                             \
+    DEFINE_CONV(SN, ST, SK, uint8, uint8_t, U, 0, UINT8_MAX)                                                 \
+    DEFINE_CONV(SN, ST, SK, int16, int16_t, S, INT16_MIN, INT16_MAX)                                         \
+    DEFINE_CONV(SN, ST, SK, uint16, uint16_t, U, 0, UINT16_MAX)                                              \
+    DEFINE_CONV(SN, ST, SK, int32, int32_t, S, INT32_MIN, INT32_MAX)                                         \
+    DEFINE_CONV(SN, ST, SK, uint32, uint32_t, U, 0, UINT32_MAX)                                              \
+    DEFINE_CONV(SN, ST, SK, int64, int64_t, S, INT64_MIN, INT64_MAX)                                         \
+    DEFINE_CONV(SN, ST, SK, uint64, uint64_t, U, 0, UINT64_MAX)                                              \
+    DEFINE_CONV(SN, ST, SK, float, float, F, -FLT_MAX, FLT_MAX)                                              \
+    DEFINE_CONV(SN, ST, SK, double, double, F, -DBL_MAX, DBL_MAX)
+
+DEFINE_CONVS_FROM(int8, int8_t, S)
+DEFINE_CONVS_FROM(uint8, uint8_t, U)
+DEFINE_CONVS_FROM(int16, int16_t, S)
+DEFINE_CONVS_FROM(uint16, uint16_t, U)
+DEFINE_CONVS_FROM(int32, int32_t, S)
+DEFINE_CONVS_FROM(uint32, uint32_t, U)
+DEFINE_CONVS_FROM(int64, int64_t, S)
+DEFINE_CONVS_FROM(uint64, uint64_t, U)
+DEFINE_CONVS_FROM(float, float, F)
+DEFINE_CONVS_FROM(double, double, F)
+
+#define CONV_NKINDS 10
+
+#define CONV_ROW(SN)                                                                                         \
+    {conv_##SN##_int8,   conv_##SN##_uint8, conv_##SN##_int16,  conv_##SN##_uint16, conv_##SN##_int32,      \
+     conv_##SN##_uint32, conv_##SN##_int64, conv_##SN##_uint64, conv_##SN##_float,  conv_##SN##_double}
+
+/* Indexed by the kinds of the file and memory types, in the order of the types in init_conv_types() */
+static const conv_func_t conv_funcs[CONV_NKINDS][CONV_NKINDS] = {
+    CONV_ROW(int8),   CONV_ROW(uint8), CONV_ROW(int16),  CONV_ROW(uint16), CONV_ROW(int32),
+    CONV_ROW(uint32), CONV_ROW(int64), CONV_ROW(uint64), CONV_ROW(float),  CONV_ROW(double)};
+
+/* Set by H5VL_bypass_init before any read, and only read afterwards.  Without it, the library
+ * converts the data itself. */
+static dtype_info_t conv_native_info[CONV_NKINDS];
+static bool         conv_native_ready = false;
+
+static herr_t
+run_io_task(Bypass_task_t *task)
+{
+    void  *io_buf    = task->vec_buf;
+    herr_t ret_value = 0;
+
+    /* Memory for storage not allocated in the file */
+    if (task->fill_size > 0) {
+        fill_pattern(task->vec_buf, task->size, task->fill_value, task->fill_size);
+        goto done;
+    }
+
+    /* Data to be converted is read into the staging buffer of this thread first, since the elements
+     * in the file and in memory may have different sizes */
+    if (task->read_data && task->conv_func) {
+        if ((io_buf = get_thread_buf(THREAD_BUF_STAGING, task->size)) == NULL) {
+            ret_value = -1;
+            goto done;
+        }
+    }
+
+    if (task->ext_fd >= 0) {
+        if (read_external_data(task->ext_fd, io_buf, task->size, (off_t)task->addr) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+    }
+    else if (task->iov) {
+        if (operate_vector_io(task->file->u.file.fd, task->iov, task->iovcnt, (off_t)task->addr, task->read_data) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+    }
+    else if (operate_data_io(task->file->u.file.fd, io_buf, task->size, task->addr, task->read_data) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if (!task->read_data)
+        start_writeback(task->file->u.file.fd, task->addr, task->size);
+
+    if (task->read_data && task->conv_func)
+        task->stage_buf = take_thread_buf(THREAD_BUF_STAGING, &task->stage_buf_size);
+
+done:
+    return ret_value;
+}
+
+static herr_t
+decode_task_data(Bypass_task_t *task)
+{
+    void *data = task->stage_buf ? task->stage_buf : task->vec_buf;
+    int   i;
+
+    /* No other task touches these elements.  Tasks put together are never converted. */
+    if (task->swap_size > 1 && task->iov) {
+        for (i = 0; i < task->iovcnt; i++)
+            swap_bytes(task->iov[i].iov_base, task->iov[i].iov_len / task->swap_size, task->swap_size);
+    }
+    else if (task->swap_size > 1)
+        swap_bytes(data, task->size / task->swap_size, task->swap_size);
+
+    if (task->conv_func)
+        task->conv_func(data, task->conv_buf, task->conv_nelmts);
+
+    /* Keep the staging buffer for the next tasks of this thread */
+    if (task->stage_buf) {
+        put_thread_buf(THREAD_BUF_STAGING, task->stage_buf, task->stage_buf_size);
+        task->stage_buf = NULL;
+    }
+
+    return 0;
+}
+
+/* Filtered chunks go through all three stages, one chunk per task: the I/O stage reads the stored
+ * chunk, the decoding stage undoes the filters and the scattering stage copies the selection out of
+ * it.  The buffers move along with the task and become the staging buffers of the thread taking the
+ * task, whose buffers go back to the stage before, so they keep being reused without being shared. */
+static herr_t
+run_task_stage(Bypass_task_t *task)
+{
+    chunk_xlate_t *xlate = task->xlate;
+    size_t         c     = task->first_chunk;
+    int            cur;
+    herr_t         ret_value = 0;
+
+    /* Chunks never written have nothing to decode, their selection just gets the fill value.  Chunks
+     * being written are put together and encoded by one task. */
+    if (xlate && xlate->cb_info.nfilters > 0 &&
+        (xlate->chunk_addrs[c] == HADDR_UNDEF || !xlate->selection_info.read_data))
+        ret_value = translate_chunk_partition(task);
+    else if (xlate && xlate->cb_info.nfilters > 0) {
+        switch (task->stage) {
+            case STAGE_IO:
+                if (read_chunk_stage(&xlate->selection_info, xlate->chunk_addrs[c], xlate->chunk_sizes[c]) < 0) {
+                    ret_value = -1;
+                    goto done;
+                }
+
+                task->stage_buf = take_thread_buf(THREAD_BUF_CHUNK, &task->stage_buf_size);
+                break;
+
+            case STAGE_DECODE:
+                put_thread_buf(THREAD_BUF_CHUNK, task->stage_buf, task->stage_buf_size);
+                task->stage_buf = NULL;
+
+                if ((cur = decode_chunk_stage(&xlate->cb_info, (size_t)xlate->chunk_sizes[c],
+                                              xlate->filter_masks[c])) < 0) {
+                    ret_value = -1;
+                    goto done;
+                }
+
+                task->stage_buf = take_thread_buf(cur, &task->stage_buf_size);
+                break;
+
+            default:
+                ret_value = scatter_chunk_stage(&xlate->cb_info, xlate->chunk_offsets + c * xlate->cb_info.dset_dim_rank,
+                                                xlate->chunk_addrs[c], task->stage_buf);
+
+                put_thread_buf(THREAD_BUF_DECODE, task->stage_buf, task->stage_buf_size);
+                task->stage_buf = NULL;
+                break;
+        }
+    } else if (xlate)
+        ret_value = translate_chunk_partition(task);
+    else if (task->stage == STAGE_IO)
+        ret_value = run_io_task(task);
+    else
+        ret_value = decode_task_data(task);
+
+done:
+    return ret_value;
+}
+
+static int
+next_task_stage(Bypass_task_t *task)
+{
+    bool filtered = task->xlate && task->xlate->cb_info.nfilters > 0 && task->xlate->selection_info.read_data &&
+                    task->xlate->chunk_addrs[task->first_chunk] != HADDR_UNDEF;
+
+    switch (task->stage) {
+        case STAGE_IO:
+            if (filtered || (!task->xlate && task->read_data && (task->swap_size > 1 || task->conv_func)))
+                return STAGE_DECODE;
+            break;
+
+        case STAGE_DECODE:
+            if (filtered)
+                return STAGE_SCATTER;
+            break;
+
+        default:
+            break;
+    }
+
+    return NSTAGES;
+}
+
+static herr_t
+run_task_stages(Bypass_task_t *task, bool all_stages)
+{
+    herr_t ret_value = 0;
+
+    do {
+        if (run_task_stage(task) < 0) {
+            /* The request learns about it when it's done waiting */
+            if (task->task_error_ptr)
+                atomic_fetch_add(task->task_error_ptr, 1);
+
+            task->stage = NSTAGES;
+            ret_value   = -1;
+            break;
+        }
+
+        task->stage = next_task_stage(task);
+    } while (task->stage < NSTAGES && (all_stages || nthreads_stage[task->stage] == 0));
+
+    return ret_value;
+}
+
+static void *
+get_thread_buf(int which, size_t size)
+{
+    if (thread_buf_sizes[which] < size) {
+        free(thread_bufs[which]);
+        thread_buf_sizes[which] = 0;
+
+        if ((thread_bufs[which] = malloc(size)) == NULL) {
+            fprintf(stderr, "failed to allocate staging buffer\n");
+            return NULL;
+        }
+
+        thread_buf_sizes[which] = size;
+    }
+
+    return thread_bufs[which];
+}
+
+static void *
+take_thread_buf(int which, size_t *size)
+{
+    void *buf = thread_bufs[which];
+
+    *size = thread_buf_sizes[which];
+
+    thread_bufs[which]      = NULL;
+    thread_buf_sizes[which] = 0;
+
+    pthread_mutex_lock(&spare_bufs_mutex);
+
+    if (nspare_bufs[which] > 0) {
+        nspare_bufs[which]--;
+
+        thread_bufs[which]      = spare_bufs[which][nspare_bufs[which]];
+        thread_buf_sizes[which] = spare_buf_sizes[which][nspare_bufs[which]];
+    }
+
+    pthread_mutex_unlock(&spare_bufs_mutex);
+
+    return buf;
+}
+
+static void
+put_thread_buf(int which, void *buf, size_t size)
+{
+    void  *old      = thread_bufs[which];
+    size_t old_size = thread_buf_sizes[which];
+
+    thread_bufs[which]      = buf;
+    thread_buf_sizes[which] = size;
+
+    /* Keep the buffer replaced for the threads of the stage the new one came from */
+    if (old) {
+        pthread_mutex_lock(&spare_bufs_mutex);
+
+        if (nspare_bufs[which] < THREAD_BUF_SPARES) {
+            spare_bufs[which][nspare_bufs[which]]      = old;
+            spare_buf_sizes[which][nspare_bufs[which]] = old_size;
+            nspare_bufs[which]++;
+            old = NULL;
+        }
+
+        pthread_mutex_unlock(&spare_bufs_mutex);
+
+        free(old);
+    }
+}
+
+static void
+release_thread_bufs(void)
+{
+    int i;
+
+    for (i = 0; i < THREAD_BUF_COUNT; i++) {
+        free(thread_bufs[i]);
+
+        thread_bufs[i]      = NULL;
+        thread_buf_sizes[i] = 0;
+    }
+}
+
+static void
+release_spare_bufs(void)
+{
+    int i;
+
+    pthread_mutex_lock(&spare_bufs_mutex);
+
+    for (i = 0; i < THREAD_BUF_COUNT; i++)
+        while (nspare_bufs[i] > 0)
+            free(spare_bufs[i][--nspare_bufs[i]]);
+
+    pthread_mutex_unlock(&spare_bufs_mutex);
+}
+
+static void *
+start_thread_for_pool(void *args)
+{
+    int thread_id = ((info_for_thread_t *)args)->thread_id;
+    int stage = ((info_for_thread_t *)args)->stage;
+    task_queue_t   *queue = stage_queues[stage];
+    pthread_cond_t *cond = stage_conds[stage];
+    void    *ret_value = (void*) 0;
+    Bypass_task_t **tasks = NULL; /* An array of tasks to be queued */
+    int      local_count = 0;
+    int      load_task_count = 0;
+    bool     forwarded;
+    int      i;
+
+    // fprintf(stderr, "In start_thread_for_pool: %d\n", thread_id);
+
+    if ((tasks = (Bypass_task_t **)malloc(nsteps_tpool * sizeof(Bypass_task_t*))) == NULL) {
+        fprintf(stderr, "failed to allocate a squence of tasks\n");
+        ret_value = (void*) -1;
+        goto done;
+    }
+
+    /* stop_tpool is only turned on in H5VL_bypass_term when the application finishes */
+    while (!stop_tpool) {
+        if (pthread_mutex_lock(&mutex_local) != 0) {
+            fprintf(stderr, "failed to lock mutex\n");
+            ret_value = (void*) -1;
+            goto done;
+        }
+
+	//fprintf(stderr, "\t%s: %d: thread %d before wait\n", __func__, __LINE__, thread_id);
+
+	/* If no tasks are available to work on, just wait.  Not sure if stop_tpool is useful. */
+        while (queue->tasks_in_queue == 0 && !stop_tpool) {
+            pthread_cond_wait(cond, &mutex_local);
+        }
+
+	//fprintf(stderr, "\t%s: %d: thread %d after wait\n", __func__, __LINE__, thread_id);
+
+        /* tasks_in_queue can be smaller (LEFTOVER being passed into
+         * submit_task() in process_vectors()) or larger (submit_task() keeps adding
+         * more before they are processed) than nsteps_tpool. Choose the smaller
+         * value */
+        local_count = MIN(queue->tasks_in_queue, nsteps_tpool);
+
+        for (i = 0; i < local_count; i++) {
+            /* Get the task in queue */
+            if ((tasks[i] = bypass_queue_pop(queue, false)) == NULL) {
+                fprintf(stderr, "failed to pop task from queue\n");
+                ret_value = (void*) -1;
+                goto done;
+            }
+
+            /* Only the I/O stage uses the file */
+            if (stage == STAGE_IO) {
+                tasks[i]->file->u.file.num_reads++;
+                tasks[i]->file->u.file.read_started = true;
+            }
+        }
+
+        if (pthread_mutex_unlock(&mutex_local) != 0) {
+            fprintf(stderr, "failed to unlock mutex\n");
+            ret_value = (void*) -1;
+            goto done;
+        }
+
+	//fprintf(stderr, "\t%s: %d: thread %d before reading data, local_count = %d\n", __func__, __LINE__, thread_id, local_count);
+
+	for (i = 0; i < local_count; i++) {
+	    if (run_task_stages(tasks[i], false) < 0) {
+	        fprintf(stderr, "task failed from stage %d within file %s, read_data = %d\n", stage, tasks[i]->file->u.file.name, tasks[i]->read_data);
+	        /* Return a failure code, but try to complete the rest of the read request.
+	         * This is important to properly decrement the reference count/num_reads on the local file object */
+	        ret_value = (void *)-1;
 	    }
-	}
 
-#ifdef TMP
-        /* Save the info for the C log file */
-        {
-	    if (pthread_mutex_lock(&mutex_local) != 0) {
-		fprintf(stderr, "failed to lock local mutex\n");
-		ret_value = -1;
-		goto done;
-	    }
+            if (pthread_mutex_lock(&mutex_local) != 0) {
+                fprintf(stderr, "failed to lock mutex\n");
+                ret_value = (void*) -1;
+                goto done;
+            }
+
+            if (stage == STAGE_IO)
+                tasks[i]->file->u.file.num_reads--;
+
+            /* Hand the task to the threads of its next stage.  Queuing it counts it again for the
+             * request, so the count can't drop to zero below while the task is in flight. */
+            forwarded = tasks[i]->stage < NSTAGES;
+
+            if (forwarded) {
+                if (bypass_queue_push(stage_queues[tasks[i]->stage], tasks[i], false) < 0) {
+                    fprintf(stderr, "failed to push task to the queue of stage %d\n", tasks[i]->stage);
+                    ret_value = (void*) -1;
+                    pthread_mutex_unlock(&mutex_local);
+                    goto done;
+                }
+
+                pthread_cond_signal(stage_conds[tasks[i]->stage]);
+            }
+
+	    //load_task_count = atomic_load(tasks[i]->task_count_ptr);
+	    //fprintf(stderr, "\t%s: %d: thread %d, i = %d load_task_count = %d\n", __func__, __LINE__, thread_id, i, load_task_count);
+
+	    /* Decrement the task count that this pointer points to */
+	    atomic_fetch_sub(tasks[i]->task_count_ptr, 1);
+
+	    load_task_count = atomic_load(tasks[i]->task_count_ptr);
+
+	    /* When the task count drops to zerp, notify the invoking thread to finish the dataset
+	     * read function.  Use the signal function instead of broadcast because it's notifying
+	     * one thread only.
+	     */
+	    if (load_task_count == 0)
+	        //pthread_cond_broadcast(tasks[i]->local_condition_ptr);
+	        pthread_cond_signal(tasks[i]->local_condition_ptr);
+
+	    //fprintf(stderr, "\t%s: %d: thread %d, i = %d, load_task_count = %d\n", __func__, __LINE__, thread_id, i, load_task_count);
+
+            /* When there is no task left in the queue and all the reads finish for
+             * the current file, signal the main process that this file can be closed.
+             */
+	    if (stage == STAGE_IO && (queue_for_tpool.tasks_in_queue == 0) && tasks[i]->file->u.file.num_reads == 0) {
+                /* There are currently no reads active on this file - it may be closed */
+                tasks[i]->file->u.file.read_started = false;
+
+                pthread_cond_broadcast(&(tasks[i]->file->u.file.close_ready));
+            }
+
+            if (pthread_mutex_unlock(&mutex_local) != 0) {
+                fprintf(stderr, "failed to unlock mutex\n");
+                ret_value = (void*) -1;
+                goto done;
+            }
+
+            /* The task lives on in the next stage, which may already be done with it */
+            if (forwarded) {
+                tasks[i] = NULL;
+                continue;
+            }
+
+            if (bypass_task_release(tasks[i]) < 0) {
+                fprintf(stderr, "failed to release task\n");
+                ret_value = (void*) -1;
+                goto done;
+            }
+
+            tasks[i] = NULL;
+        }
+    }
+
+done:
+    /* Attempt to clean up queue memory that we took ownership of */
+    if (ret_value < (void*) 0) {
+        fprintf(stderr, "thread idx %d in pool failed\n", thread_id);
+
+        for (i = 0; i < local_count; i++) {
+            if (tasks[i] != NULL) {
+                bypass_task_release(tasks[i]);
+                tasks[i] = NULL;
+            }
+        }
+    }
+
+    free(tasks);
+
+    release_thread_bufs();
+
+    return ret_value;
+} /* end start_thread_for_pool() */
+
+/* Create a task for one piece of I/O and append it to the queue.  With the thread pool, the pool is
+ * signaled each time nsteps_tpool tasks have accumulated; the caller keeps the count between calls. */
+static herr_t
+submit_io_task(task_queue_t *task_queue, sel_info_t *selection_info, haddr_t addr, size_t io_len,
+               void *buf, int *local_count_for_signal)
+{
+    Bypass_task_t *task = NULL;
+    herr_t         ret_value = 0;
+
+    /* The address is an offset in the data of the dataset, spread over its external files */
+    if (selection_info->external) {
+        ret_value = submit_external_io(task_queue, selection_info, (hsize_t)addr, io_len, buf, local_count_for_signal);
+        goto done;
+    }
+
+    /* Small writes are gathered into bigger ones, unless they're written behind.  Other writes mustn't
+     * be overwritten by older data still in the buffer of any handle of the file, and reads must see it. */
+    if (selection_info->file->u.file.agg_buf && !selection_info->read_data && !selection_info->write_behind &&
+        io_len <= write_agg_size / 4) {
+        ret_value = aggregate_write(selection_info->file, addr, buf, io_len);
+        goto done;
+    }
+
+    /* Reads only write out the buffers if they need their data */
+    if (atomic_load(&selection_info->file->u.file.shared->nagg) > 0 &&
+        order_write_agg(selection_info->file, addr, io_len, false) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((task = bypass_task_create(selection_info, addr, io_len, buf)) == NULL) {
+        fprintf(stderr, "Failed to assemble task while processing vectors\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* The application may reuse its buffer as soon as the write returns */
+    if (selection_info->write_behind && stage_write_behind(task) < 0) {
+        bypass_task_release(task);
+        ret_value = -1;
+        goto done;
+    }
+
+    ret_value = push_io_task(task_queue, task, local_count_for_signal);
+
+done:
+    return ret_value;
+} /* end submit_io_task() */
+
+/* The task is released if it can't be queued */
+static herr_t
+push_io_task(task_queue_t *task_queue, Bypass_task_t *task, int *local_count_for_signal)
+{
+    bool   locked = false;
+    herr_t ret_value = 0;
+
+    /* Any queue other than the pool's is private to the calling thread, like the one each thread
+     * uses if 'BYPASS_VOL_NO_TPOOL' is set */
+    if (task_queue != &queue_for_tpool) {
+        if (bypass_queue_push(task_queue, task, false) < 0) {
+            fprintf(stderr, "Failed to push task to queue\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        task = NULL;
+        goto done;
+    }
+
+    /* Lock in order to append a task to the task queue */
+    if (pthread_mutex_lock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to lock local mutex\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    locked = true;
+
+    if (bypass_queue_push(task_queue, task, false) < 0) {
+        fprintf(stderr, "Failed to push task to queue\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    task = NULL;
+    (*local_count_for_signal)++;
+
+    /* Let the queue accumulate nsteps_tpool entries then signal the thread pool
+     * to read them */
+    if (*local_count_for_signal >= nsteps_tpool) {
+        pthread_cond_broadcast(&cond_local);
+        *local_count_for_signal = 0;
+    }
+
+done:
+    if (locked && pthread_mutex_unlock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to unlock local mutex\n");
+        ret_value = -1;
+    }
+
+    if (task)
+        bypass_task_release(task);
+
+    return ret_value;
+} /* end push_io_task() */
+
+/* Copy the data of a task writing behind into a staging buffer, waiting until the buffers in use
+ * leave room for it.  A piece larger than the cap is let through alone. */
+static herr_t
+stage_write_behind(Bypass_task_t *task)
+{
+    void  *copy = NULL;
+    bool   locked = false;
+    herr_t ret_value = 0;
+
+    if (pthread_mutex_lock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to lock local mutex\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    locked = true;
+
+    while (write_behind_used > 0 && write_behind_used + task->size > write_behind_max) {
+        /* The tasks holding the space may still be waiting for the pool to be signaled */
+        pthread_cond_broadcast(&cond_local);
+        pthread_cond_wait(&write_behind_space_cond, &mutex_local);
+    }
+
+    write_behind_used += task->size;
+
+    pthread_mutex_unlock(&mutex_local);
+    locked = false;
+
+    if ((copy = malloc(task->size)) == NULL) {
+        fprintf(stderr, "failed to allocate staging buffer for writing behind\n");
+        release_write_behind_space(task->size);
+        ret_value = -1;
+        goto done;
+    }
+
+    memcpy(copy, task->vec_buf, task->size);
+
+    task->vec_buf = copy;
+    task->wb_size = task->size;
+
+done:
+    if (locked)
+        pthread_mutex_unlock(&mutex_local);
+
+    return ret_value;
+} /* end stage_write_behind() */
+
+static void
+release_write_behind_space(size_t size)
+{
+    pthread_mutex_lock(&mutex_local);
+
+    write_behind_used -= size;
+    pthread_cond_broadcast(&write_behind_space_cond);
+
+    pthread_mutex_unlock(&mutex_local);
+} /* end release_write_behind_space() */
+
+/* Barrier for the writes done behind to a dataset, through any of its handles: returns once the pool
+ * has written them all out.  Failures of those writes are reported here, since their H5Dwrite calls
+ * have long returned. */
+static herr_t
+wait_write_behind(Bypass_object_t *object)
+{
+    int    nerrors;
+    herr_t ret_value = 0;
+
+    if (write_behind_max == 0 || no_tpool)
+        goto done;
+
+    if (pthread_mutex_lock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to lock local mutex\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    while (atomic_load(&object->wb_tasks) > 0) {
+        /* Tasks queued by the last write may not have been signaled yet */
+        pthread_cond_broadcast(&cond_local);
+        pthread_cond_wait(&object->wb_cond, &mutex_local);
+    }
+
+    /* The pool only wakes one waiting thread */
+    pthread_cond_broadcast(&object->wb_cond);
+
+    pthread_mutex_unlock(&mutex_local);
+
+    if ((nerrors = atomic_exchange(&object->wb_errors, 0)) > 0) {
+        fprintf(stderr, "%d tasks writing behind failed\n", nerrors);
+        ret_value = -1;
+    }
+
+done:
+    return ret_value;
+} /* end wait_write_behind() */
+
+/* The datasets are waited for one at a time, each one kept by a reference while its writes go out,
+ * and looked for again from the start since the list may change meanwhile */
+static herr_t
+wait_file_write_behind(Bypass_shared_file_t *shared)
+{
+    Bypass_shared_file_t *f;
+    Bypass_object_t      *object;
+    herr_t                ret_value = 0;
+
+    if (write_behind_max == 0 || no_tpool)
+        return 0;
+
+    do {
+        object = NULL;
+
+        pthread_mutex_lock(&shared_files_mutex);
+
+        for (f = shared ? shared : shared_files; f; f = shared ? NULL : f->next) {
+            for (object = f->objects; object; object = object->next)
+                if (atomic_load(&object->wb_tasks) > 0 || atomic_load(&object->wb_errors) > 0)
+                    break;
+
+            if (object)
+                break;
+        }
+
+        if (object)
+            object->ref_count++;
+
+        pthread_mutex_unlock(&shared_files_mutex);
+
+        if (object) {
+            if (wait_write_behind(object) < 0)
+                ret_value = -1;
+
+            put_dset_object(f, object);
+        }
+    } while (object);
+
+    return ret_value;
+} /* end wait_file_write_behind() */
+
+/* The tasks writing behind may be done in any order, so a write overlapping pending writes of the
+ * same dataset, through any of its handles, must wait for them.  The pending writes are tracked by the
+ * box bounding them all. */
+static herr_t
+order_write_behind(Bypass_dataset_t *dset, hid_t file_space_id)
+{
+    Bypass_object_t *object = dset->object;
+    hsize_t start[H5S_MAX_RANK], end[H5S_MAX_RANK];
+    int     rank, d;
+    bool    overlap = true;
+    herr_t  ret_value = 0;
+
+    if ((rank = H5Sget_simple_extent_ndims(file_space_id)) < 0 || H5Sget_select_bounds(file_space_id, start, end) < 0) {
+        fprintf(stderr, "failed to get the bounds of the selection\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* The writes of the other handles of the dataset are queued under the lock as well, so none is
+     * pending once they're all done */
+    if (object->wb_pending && atomic_load(&object->wb_tasks) == 0)
+        object->wb_pending = false;
+
+    if (object->wb_pending) {
+        for (d = 0; d < rank; d++)
+            if (start[d] > object->wb_end[d] || end[d] < object->wb_start[d]) {
+                overlap = false;
+                break;
+            }
+
+        if (overlap) {
+            object->wb_pending = false;
+
+            if (wait_write_behind(object) < 0) {
+                ret_value = -1;
+                goto done;
+            }
+        }
+    }
+
+    for (d = 0; d < rank; d++) {
+        object->wb_start[d] = object->wb_pending ? MIN(object->wb_start[d], start[d]) : start[d];
+        object->wb_end[d]   = object->wb_pending ? MAX(object->wb_end[d], end[d]) : end[d];
+    }
+
+    object->wb_pending = true;
+
+done:
+    return ret_value;
+} /* end order_write_behind() */
+
+/* A write is added to the buffered data if it starts inside it or right after it.  When the buffer
+ * is full, the data is written out up to the last aligned boundary and the rest stays for the next
+ * appends.  Called by the thread translating the selection, which may be a thread of the pool. */
+static herr_t
+aggregate_write(H5VL_bypass_t *file, haddr_t addr, const void *buf, size_t len)
+{
+    Bypass_file_t  *f = &file->u.file;
+    struct timespec now;
+    long            age_ms;
+    herr_t          ret_value = 0;
+
+    /* The data buffered by another handle of the file is older */
+    if (atomic_load(&f->shared->nagg) > 1 && order_write_agg(file, addr, len, true) < 0)
+        return -1;
+
+    pthread_mutex_lock(&f->agg_mutex);
+
+    if (f->agg_len > 0 && (addr < f->agg_addr || addr > f->agg_addr + f->agg_len) && drain_write_agg(f, false) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if (f->agg_len > 0 && addr + len - f->agg_addr > write_agg_size) {
+        if (drain_write_agg(f, true) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
+        /* The write overlaps the part written out, or still doesn't fit */
+        if (f->agg_len > 0 && (addr < f->agg_addr || addr + len - f->agg_addr > write_agg_size) &&
+            drain_write_agg(f, false) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+    }
+
+    if (f->agg_len == 0) {
+        f->agg_addr = addr;
+        clock_gettime(CLOCK_MONOTONIC, &f->agg_time);
+    }
+
+    memcpy((uint8_t *)f->agg_buf + (addr - f->agg_addr), buf, len);
+    f->agg_len = MAX(f->agg_len, (size_t)(addr + len - f->agg_addr));
+
+    /* Data doesn't wait in the buffer longer than write_agg_ms while writes keep coming */
+    if (write_agg_ms > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        age_ms = (long)(now.tv_sec - f->agg_time.tv_sec) * 1000 + (now.tv_nsec - f->agg_time.tv_nsec) / 1000000;
+
+        if (age_ms >= write_agg_ms && drain_write_agg(f, false) < 0)
+            ret_value = -1;
+    }
+
+done:
+    pthread_mutex_unlock(&f->agg_mutex);
+
+    return ret_value;
+} /* end aggregate_write() */
+
+static herr_t
+drain_write_agg(Bypass_file_t *file, bool keep_tail)
+{
+    haddr_t end = file->agg_addr + file->agg_len;
+    size_t  nbytes;
+    herr_t  ret_value = 0;
+
+    if (keep_tail)
+        end -= end % WRITE_AGG_ALIGN;
+
+    if (file->agg_len == 0 || end <= file->agg_addr)
+        goto done;
+
+    nbytes = (size_t)(end - file->agg_addr);
+
+    /* The data can't be written again later, so it's dropped either way */
+    if (operate_data_io(file->fd, file->agg_buf, nbytes, (off_t)file->agg_addr, false) < 0) {
+        fprintf(stderr, "failed to write out aggregated writes\n");
+        ret_value = -1;
+    }
+    else
+        start_writeback(file->fd, file->agg_addr, nbytes);
+
+    memmove(file->agg_buf, (uint8_t *)file->agg_buf + nbytes, file->agg_len - nbytes);
+
+    file->agg_addr = end;
+    file->agg_len -= nbytes;
+
+done:
+    return ret_value;
+} /* end drain_write_agg() */
+
+/* The handles of the same file have a buffer each, all of them written out through their own file
+ * descriptors */
+static herr_t
+order_write_agg(H5VL_bypass_t *file, haddr_t addr, size_t len, bool others_only)
+{
+    Bypass_file_t *f;
+    herr_t         ret_value = 0;
+
+    pthread_mutex_lock(&write_agg_files_mutex);
+
+    for (f = write_agg_files; f; f = f->agg_next) {
+        if (f->shared != file->u.file.shared || (others_only && f == &file->u.file))
+            continue;
+
+        pthread_mutex_lock(&f->agg_mutex);
+
+        if (f->agg_len > 0 && addr < f->agg_addr + f->agg_len && addr + len > f->agg_addr &&
+            drain_write_agg(f, false) < 0)
+            ret_value = -1;
+
+        pthread_mutex_unlock(&f->agg_mutex);
+    }
+
+    pthread_mutex_unlock(&write_agg_files_mutex);
+
+    return ret_value;
+} /* end order_write_agg() */
+
+static herr_t
+flush_write_agg(H5VL_bypass_t *file)
+{
+    Bypass_file_t *f;
+    herr_t         ret_value = 0;
+
+    if (atomic_load(&file->u.file.shared->nagg) == 0)
+        return 0;
+
+    pthread_mutex_lock(&write_agg_files_mutex);
+
+    for (f = write_agg_files; f; f = f->agg_next) {
+        if (f->shared != file->u.file.shared)
+            continue;
+
+        pthread_mutex_lock(&f->agg_mutex);
+
+        if (drain_write_agg(f, false) < 0)
+            ret_value = -1;
+
+        pthread_mutex_unlock(&f->agg_mutex);
+    }
+
+    pthread_mutex_unlock(&write_agg_files_mutex);
+
+    return ret_value;
+} /* end flush_write_agg() */
+
+/* Another handle of the same file, or the library, may read the data buffered for a file */
+static herr_t
+flush_all_write_agg(void)
+{
+    Bypass_file_t *f;
+    herr_t         ret_value = 0;
+
+    if (write_agg_size == 0)
+        return 0;
+
+    pthread_mutex_lock(&write_agg_files_mutex);
+
+    for (f = write_agg_files; f; f = f->agg_next) {
+        pthread_mutex_lock(&f->agg_mutex);
+
+        if (drain_write_agg(f, false) < 0)
+            ret_value = -1;
+
+        pthread_mutex_unlock(&f->agg_mutex);
+    }
+
+    pthread_mutex_unlock(&write_agg_files_mutex);
+
+    return ret_value;
+} /* end flush_all_write_agg() */
+
+/* The ranges of a file stay few: one for each dataset written by the library since it was last
+ * flushed, grown to cover all the bytes written */
+static herr_t
+mark_dirty_range(H5VL_bypass_t *dset_obj, haddr_t start, haddr_t end)
+{
+    Bypass_shared_file_t *f = dset_obj->u.dataset.file->u.file.shared;
+    dirty_range_t        *range = NULL;
+    dirty_range_t        *new_ranges;
+    int                  n, i;
+    herr_t               ret_value = 0;
+
+    pthread_mutex_lock(&f->dirty_mutex);
+
+    n = atomic_load(&f->ndirty);
+
+    for (i = 0; i < n; i++)
+        if (f->dirty[i].dset->u.dataset.object == dset_obj->u.dataset.object) {
+            range = &f->dirty[i];
+            break;
+        }
+
+    if (range) {
+        if (range->start != HADDR_UNDEF && start != HADDR_UNDEF) {
+            range->start = MIN(range->start, start);
+            range->end   = MAX(range->end, end);
+        }
+        else
+            range->start = range->end = HADDR_UNDEF;
+
+        goto done;
+    }
+
+    if (n == f->dirty_cap) {
+        if ((new_ranges = (dirty_range_t *)realloc(f->dirty, (size_t)MAX(2 * n, 8) * sizeof(dirty_range_t))) == NULL) {
+            fprintf(stderr, "failed to grow list of dirty ranges\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        f->dirty     = new_ranges;
+        f->dirty_cap = MAX(2 * n, 8);
+    }
+
+    f->dirty[n].dset  = dset_obj;
+    f->dirty[n].start = start;
+    f->dirty[n].end   = (start == HADDR_UNDEF) ? HADDR_UNDEF : end;
+
+    atomic_store(&f->ndirty, n + 1);
+
+done:
+    pthread_mutex_unlock(&f->dirty_mutex);
+
+    return ret_value;
+} /* end mark_dirty_range() */
+
+static bool
+dirty_range_hit(H5VL_bypass_t *dset_obj, haddr_t addr, hsize_t size)
+{
+    Bypass_shared_file_t *f = dset_obj->u.dataset.file->u.file.shared;
+    bool                 hit = false;
+    int                  n, i;
+
+    if (atomic_load(&f->ndirty) == 0)
+        return false;
+
+    pthread_mutex_lock(&f->dirty_mutex);
+
+    n = atomic_load(&f->ndirty);
+
+    /* The range is found through any handle of the dataset, or by its bytes */
+    for (i = 0; i < n && !hit; i++)
+        hit = f->dirty[i].dset->u.dataset.object == dset_obj->u.dataset.object ||
+              (addr != HADDR_UNDEF && f->dirty[i].start != HADDR_UNDEF && f->dirty[i].start < addr + size &&
+               addr < f->dirty[i].end);
+
+    pthread_mutex_unlock(&f->dirty_mutex);
+
+    return hit;
+} /* end dirty_range_hit() */
+
+/* H5Dflush writes out the sieve buffer or the chunk cache of the dataset */
+static herr_t
+flush_dirty_ranges(H5VL_bypass_t *dset_obj, haddr_t addr, hsize_t size, hid_t dxpl_id, void **req)
+{
+    Bypass_shared_file_t *f = dset_obj->u.dataset.file->u.file.shared;
+    H5VL_dataset_specific_args_t args;
+    dirty_range_t        *range;
+    int                  n, i;
+    herr_t               ret_value = 0;
+
+    if (atomic_load(&f->ndirty) == 0)
+        return 0;
+
+    pthread_mutex_lock(&f->dirty_mutex);
+
+    n = atomic_load(&f->ndirty);
+
+    for (i = 0; i < n;) {
+        range = &f->dirty[i];
+
+        if (range->dset->u.dataset.object != dset_obj->u.dataset.object &&
+            (addr == HADDR_UNDEF || range->start == HADDR_UNDEF || range->start >= addr + size || addr >= range->end)) {
+            i++;
+            continue;
+        }
+
+        args.op_type            = H5VL_DATASET_FLUSH;
+        args.args.flush.dset_id = H5I_INVALID_HID;
+
+        if (H5VLdataset_specific(range->dset->under_object, range->dset->under_vol_id, &args, dxpl_id, req) < 0) {
+            fprintf(stderr, "unable to flush dataset\n");
+            ret_value = -1;
+            break;
+        }
+
+        /* The last range takes its place */
+        f->dirty[i] = f->dirty[--n];
+    }
+
+    atomic_store(&f->ndirty, n);
+
+    pthread_mutex_unlock(&f->dirty_mutex);
+
+    return ret_value;
+} /* end flush_dirty_ranges() */
+
+static void
+forget_dirty_range(H5VL_bypass_t *dset_obj)
+{
+    Bypass_shared_file_t *f = dset_obj->u.dataset.file->u.file.shared;
+    int                  n, i;
+
+    if (atomic_load(&f->ndirty) == 0)
+        return;
+
+    pthread_mutex_lock(&f->dirty_mutex);
+
+    n = atomic_load(&f->ndirty);
+
+    for (i = 0; i < n; i++)
+        if (f->dirty[i].dset->u.dataset.object == dset_obj->u.dataset.object) {
+            f->dirty[i] = f->dirty[--n];
+            break;
+        }
+
+    atomic_store(&f->ndirty, n);
+
+    pthread_mutex_unlock(&f->dirty_mutex);
+} /* end forget_dirty_range() */
+
+/* Group commit: each writer takes a number and waits until a sync covering it is done.  The first one
+ * finding no sync going on waits for the window, then syncs for all the numbers taken so far, while
+ * the writers coming later wait for the next sync. */
+static herr_t
+sync_file_data(Bypass_file_t *file)
+{
+    struct timespec window;
+    unsigned long   ticket, target;
+    int             status;
+    herr_t          ret_value = 0;
+
+    if (file->flags != O_RDWR)
+        return 0;
+
+    pthread_mutex_lock(&file->sync_mutex);
+
+    ticket = ++file->sync_requested;
+
+    while (file->sync_done < ticket) {
+        if (file->syncing) {
+            pthread_cond_wait(&file->sync_cond, &file->sync_mutex);
+            continue;
+        }
+
+        file->syncing = true;
+        pthread_mutex_unlock(&file->sync_mutex);
+
+        if (durability_window_ms > 0) {
+            window.tv_sec  = durability_window_ms / 1000;
+            window.tv_nsec = (durability_window_ms % 1000) * 1000000L;
+            nanosleep(&window, NULL);
+        }
+
+        pthread_mutex_lock(&file->sync_mutex);
+        target = file->sync_requested;
+        pthread_mutex_unlock(&file->sync_mutex);
+
+        do {
+            status = fdatasync(file->fd);
+        } while (status < 0 && errno == EINTR);
+
+        if (status < 0)
+            fprintf(stderr, "failed to sync file %s: %s\n", file->name, strerror(errno));
+
+        pthread_mutex_lock(&file->sync_mutex);
+
+        /* Pages which failed to be written may be dropped by the system, so later syncs can't tell */
+        if (status < 0)
+            file->sync_failed = true;
+
+        file->sync_done = target;
+        file->syncing   = false;
+        pthread_cond_broadcast(&file->sync_cond);
+    }
+
+    if (file->sync_failed)
+        ret_value = -1;
+
+    pthread_mutex_unlock(&file->sync_mutex);
+
+    return ret_value;
+} /* end sync_file_data() */
+
+static void
+start_writeback(int fd, haddr_t addr, size_t len)
+{
+#ifdef SYNC_FILE_RANGE_WRITE
+    /* Only a hint: the sync still waits for the data either way */
+    if (durability != DURABILITY_NONE && len > 0)
+        (void)sync_file_range(fd, (off_t)addr, (off_t)len, SYNC_FILE_RANGE_WRITE);
+#endif
+} /* end start_writeback() */
+
+/* The blocks of the whole dataset are reserved at once, instead of by each thread writing its part,
+ * without changing the size of the file the library keeps track of */
+static void
+preallocate_dset(H5VL_bypass_t *dset_obj, haddr_t addr)
+{
+    Bypass_dataset_t *dset = &dset_obj->u.dataset;
+    hssize_t          npoints;
+    hsize_t           size;
+
+    if (prealloc_min == 0 || dset->preallocated)
+        return;
+
+    dset->preallocated = true;
+
+    if ((npoints = H5Sget_simple_extent_npoints(dset->space_id)) <= 0)
+        return;
+
+    size = (hsize_t)npoints * dset->dtype_info.size;
+
+    if (size < prealloc_min)
+        return;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    /* Not all file systems support it, and the writes allocate the blocks anyway */
+    (void)fallocate(dset->file->u.file.fd, FALLOC_FL_KEEP_SIZE, (off_t)addr, (off_t)size);
+#endif
+} /* end preallocate_dset() */
+
+/* The selection is followed by its bounds.  Reads moving by the same delta twice in a row make a
+ * strided pattern, and a first move by the extent of the selection along one dimension a sequential
+ * one, such as blocks of rows read one after the other. */
+static void
+track_read_pattern(H5VL_bypass_t *dset_obj, const Bypass_dset_snapshot_t *snapshot, const hsize_t *start,
+                   const hsize_t *end)
+{
+    Bypass_dataset_t *dset = &dset_obj->u.dataset;
+    hsize_t           next_start[DIM_RANK_MAX], next_end[DIM_RANK_MAX];
+    hssize_t          delta;
+    bool              same_extent, same_delta, predicted = false;
+    int               nmoved = 0, moved_dim = -1;
+    int               d;
+
+    /* Filtered chunks and storage not allocated have no snapshot to map the next selection with */
+    if (prefetch_max == 0 || snapshot == NULL || !snapshot->usable || snapshot->layout == H5D_COMPACT ||
+        snapshot->external)
+        return;
+
+    pthread_mutex_lock(&dset->pattern_mutex);
+
+    same_extent = dset->pattern_rank == snapshot->rank;
+
+    for (d = 0; d < snapshot->rank && same_extent; d++)
+        same_extent = end[d] - start[d] == dset->pattern_end[d] - dset->pattern_start[d];
+
+    if (same_extent) {
+        same_delta = dset->pattern_hits > 0;
+
+        for (d = 0; d < snapshot->rank; d++) {
+            delta = (hssize_t)start[d] - (hssize_t)dset->pattern_start[d];
+
+            if (delta != dset->pattern_delta[d])
+                same_delta = false;
+
+            if (delta != 0) {
+                nmoved++;
+                moved_dim = d;
+            }
+
+            dset->pattern_delta[d] = delta;
+        }
+
+        if (nmoved == 0)
+            dset->pattern_hits = 0;
+        else
+            dset->pattern_hits = same_delta ? dset->pattern_hits + 1 : 1;
+
+        predicted = dset->pattern_hits >= 2 ||
+                    (dset->pattern_hits == 1 && nmoved == 1 &&
+                     dset->pattern_delta[moved_dim] == (hssize_t)(end[moved_dim] - start[moved_dim] + 1));
+    }
+    else
+        dset->pattern_hits = 0;
+
+    dset->pattern_rank = snapshot->rank;
+    memcpy(dset->pattern_start, start, (size_t)snapshot->rank * sizeof(hsize_t));
+    memcpy(dset->pattern_end, end, (size_t)snapshot->rank * sizeof(hsize_t));
+
+    /* The next selection must be inside the dataset */
+    for (d = 0; d < snapshot->rank && predicted; d++) {
+        if ((hssize_t)start[d] + dset->pattern_delta[d] < 0 ||
+            (hssize_t)end[d] + dset->pattern_delta[d] >= (hssize_t)snapshot->dims[d])
+            predicted = false;
+
+        next_start[d] = (hsize_t)((hssize_t)start[d] + dset->pattern_delta[d]);
+        next_end[d]   = (hsize_t)((hssize_t)end[d] + dset->pattern_delta[d]);
+    }
+
+    pthread_mutex_unlock(&dset->pattern_mutex);
+
+    if (predicted)
+        prefetch_box(&dset->file->u.file, snapshot, next_start, next_end);
+} /* end track_read_pattern() */
+
+/* The page cache of the system is the prefetch buffer, so nothing is kept by the connector and the
+ * hint is bounded by "BYPASS_VOL_PREFETCH".  A contiguous dataset is prefetched from the first to the
+ * last byte of the box, unless that's more than the bound.  The chunks of a chunked dataset covered by
+ * the box are prefetched in the order of the chunk grid until the bound is reached, the chunks
+ * following each other in the file in one hint. */
+static void
+prefetch_box(Bypass_file_t *file, const Bypass_dset_snapshot_t *snapshot, const hsize_t *start, const hsize_t *end)
+{
+#ifdef POSIX_FADV_WILLNEED
+    hsize_t first_idx[DIM_RANK_MAX], last_idx[DIM_RANK_MAX], idx[DIM_RANK_MAX];
+    hsize_t lo = 0, hi = 0, grid_idx;
+    haddr_t run_addr = HADDR_UNDEF, chunk_addr;
+    size_t  run_len = 0, chunk_nbytes = snapshot->dtype_info.size, total = 0;
+    int     d;
+
+    if (H5D_CONTIGUOUS == snapshot->layout) {
+        for (d = 0; d < snapshot->rank; d++) {
+            lo = lo * snapshot->dims[d] + start[d];
+            hi = hi * snapshot->dims[d] + end[d];
+        }
+
+        if ((hi - lo + 1) * snapshot->dtype_info.size <= prefetch_max)
+            (void)posix_fadvise(file->fd, (off_t)(snapshot->addr + lo * snapshot->dtype_info.size),
+                                (off_t)((hi - lo + 1) * snapshot->dtype_info.size), POSIX_FADV_WILLNEED);
+
+        return;
+    }
+
+    for (d = 0; d < snapshot->rank; d++) {
+        chunk_nbytes *= snapshot->chunk_dims[d];
+        first_idx[d] = start[d] / snapshot->chunk_dims[d];
+        last_idx[d]  = end[d] / snapshot->chunk_dims[d];
+        idx[d]       = first_idx[d];
+    }
+
+    do {
+        grid_idx = 0;
+
+        for (d = 0; d < snapshot->rank; d++)
+            grid_idx = grid_idx * snapshot->grid_dims[d] + idx[d];
+
+        chunk_addr = snapshot->chunk_addrs[grid_idx];
+
+        if (total + chunk_nbytes > prefetch_max)
+            break;
+
+        /* Chunks not allocated are filled without reading the file */
+        if (chunk_addr == HADDR_UNDEF)
+            goto next;
+
+        total += chunk_nbytes;
+
+        if (run_addr != HADDR_UNDEF && run_addr + run_len == chunk_addr)
+            run_len += chunk_nbytes;
+        else {
+            if (run_addr != HADDR_UNDEF)
+                (void)posix_fadvise(file->fd, (off_t)run_addr, (off_t)run_len, POSIX_FADV_WILLNEED);
+
+            run_addr = chunk_addr;
+            run_len  = chunk_nbytes;
+        }
+
+next:
+        for (d = snapshot->rank - 1; d >= 0; d--) {
+            if (++idx[d] <= last_idx[d])
+                break;
+
+            idx[d] = first_idx[d];
+        }
+    } while (d >= 0);
+
+    if (run_addr != HADDR_UNDEF)
+        (void)posix_fadvise(file->fd, (off_t)run_addr, (off_t)run_len, POSIX_FADV_WILLNEED);
+#endif
+} /* end prefetch_box() */
+
+/* The fill value is already in the memory datatype, so the tasks neither swap nor convert anything */
+static herr_t
+submit_fill_run(task_queue_t *task_queue, sel_info_t *selection_info, void *buf, size_t nbytes,
+                int *local_count_for_signal)
+{
+    Bypass_task_t *task = NULL;
+    size_t         fill_size = selection_info->fill_size;
+    size_t         len;
+    herr_t         ret_value = 0;
+
+    while (nbytes > 0) {
+        len = MIN(nbytes, (size_t)MAX(nelmts_max - nelmts_max % fill_size, fill_size));
+
+        if ((task = bypass_task_create(selection_info, HADDR_UNDEF, len, buf)) == NULL) {
+            fprintf(stderr, "Failed to assemble fill task\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        task->swap_size   = 0;
+        task->conv_func   = NULL;
+        task->conv_buf    = NULL;
+        task->conv_nelmts = 0;
+        task->fill_size   = fill_size;
+        memcpy(task->fill_value, selection_info->fill_value, fill_size);
+
+        if (push_io_task(task_queue, task, local_count_for_signal) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
+        buf     = (uint8_t *)buf + len;
+        nbytes -= len;
+    }
+
+done:
+    return ret_value;
+} /* end submit_fill_run() */
+
+static herr_t
+submit_fill_selection(task_queue_t *task_queue, void *buf, hid_t mem_space_id, sel_info_t *selection_info)
+{
+    hid_t    mem_iter_id = H5I_INVALID_HID;
+    hssize_t hss_nelmts;
+    size_t   nelmts, seq_nelem, nseq, i;
+    hsize_t  mem_off[SEL_SEQ_LIST_LEN];
+    size_t   mem_len[SEL_SEQ_LIST_LEN];
+    int      local_count_for_signal = 0;
+    herr_t   ret_value = 0;
+
+    if ((hss_nelmts = H5Sget_select_npoints(mem_space_id)) < 0) {
+        fprintf(stderr, "H5Sget_select_npoints on memspace failed\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    nelmts = (size_t)hss_nelmts;
+
+    if ((mem_iter_id = H5Ssel_iter_create(mem_space_id, selection_info->fill_size,
+                                          H5S_SEL_ITER_SHARE_WITH_DATASPACE)) < 0) {
+        fprintf(stderr, "H5Ssel_iter_create on memspace failed\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    while (nelmts > 0) {
+        if (H5Ssel_iter_get_seq_list(mem_iter_id, SEL_SEQ_LIST_LEN, SIZE_MAX, &nseq, &seq_nelem, mem_off,
+                                     mem_len) < 0) {
+            fprintf(stderr, "memory sequence length retrieval failed\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if (nseq == 0) {
+            fprintf(stderr, "no memory sequences retrieved from iteration\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        for (i = 0; i < nseq; i++)
+            if (submit_fill_run(task_queue, selection_info, (uint8_t *)buf + mem_off[i], mem_len[i],
+                                &local_count_for_signal) < 0) {
+                ret_value = -1;
+                goto done;
+            }
+
+        nelmts -= MIN(seq_nelem, nelmts);
+    }
+
+done:
+    /* Tasks already queued must be processed even on failure, since the caller waits for them */
+    if (signal_leftover_tasks(local_count_for_signal) < 0)
+        ret_value = -1;
+
+    if (mem_iter_id >= 0 && H5Ssel_iter_close(mem_iter_id) < 0) {
+        fprintf(stderr, "failed to close mem sel iterator\n");
+        ret_value = -1;
+    }
+
+    return ret_value;
+} /* end submit_fill_selection() */
+
+/* Values made of one repeated byte, zero most of the time, are set with memset().  Others are
+ * written once and then doubled with memcpy(), both vectorized by the C library. */
+static void
+fill_pattern(void *buf, size_t nbytes, const void *value, size_t size)
+{
+    const unsigned char *v = (const unsigned char *)value;
+    unsigned char       *b = (unsigned char *)buf;
+    size_t               filled, len;
+    size_t               i;
+
+    for (i = 1; i < size && v[i] == v[0]; i++)
+        ;
+
+    if (i >= size) {
+        memset(buf, v[0], nbytes);
+        return;
+    }
+
+    filled = MIN(size, nbytes);
+    memcpy(b, v, filled);
+
+    while (filled < nbytes) {
+        len = MIN(filled, nbytes - filled);
+        memcpy(b + filled, b, len);
+        filled += len;
+    }
+} /* end fill_pattern() */
+
+/* The library reads unallocated storage the same way: nothing is written into the application's
+ * buffer if the fill time is H5D_FILL_TIME_NEVER or there's no fill value, otherwise it gets the
+ * fill value, zeros by default.  Called with the global lock of the library. */
+static herr_t
+get_read_fill_value(Bypass_dataset_t *dset, hid_t mem_type_id, sel_info_t *selection_info)
+{
+    herr_t ret_value = 0;
+
+    selection_info->fill_size = 0;
+
+    if (dset->fill_time == H5D_FILL_TIME_NEVER || dset->fill_status == H5D_FILL_VALUE_UNDEFINED)
+        goto done;
+
+    if (selection_info->mem_dtype_size == 0 || selection_info->mem_dtype_size > FILL_VALUE_MAX) {
+        fprintf(stderr, "fill value of %zu bytes is too big\n", selection_info->mem_dtype_size);
+        ret_value = -1;
+        goto done;
+    }
+
+    /* The library converts the value to the memory datatype */
+    if (H5Pget_fill_value(dset->dcpl_id, mem_type_id, selection_info->fill_value) < 0) {
+        fprintf(stderr, "unable to get fill value of dataset\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    selection_info->fill_size = selection_info->mem_dtype_size;
+
+done:
+    return ret_value;
+} /* end get_read_fill_value() */
+
+/* Like in the library, the prefix is taken from the environment (HDF5_EXTFILE_PREFIX or
+ * HDF5_VDS_PREFIX) or else from the access property list of the dataset, and "${ORIGIN}" stands for
+ * the directory of the HDF5 file.  An empty prefix means the current directory. */
+static htri_t
+get_file_prefix(H5VL_bypass_t *dset_obj, bool vds_prefix, char *prefix, size_t size, hid_t dxpl_id, void **req)
+{
+    H5VL_dataset_get_args_t get_args;
+    hid_t       dapl_id = H5I_INVALID_HID;
+    const char *env_prefix = getenv(vds_prefix ? "HDF5_VDS_PREFIX" : "HDF5_EXTFILE_PREFIX");
+    const char *origin = "${ORIGIN}";
+    char        dir[PATH_MAX];
+    char        path[PATH_MAX];
+    ssize_t     prefix_len;
+    htri_t      ret_value = true;
+
+    prefix[0] = '\0';
+
+    if (env_prefix && *env_prefix)
+        snprintf(prefix, size, "%s", env_prefix);
+    else {
+        get_args.op_type               = H5VL_DATASET_GET_DAPL;
+        get_args.args.get_dapl.dapl_id = H5I_INVALID_HID;
+
+        if (H5VLdataset_get(dset_obj->under_object, dset_obj->under_vol_id, &get_args, dxpl_id, req) < 0) {
+            fprintf(stderr, "unable to get dataset's DAPL\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        dapl_id = get_args.args.get_dapl.dapl_id;
+
+        if ((prefix_len = vds_prefix ? H5Pget_virtual_prefix(dapl_id, prefix, size)
+                                     : H5Pget_efile_prefix(dapl_id, prefix, size)) < 0) {
+            fprintf(stderr, "unable to get file prefix of dataset\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if ((size_t)prefix_len >= size) {
+            ret_value = false;
+            goto done;
+        }
+    }
+
+    if (strncmp(prefix, origin, strlen(origin)) == 0) {
+        get_file_dir(dset_obj->u.dataset.file->u.file.name, dir, sizeof(dir));
+        snprintf(path, sizeof(path), "%s%s", dir, prefix + strlen(origin));
+        snprintf(prefix, size, "%s", path);
+    }
+
+    if (strcmp(prefix, ".") == 0)
+        prefix[0] = '\0';
+
+done:
+    if (dapl_id > 0 && H5Pclose(dapl_id) < 0) {
+        fprintf(stderr, "unable to close dataset's DAPL\n");
+        ret_value = -1;
+    }
+
+    return ret_value;
+} /* end get_file_prefix() */
+
+static void
+get_file_dir(const char *file_name, char *dir, size_t size)
+{
+    char *slash;
+
+    snprintf(dir, size, "%s", file_name);
+
+    if ((slash = strrchr(dir, '/')) == NULL)
+        snprintf(dir, size, ".");
+    else
+        slash[slash == dir ? 1 : 0] = '\0';
+} /* end get_file_dir() */
+
+static void
+combine_file_path(const char *prefix, const char *name, char *path, size_t size)
+{
+    size_t len = strlen(prefix);
+
+    if (len == 0 || name[0] == '/')
+        snprintf(path, size, "%s", name);
+    else
+        snprintf(path, size, "%s%s%s", prefix, prefix[len - 1] == '/' ? "" : "/", name);
+} /* end combine_file_path() */
+
+/* The names of the external files are relative to the prefix of the dataset, or to the current
+ * directory without one */
+static htri_t
+open_external_files(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req)
+{
+    Bypass_dataset_t       *dset = &dset_obj->u.dataset;
+    external_seg_t         *segs = NULL;
+    char        prefix[PATH_MAX];
+    char        name[PATH_MAX];
+    char        path[PATH_MAX];
+    hsize_t     start = 0;
+    int         i;
+    htri_t      ret_value = true;
+
+    if (dset->external)
+        goto done;
+
+    if ((ret_value = get_file_prefix(dset_obj, false, prefix, sizeof(prefix), dxpl_id, req)) <= 0)
+        goto done;
+
+    if ((segs = (external_seg_t *)calloc((size_t)dset->num_external, sizeof(external_seg_t))) == NULL) {
+        fprintf(stderr, "failed to allocate external file list\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    for (i = 0; i < dset->num_external; i++)
+        segs[i].fd = -1;
+
+    for (i = 0; i < dset->num_external; i++) {
+        if (H5Pget_external(dset->dcpl_id, (unsigned)i, sizeof(name), name, &segs[i].offset, &segs[i].size) < 0) {
+            fprintf(stderr, "unable to get external file of dataset\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        name[sizeof(name) - 1] = '\0';
+        combine_file_path(prefix, name, path, sizeof(path));
+
+        if ((segs[i].fd = open(path, O_RDONLY)) < 0) {
+            ret_value = false;
+            goto done;
+        }
+
+        segs[i].start = start;
+        start += segs[i].size;
+    }
+
+    /* Only reads go through the Bypass VOL, so the list never changes once it's opened */
+    dset->external = segs;
+    segs = NULL;
+
+done:
+    if (segs) {
+        for (i = 0; i < dset->num_external; i++)
+            if (segs[i].fd >= 0)
+                close(segs[i].fd);
+
+        free(segs);
+    }
+
+    return ret_value;
+} /* end open_external_files() */
+
+static void
+close_external_files(Bypass_dataset_t *dset)
+{
+    int i;
+
+    if (dset->external == NULL)
+        return;
+
+    for (i = 0; i < dset->num_external; i++)
+        close(dset->external[i].fd);
+
+    free(dset->external);
+    dset->external = NULL;
+} /* end close_external_files() */
+
+/* Each task reads from a single file.  The segment sizes are multiples of the element size, so the
+ * pieces keep whole elements for swapping or converting them. */
+static herr_t
+submit_external_io(task_queue_t *task_queue, sel_info_t *selection_info, hsize_t off, size_t io_len, void *buf,
+                   int *local_count_for_signal)
+{
+    const external_seg_t *seg;
+    Bypass_task_t        *task = NULL;
+    size_t                len;
+    int                   i;
+    herr_t                ret_value = 0;
+
+    for (i = 0; i < selection_info->num_external && io_len > 0; i++) {
+        seg = &selection_info->external[i];
+
+        if (seg->size != H5F_UNLIMITED && off >= seg->start + seg->size)
+            continue;
+
+        len = io_len;
+
+        if (seg->size != H5F_UNLIMITED)
+            len = (size_t)MIN((hsize_t)io_len, seg->start + seg->size - off);
+
+        if ((task = bypass_task_create(selection_info, (haddr_t)(seg->offset + (off_t)(off - seg->start)), len,
+                                       buf)) == NULL) {
+            fprintf(stderr, "Failed to assemble task for external file\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        task->ext_fd = seg->fd;
+
+        if (push_io_task(task_queue, task, local_count_for_signal) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
+        off    += len;
+        io_len -= len;
+        buf     = (void *)((uint8_t *)buf + len);
+    }
+
+    if (io_len > 0) {
+        fprintf(stderr, "selection is past the end of the external files\n");
+        ret_value = -1;
+        goto done;
+    }
+
+done:
+    return ret_value;
+} /* end submit_external_io() */
+
+/* The library reads zeros where an external file is shorter than its segment */
+static herr_t
+read_external_data(int fd, void *buf, size_t size, off_t offset)
+{
+    struct stat sb;
+    size_t      nread = size;
+    herr_t      ret_value = 0;
+
+    if (fstat(fd, &sb) < 0) {
+        fprintf(stderr, "failed to get the size of external file: %s\n", strerror(errno));
+        ret_value = -1;
+        goto done;
+    }
+
+    if (offset >= sb.st_size)
+        nread = 0;
+    else if ((off_t)size > sb.st_size - offset)
+        nread = (size_t)(sb.st_size - offset);
+
+    if (nread > 0 && operate_data_io(fd, buf, nread, offset, true) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if (nread < size)
+        memset((uint8_t *)buf + nread, 0, size - nread);
+
+done:
+    return ret_value;
+} /* end read_external_data() */
+
+/* Mappings whose file or dataset names are printf-style, or whose selections are unlimited, are left
+ * to the library, and so is the whole virtual dataset.  So are sources which can't be opened, since
+ * the library reads them as the fill value.  Each source file is opened once through the Bypass VOL,
+ * found like the library does: with the prefix of the dataset, then in the directory of the virtual
+ * dataset's file, then as it's named. */
+static herr_t
+resolve_vds_sources(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req)
+{
+    Bypass_dataset_t     *dset = &dset_obj->u.dataset;
+    H5VL_bypass_t        *vds_file = dset->file;
+    H5VL_bypass_t        *loc_obj;
+    vds_source_t         *sources = NULL;
+    vds_source_t         *src;
+    H5VL_file_get_args_t  file_args;
+    H5VL_bypass_info_t    info;
+    H5VL_loc_params_t     loc_params;
+    hid_t    fapl_id = H5I_INVALID_HID;
+    hid_t    bypass_id = H5I_INVALID_HID;
+    hid_t    space_id;
+    char     prefix[PATH_MAX];
+    char     vds_dir[PATH_MAX];
+    char     file_name[PATH_MAX];
+    char     dset_name[BYPASS_NAME_SIZE_LONG];
+    char     path[PATH_MAX];
+    hsize_t  start[DIM_RANK_MAX], stride[DIM_RANK_MAX], count[DIM_RANK_MAX], block[DIM_RANK_MAX];
+    hsize_t  src_dims[DIM_RANK_MAX], dims[DIM_RANK_MAX];
+    size_t   nmappings = 0, i;
+    ssize_t  name_len;
+    int      nsources = 0;
+    int      rank, src_rank, d, k;
+    htri_t   status;
+    herr_t   ret_value = 0;
+
+    dset->vds_resolved = true;
+
+    if (H5Pget_virtual_count(dset->dcpl_id, &nmappings) < 0) {
+        fprintf(stderr, "unable to get number of virtual dataset mappings\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (nmappings == 0 || nmappings > INT_MAX)
+        goto done;
+
+    if ((sources = (vds_source_t *)calloc(nmappings, sizeof(vds_source_t))) == NULL) {
+        fprintf(stderr, "failed to allocate virtual dataset sources\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((status = get_file_prefix(dset_obj, true, prefix, sizeof(prefix), dxpl_id, req)) <= 0) {
+        ret_value = (herr_t)status;
+        goto done;
+    }
+
+    get_file_dir(vds_file->u.file.name, vds_dir, sizeof(vds_dir));
+
+    loc_params.obj_type = H5I_FILE;
+    loc_params.type     = H5VL_OBJECT_BY_SELF;
+
+    for (i = 0; i < nmappings; i++) {
+        src = &sources[nsources];
+
+        if ((src->vspace_id = H5Pget_virtual_vspace(dset->dcpl_id, i)) < 0 ||
+            (src->src_space_id = H5Pget_virtual_srcspace(dset->dcpl_id, i)) < 0) {
+            fprintf(stderr, "unable to get selections of virtual dataset mapping\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if ((name_len = H5Pget_virtual_filename(dset->dcpl_id, i, file_name, sizeof(file_name))) < 0 ||
+            H5Pget_virtual_dsetname(dset->dcpl_id, i, dset_name, sizeof(dset_name)) < 0) {
+            fprintf(stderr, "unable to get source of virtual dataset mapping\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if ((size_t)name_len >= sizeof(file_name) || strchr(file_name, '%') || strchr(dset_name, '%'))
+            goto done;
+
+        if ((status = H5Sis_regular_hyperslab(src->vspace_id)) < 0) {
+            fprintf(stderr, "unable to check virtual dataset mapping\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if (status > 0) {
+            if ((rank = H5Sget_simple_extent_ndims(src->vspace_id)) < 0 || rank > DIM_RANK_MAX ||
+                H5Sget_regular_hyperslab(src->vspace_id, start, stride, count, block) < 0) {
+                fprintf(stderr, "unable to get selection of virtual dataset mapping\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            for (d = 0; d < rank; d++)
+                if (count[d] == H5S_UNLIMITED || block[d] == H5S_UNLIMITED)
+                    goto done;
+        }
+
+        /* "." is the file of the virtual dataset */
+        loc_obj = vds_file;
+
+        if (strcmp(file_name, ".") != 0) {
+            path[0] = '\0';
+
+            if (file_name[0] == '/')
+                snprintf(path, sizeof(path), "%s", file_name);
+            else {
+                if (prefix[0] != '\0')
+                    combine_file_path(prefix, file_name, path, sizeof(path));
+
+                if (path[0] == '\0' || access(path, R_OK) != 0)
+                    combine_file_path(vds_dir, file_name, path, sizeof(path));
+
+                if (access(path, R_OK) != 0)
+                    snprintf(path, sizeof(path), "%s", file_name);
+            }
+
+            if (access(path, R_OK) != 0)
+                goto done;
+
+            for (k = 0, loc_obj = NULL; k < nsources && !loc_obj; k++)
+                if (sources[k].file && strcmp(sources[k].file->u.file.name, path) == 0)
+                    loc_obj = sources[k].file;
+
+            if (!loc_obj) {
+                /* The source files are opened with the access properties of the virtual dataset's file */
+                if (fapl_id == H5I_INVALID_HID) {
+                    file_args.op_type               = H5VL_FILE_GET_FAPL;
+                    file_args.args.get_fapl.fapl_id = H5I_INVALID_HID;
+
+                    if (H5VLfile_get(vds_file->under_object, vds_file->under_vol_id, &file_args, dxpl_id, req) < 0) {
+                        fprintf(stderr, "unable to get FAPL of virtual dataset's file\n");
+                        ret_value = -1;
+                        goto done;
+                    }
+
+                    fapl_id = file_args.args.get_fapl.fapl_id;
+
+                    if ((bypass_id = H5VLget_connector_id_by_value(H5VL_BYPASS_VALUE)) < 0) {
+                        fprintf(stderr, "unable to get ID of the Bypass VOL\n");
+                        ret_value = -1;
+                        goto done;
+                    }
+
+                    info.under_vol_id   = vds_file->under_vol_id;
+                    info.under_vol_info = NULL;
+
+                    if (H5Pset_vol(fapl_id, bypass_id, &info) < 0) {
+                        fprintf(stderr, "unable to set VOL info in FAPL\n");
+                        ret_value = -1;
+                        goto done;
+                    }
+                }
+
+                H5E_BEGIN_TRY {
+                    src->file = (H5VL_bypass_t *)H5VL_bypass_file_open(path, H5F_ACC_RDONLY, fapl_id, dxpl_id, NULL);
+                } H5E_END_TRY;
+
+                if ((loc_obj = src->file) == NULL)
+                    goto done;
+            }
+        }
+
+        H5E_BEGIN_TRY {
+            src->dset = (H5VL_bypass_t *)H5VL_bypass_dataset_open(loc_obj, &loc_params, dset_name,
+                                                                  H5P_DATASET_ACCESS_DEFAULT, dxpl_id, NULL);
+        } H5E_END_TRY;
+
+        if (src->dset == NULL)
+            goto done;
+
+        /* The source selections are mapped to the sources as they are now */
+        if ((rank = H5Sget_simple_extent_dims(src->src_space_id, dims, NULL)) < 0 ||
+            (src_rank = H5Sget_simple_extent_dims(src->dset->u.dataset.space_id, src_dims, NULL)) < 0) {
+            fprintf(stderr, "unable to get extent of source dataset\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if (rank != src_rank)
+            goto done;
+
+        for (d = 0; d < rank && dims[d] == src_dims[d]; d++)
+            ;
+
+        if (d < rank) {
+            if ((space_id = H5Scopy(src->dset->u.dataset.space_id)) < 0) {
+                fprintf(stderr, "unable to copy dataspace of source dataset\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if (H5Sselect_copy(space_id, src->src_space_id) < 0 || (status = H5Sselect_valid(space_id)) < 0) {
+                fprintf(stderr, "unable to copy selection of virtual dataset mapping\n");
+                H5Sclose(space_id);
+                ret_value = -1;
+                goto done;
+            }
+
+            H5Sclose(src->src_space_id);
+            src->src_space_id = space_id;
+
+            /* Part of the mapping is beyond the end of the source and reads as the fill value */
+            if (!status)
+                goto done;
+        }
+
+        nsources++;
+    }
+
+    /* Each element selected is then read from one source only, so the reads cover the selection once
+     * they add up to its size */
+    if ((status = vds_mappings_overlap(sources, nsources)) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if (status)
+        goto done;
+
+    dset->vds_sources     = sources;
+    dset->num_vds_sources = nsources;
+    sources  = NULL;
+    nsources = 0;
+
+done:
+    /* The mapping being looked at is cleaned up with the others */
+    if (sources)
+        close_vds_sources(sources, MIN(nsources + 1, (int)nmappings));
+
+    if (fapl_id > 0 && H5Pclose(fapl_id) < 0) {
+        fprintf(stderr, "unable to close FAPL\n");
+        ret_value = -1;
+    }
+
+    if (bypass_id > 0 && H5VLclose(bypass_id) < 0) {
+        fprintf(stderr, "unable to close ID of the Bypass VOL\n");
+        ret_value = -1;
+    }
+
+    return ret_value;
+} /* end resolve_vds_sources() */
+
+/* The selections are compared two by two, once their bounds meet */
+static htri_t
+vds_mappings_overlap(const vds_source_t *sources, int nsources)
+{
+    hsize_t (*starts)[DIM_RANK_MAX] = NULL;
+    hsize_t (*ends)[DIM_RANK_MAX] = NULL;
+    hid_t     common_id;
+    hssize_t  npoints;
+    int       rank, i, j, d;
+    htri_t    ret_value = false;
+
+    if (nsources < 2)
+        goto done;
+
+    starts = (hsize_t (*)[DIM_RANK_MAX])malloc((size_t)nsources * sizeof(*starts));
+    ends   = (hsize_t (*)[DIM_RANK_MAX])malloc((size_t)nsources * sizeof(*ends));
+
+    if (!starts || !ends) {
+        fprintf(stderr, "failed to allocate bounds of virtual dataset mappings\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((rank = H5Sget_simple_extent_ndims(sources[0].vspace_id)) < 0 || rank > DIM_RANK_MAX) {
+        fprintf(stderr, "unable to get rank of virtual dataset\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    for (i = 0; i < nsources; i++)
+        if (H5Sget_select_bounds(sources[i].vspace_id, starts[i], ends[i]) < 0) {
+            fprintf(stderr, "unable to get bounds of virtual dataset mapping\n");
+            ret_value = -1;
+            goto done;
+        }
+
+    for (i = 0; i < nsources && !ret_value; i++)
+        for (j = i + 1; j < nsources && !ret_value; j++) {
+            for (d = 0; d < rank; d++)
+                if (starts[i][d] > ends[j][d] || starts[j][d] > ends[i][d])
+                    break;
+
+            if (d < rank)
+                continue;
+
+            /* The elements of one mapping which are in the other one as well */
+            if ((common_id = H5Sselect_project_intersection(sources[i].vspace_id, sources[i].vspace_id,
+                                                            sources[j].vspace_id)) < 0) {
+                fprintf(stderr, "unable to intersect virtual dataset mappings\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            npoints = H5Sget_select_npoints(common_id);
+            H5Sclose(common_id);
+
+            if (npoints < 0) {
+                fprintf(stderr, "H5Sget_select_npoints on mapping intersection failed\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            ret_value = npoints > 0;
+        }
+
+done:
+    free(starts);
+    free(ends);
+
+    return ret_value;
+} /* end vds_mappings_overlap() */
+
+/* The datasets are closed before the files, which they hold on to */
+static void
+close_vds_sources(vds_source_t *sources, int nsources)
+{
+    int i;
+
+    for (i = 0; i < nsources; i++) {
+        if (sources[i].vspace_id > 0)
+            H5Sclose(sources[i].vspace_id);
+
+        if (sources[i].src_space_id > 0)
+            H5Sclose(sources[i].src_space_id);
+
+        if (sources[i].dset && H5VL_bypass_dataset_close(sources[i].dset, H5P_DATASET_XFER_DEFAULT, NULL) < 0)
+            fprintf(stderr, "failed to close source dataset\n");
+    }
+
+    for (i = 0; i < nsources; i++)
+        if (sources[i].file && H5VL_bypass_file_close(sources[i].file, H5P_DATASET_XFER_DEFAULT, NULL) < 0)
+            fprintf(stderr, "failed to close source file\n");
+
+    free(sources);
+} /* end close_vds_sources() */
+
+/* The part of the selection in each mapping is projected onto the source selection and onto the
+ * memory selection.  The reads of all the sources go to the thread pool together and the read
+ * returns once they're all done.  The mappings don't overlap, so a selection is fully covered when the
+ * parts add up to it.  Otherwise it's left to the library for the fill value. */
+static htri_t
+read_virtual_dataset(H5VL_bypass_t *dset_obj, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id,
+                     hid_t dxpl_id, void *buf, void **req)
+{
+    Bypass_dataset_t *dset = &dset_obj->u.dataset;
+    vds_source_t     *src;
+    void    **src_dsets = NULL;
+    void    **bufs = NULL;
+    hid_t    *mem_type_ids = NULL;
+    hid_t    *mem_space_ids = NULL;
+    hid_t    *src_space_ids = NULL;
+    hid_t     file_space_id_copy, mem_space_id_copy;
+    hid_t     mem_sel_id = H5I_INVALID_HID;
+    hssize_t  npoints, nmapped = 0, n;
+    size_t    nreads = 0, r;
+    int       s;
+    htri_t    ret_value = true;
+
+    if (!dset->vds_resolved && resolve_vds_sources(dset_obj, dxpl_id, req) < 0) {
+        fprintf(stderr, "failed to open source datasets of virtual dataset\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (dset->num_vds_sources == 0) {
+        ret_value = false;
+        goto done;
+    }
+
+    if (check_dspaces_helper(dset->space_id, file_space_id, &file_space_id_copy, mem_space_id,
+                             &mem_space_id_copy) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((npoints = H5Sget_select_npoints(file_space_id_copy)) < 0) {
+        fprintf(stderr, "H5Sget_select_npoints on filespace failed\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    src_dsets     = (void **)malloc((size_t)dset->num_vds_sources * sizeof(void *));
+    bufs          = (void **)malloc((size_t)dset->num_vds_sources * sizeof(void *));
+    mem_type_ids  = (hid_t *)malloc((size_t)dset->num_vds_sources * sizeof(hid_t));
+    mem_space_ids = (hid_t *)malloc((size_t)dset->num_vds_sources * sizeof(hid_t));
+    src_space_ids = (hid_t *)malloc((size_t)dset->num_vds_sources * sizeof(hid_t));
+
+    if (!src_dsets || !bufs || !mem_type_ids || !mem_space_ids || !src_space_ids) {
+        fprintf(stderr, "failed to allocate reads of source datasets\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    for (s = 0; s < dset->num_vds_sources; s++) {
+        src = &dset->vds_sources[s];
+
+        if ((mem_sel_id = H5Sselect_project_intersection(file_space_id_copy, mem_space_id_copy, src->vspace_id)) < 0) {
+            fprintf(stderr, "unable to project selection into memory\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if ((n = H5Sget_select_npoints(mem_sel_id)) < 0) {
+            fprintf(stderr, "H5Sget_select_npoints on memspace failed\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if (n == 0) {
+            H5Sclose(mem_sel_id);
+            mem_sel_id = H5I_INVALID_HID;
+            continue;
+        }
+
+        if ((src_space_ids[nreads] = H5Sselect_project_intersection(src->vspace_id, src->src_space_id,
+                                                                    file_space_id_copy)) < 0) {
+            fprintf(stderr, "unable to project selection into source dataset\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        src_dsets[nreads]     = src->dset;
+        bufs[nreads]          = buf;
+        mem_type_ids[nreads]  = mem_type_id;
+        mem_space_ids[nreads] = mem_sel_id;
+        mem_sel_id = H5I_INVALID_HID;
+        nreads++;
+
+        nmapped += n;
+    }
+
+    if (nmapped != npoints) {
+        ret_value = false;
+        goto done;
+    }
+
+    if (nreads > 0 && H5VL_bypass_dataset_read(nreads, src_dsets, mem_type_ids, mem_space_ids, src_space_ids,
+                                               dxpl_id, bufs, req) < 0) {
+        fprintf(stderr, "failed to read source datasets of virtual dataset\n");
+        ret_value = -1;
+        goto done;
+    }
+
+done:
+    if (mem_sel_id > 0)
+        H5Sclose(mem_sel_id);
+
+    for (r = 0; r < nreads; r++) {
+        H5Sclose(mem_space_ids[r]);
+        H5Sclose(src_space_ids[r]);
+    }
+
+    free(src_dsets);
+    free(bufs);
+    free(mem_type_ids);
+    free(mem_space_ids);
+    free(src_space_ids);
+
+    return ret_value;
+} /* end read_virtual_dataset() */
+
+static herr_t
+signal_leftover_tasks(int local_count_for_signal)
+{
+    herr_t ret_value = 0;
+
+    if (local_count_for_signal > 0 && local_count_for_signal < nsteps_tpool) {
+        if (pthread_mutex_lock(&mutex_local) != 0) {
+	    printf("In %s of %s at line %d: pthread_mutex_lock failed\n", __func__, __FILE__, __LINE__);
+	    ret_value = -1;
+	    goto done;
+        }
+
+        pthread_cond_broadcast(&cond_local);
+
+        if (pthread_mutex_unlock(&mutex_local) != 0) {
+	    printf("In %s of %s at line %d: pthread_mutex_unlock failed\n", __func__, __FILE__, __LINE__);
+	    ret_value = -1;
+	    goto done;
+        }
+    }
+
+done:
+    return ret_value;
+} /* end signal_leftover_tasks() */
+
+static bool
+queue_runs_in_pool(const task_queue_t *task_queue)
+{
+    return task_queue == &queue_for_tpool || task_queue->fused;
+} /* end queue_runs_in_pool() */
+
+/* Only the tasks reading or writing the HDF5 file straight from or into the memory of the application
+ * are put together */
+static bool
+task_fusable(const Bypass_task_t *task)
+{
+    return !task->xlate && task->fill_size == 0 && task->ext_fd < 0 && !task->conv_func && task->wb_size == 0 &&
+           task->stage == STAGE_IO && task->addr != HADDR_UNDEF && task->size > 0;
+} /* end task_fusable() */
+
+static int
+compare_task_addrs(const void *a, const void *b)
+{
+    const Bypass_task_t *ta = *(Bypass_task_t *const *)a;
+    const Bypass_task_t *tb = *(Bypass_task_t *const *)b;
+
+    if (ta->file != tb->file)
+        return (uintptr_t)ta->file < (uintptr_t)tb->file ? -1 : 1;
+
+    return (ta->addr > tb->addr) - (ta->addr < tb->addr);
+} /* end compare_task_addrs() */
+
+/* Add the memory of a task following another one in the file to the pieces of the first one.  Memory
+ * right after the last piece just makes it longer. */
+static herr_t
+append_task_memory(Bypass_task_t *task, const Bypass_task_t *next)
+{
+    struct iovec *new_iov;
+    int           new_cap;
+
+    if (!task->iov) {
+        if ((task->iov = (struct iovec *)malloc(4 * sizeof(struct iovec))) == NULL)
+            return -1;
+
+        task->iov_cap          = 4;
+        task->iovcnt           = 1;
+        task->iov[0].iov_base  = task->vec_buf;
+        task->iov[0].iov_len   = task->size;
+    }
+
+    if ((char *)task->iov[task->iovcnt - 1].iov_base + task->iov[task->iovcnt - 1].iov_len == (char *)next->vec_buf) {
+        task->iov[task->iovcnt - 1].iov_len += next->size;
+    }
+    else {
+        if (task->iovcnt == task->iov_cap) {
+            new_cap = 2 * task->iov_cap;
+
+            if ((new_iov = (struct iovec *)realloc(task->iov, (size_t)new_cap * sizeof(struct iovec))) == NULL)
+                return -1;
+
+            task->iov     = new_iov;
+            task->iov_cap = new_cap;
+        }
+
+        task->iov[task->iovcnt].iov_base = next->vec_buf;
+        task->iov[task->iovcnt].iov_len  = next->size;
+        task->iovcnt++;
+    }
+
+    task->size += next->size;
+
+    return 0;
+} /* end append_task_memory() */
+
+/* The tasks doing other work (translating chunks, filling, reading external files or converting the
+ * data) go first, since they take longer.  The others follow in the order of the file, each one put
+ * together with the ones right after it in the file into vectored I/O, even across datasets.  The
+ * tasks were counted as they were gathered, so the ones put into others are uncounted.  If the list
+ * can't be sorted, the tasks are handed over as they are. */
+static herr_t
+submit_fused_tasks(task_queue_t *fused_queue)
+{
+    Bypass_task_t **tasks = NULL;
+    Bypass_task_t  *task, *last;
+    int             ntasks = fused_queue->tasks_in_queue;
+    int             nother = 0, nio = 0, nkept, i;
+    herr_t          ret_value = 0;
+
+    if (ntasks == 0)
+        return 0;
+
+    if ((tasks = (Bypass_task_t **)malloc((size_t)ntasks * sizeof(Bypass_task_t *))) == NULL) {
+        fprintf(stderr, "failed to allocate list of tasks, handing them over unsorted\n");
+        nkept = ntasks;
+        goto submit;
+    }
+
+    /* The I/O tasks are put at the end of the array, in reverse order */
+    while ((task = bypass_queue_pop(fused_queue, false)) != NULL) {
+        task->next = NULL;
+
+        if (task_fusable(task))
+            tasks[ntasks - 1 - nio++] = task;
+        else
+            tasks[nother++] = task;
+    }
+
+    qsort(tasks + nother, (size_t)nio, sizeof(Bypass_task_t *), compare_task_addrs);
+
+    last  = NULL;
+    nkept = nother;
+
+    for (i = nother; i < ntasks; i++) {
+        task = tasks[i];
+
+        if (last && task->file == last->file && task->read_data == last->read_data &&
+            task->swap_size == last->swap_size && task->task_count_ptr == last->task_count_ptr &&
+            last->addr + last->size == task->addr && last->size + task->size <= FUSED_IO_MAX &&
+            last->iovcnt < FUSED_IOV_MAX && append_task_memory(last, task) == 0) {
+            atomic_fetch_sub(task->task_count_ptr, 1);
+            bypass_task_release(task);
+            continue;
+        }
+
+        tasks[nkept++] = task;
+        last = task;
+    }
+
+    /* Link them back up in their new order */
+    fused_queue->bypass_queue_head_g = tasks[0];
+
+    for (i = 0; i < nkept - 1; i++)
+        tasks[i]->next = tasks[i + 1];
+
+    tasks[nkept - 1]->next = NULL;
+    fused_queue->bypass_queue_tail_g = tasks[nkept - 1];
+    fused_queue->tasks_in_queue = nkept;
+
+submit:
+    /* All at once, with a single wake-up of the thread pool */
+    if (pthread_mutex_lock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to lock local mutex\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (queue_for_tpool.bypass_queue_head_g == NULL)
+        queue_for_tpool.bypass_queue_head_g = fused_queue->bypass_queue_head_g;
+    else
+        queue_for_tpool.bypass_queue_tail_g->next = fused_queue->bypass_queue_head_g;
+
+    queue_for_tpool.bypass_queue_tail_g = fused_queue->bypass_queue_tail_g;
+    queue_for_tpool.tasks_in_queue += nkept;
+
+    fused_queue->bypass_queue_head_g = NULL;
+    fused_queue->bypass_queue_tail_g = NULL;
+    fused_queue->tasks_in_queue = 0;
+
+    pthread_cond_broadcast(&cond_local);
+
+    if (pthread_mutex_unlock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to unlock local mutex\n");
+        ret_value = -1;
+    }
+
+done:
+    free(tasks);
+
+    return ret_value;
+} /* end submit_fused_tasks() */
+
+static void
+drop_fused_tasks(task_queue_t *fused_queue)
+{
+    Bypass_task_t *task;
+
+    while ((task = bypass_queue_pop(fused_queue, false)) != NULL) {
+        atomic_fetch_sub(task->task_count_ptr, 1);
+        bypass_task_release(task);
+    }
+} /* end drop_fused_tasks() */
+
+static herr_t
+process_vectors(task_queue_t *task_queue, void *rbuf, sel_info_t *selection_info)
+{
+    hid_t      file_iter_id, mem_iter_id;
+    size_t     file_seq_i, mem_seq_i, file_nseq, mem_nseq;
+    hssize_t   hss_nelmts;
+    size_t     nelmts; 
+    size_t     seq_nelem;
+    hsize_t    file_off[SEL_SEQ_LIST_LEN], mem_off[SEL_SEQ_LIST_LEN];
+    size_t     file_len[SEL_SEQ_LIST_LEN], mem_len[SEL_SEQ_LIST_LEN];
+    size_t     io_len;
+    int        local_count_for_signal = 0;
+    haddr_t    task_addr   = HADDR_UNDEF;
+    void       *task_buf    = NULL;
+    herr_t     ret_value = 0;
+
+    /* Contiguous is treated as a single chunk */
+    if ((hss_nelmts = H5Sget_select_npoints(selection_info->file_space_id)) < 0) {
+        fprintf(stderr, "H5Sget_select_npoints on filespace failed\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    nelmts     = hss_nelmts;
+
+    if ((hss_nelmts = H5Sget_select_npoints(selection_info->mem_space_id)) < 0) {
+        fprintf(stderr, "H5Sget_select_npoints on memspace failed\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (nelmts != hss_nelmts) {
+        fprintf(stderr, "the number of selected elements in file (%ld) isn't equal to the number in memory (%" PRIdHSIZE")\n", nelmts,
+               hss_nelmts);
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((file_iter_id =
+        H5Ssel_iter_create(selection_info->file_space_id, 
+        selection_info->dtype_size, H5S_SEL_ITER_SHARE_WITH_DATASPACE)) < 0)
+    {
+        fprintf(stderr, "H5Ssel_iter_create on filespace failed\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((mem_iter_id =
+        H5Ssel_iter_create(selection_info->mem_space_id, 
+        selection_info->dtype_size, H5S_SEL_ITER_SHARE_WITH_DATASPACE)) < 0)
+    {
+        fprintf(stderr, "H5Ssel_iter_create on memspace failed\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* Initialize values so sequence lists are retrieved on the first iteration */
+    file_seq_i = mem_seq_i = SEL_SEQ_LIST_LEN;
+    file_nseq = mem_nseq = 0;
+
+    /* Loop until all elements are processed. The algorithm is copied from the
+     * function H5FD__read_selection_translate in H5FDint.c, which is somewhat
+     * similar to H5D__select_io in H5Dselect.c
+     */
+    while (file_seq_i < file_nseq || nelmts > 0) {
+        if (file_seq_i == SEL_SEQ_LIST_LEN) {
+            if (H5Ssel_iter_get_seq_list(file_iter_id, SEL_SEQ_LIST_LEN, SIZE_MAX, &file_nseq, &seq_nelem,
+                                         file_off, file_len) < 0)
+            {
+                fprintf(stderr, "file sequence length retrieval failed\n");
+                ret_value = -1;
+                goto done;
+            }
+
+        if (file_nseq == 0) {
+            fprintf(stderr, "no file sequences retrieved from iteration\n");
+            ret_value = -1;
+            goto done;
+        }
+
+	    nelmts -= seq_nelem;
+	    file_seq_i = 0;
+	}
+
+        /* Fill/refill memory sequence list if necessary */
+        if (mem_seq_i == SEL_SEQ_LIST_LEN) {
+            if (H5Ssel_iter_get_seq_list(mem_iter_id, SEL_SEQ_LIST_LEN, SIZE_MAX, &mem_nseq, &seq_nelem,
+                                         mem_off, mem_len) < 0)
+            {
+                fprintf(stderr, "memory sequence length retrieval failed\n");
+                ret_value = -1;
+                goto done;
+            }
+
+        if (mem_nseq == 0) {
+            fprintf(stderr, "no memory sequences retrieved from iteration\n");
+            ret_value = -1;
+            goto done;
+        }
+
+	   mem_seq_i = 0;
+	}
+
+        /* Calculate length of this IO */
+        io_len = MIN(file_len[file_seq_i], mem_len[mem_seq_i]);
+
+        /* Make sure the data length isn't greater than user's input
+         * (default to 1024 * 1024), mainly for contiguous datasets.  Keep whole elements in each
+         * piece for swapping or converting them. */
+        io_len = MIN(io_len, MAX(nelmts_max - nelmts_max % selection_info->dtype_size, selection_info->dtype_size));
+
+        /* Populate task and append to queue */
+        task_addr = selection_info->chunk_addr + file_off[file_seq_i];
+        task_buf = (void *)((uint8_t *)rbuf + mem_off[mem_seq_i]);
+
+        if (submit_io_task(task_queue, selection_info, task_addr, io_len, task_buf, &local_count_for_signal) < 0) {
+            fprintf(stderr, "Failed to submit task while processing vectors\n");
+            ret_value = -1;
+            goto done;
+        }
+
+#ifdef TMP
+        /* Save the info for the C log file */
+        {
+	    if (pthread_mutex_lock(&mutex_local) != 0) {
+		fprintf(stderr, "failed to lock local mutex\n");
+		ret_value = -1;
+		goto done;
+	    }
+
+            /* Enlarge the size of the info for C and Re-allocate the memory if
+             * necessary */
+            if (info_count == info_size) {
+                info_size *= 2;
+                if ((info_stuff = (info_t *)realloc(info_stuff, info_size * sizeof(info_t))) == NULL) {
+                    fprintf(stderr, "failed to reallocate info table\n");
+                    ret_value = -1;
+                    goto done;
+                }
+            }
+
+            /* Save the info in the structure */
+            strcpy(info_stuff[info_count].file_name, selection_info->file->u.file.name);
+            strcpy(info_stuff[info_count].dset_name, selection_info->dset_name);
+            info_stuff[info_count].dset_loc         = selection_info->chunk_addr;
+            info_stuff[info_count].data_offset_file = file_off[file_seq_i] / selection_info->dtype_size;
+            info_stuff[info_count].real_offset =
+                info_stuff[info_count].dset_loc + info_stuff[info_count].data_offset_file;
+            info_stuff[info_count].nelmts          = io_len / selection_info->dtype_size;
+            info_stuff[info_count].data_offset_mem = mem_off[mem_seq_i] / selection_info->dtype_size;
+            info_stuff[info_count].end_of_read     = false;
+
+            // printf("%s: %d, info_count = %d, end_of_read = %d\n", __func__,
+            // __LINE__, info_count, info_stuff[info_count].end_of_read);
+
+            /* Increment the counter */
+            info_count++;
+
+	    if (pthread_mutex_unlock(&mutex_local) != 0) {
+		fprintf(stderr, "failed to unlock local mutex\n");
+		ret_value = -1;
+		goto done;
+	    }
+	}
+#endif
+
+        /* Update file sequence */
+        if (io_len == file_len[file_seq_i])
+            file_seq_i++;
+        else {
+            file_off[file_seq_i] += io_len;
+            file_len[file_seq_i] -= io_len;
+        }
+
+        /* Update memory sequence */
+        if (io_len == mem_len[mem_seq_i])
+            mem_seq_i++;
+        else {
+            mem_off[mem_seq_i] += io_len;
+            mem_len[mem_seq_i] -= io_len;
+        }
+    }
+
+    /* If there is any leftover entries in the queue, signal the thread pool to
+     * read them.  The tasks have been enqueued earlier. */
+    if (signal_leftover_tasks(local_count_for_signal) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if (H5Ssel_iter_close(file_iter_id) < 0) {
+        fprintf(stderr, "failed to close file sel iterator\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (H5Ssel_iter_close(mem_iter_id) < 0) {
+        fprintf(stderr, "failed to close mem sel iterator\n");
+        ret_value = -1;
+        goto done;
+    }
+
+done:
+    return ret_value;
+} /* end of process_vectors() */
+
+static htri_t
+get_hyper_box(hid_t space_id, hyper_box_t *box)
+{
+    H5S_sel_type sel_type;
+    htri_t       is_regular;
+    hsize_t      low[DIM_RANK_MAX], high[DIM_RANK_MAX];
+    herr_t       bounds_status;
+    int          d;
+    htri_t       ret_value = 1;
+
+    if ((box->rank = H5Sget_simple_extent_ndims(space_id)) < 0) {
+        fprintf(stderr, "unable to get the rank of dataspace\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* Leave scalar dataspaces to the selection iterator */
+    if (box->rank == 0 || box->rank > DIM_RANK_MAX) {
+        ret_value = 0;
+        goto done;
+    }
+
+    if (H5Sget_simple_extent_dims(space_id, box->dims, NULL) < 0) {
+        fprintf(stderr, "unable to get the dimensions of dataspace\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((sel_type = H5Sget_select_type(space_id)) < 0) {
+        fprintf(stderr, "unable to get the selection type of dataspace\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (H5S_SEL_ALL == sel_type) {
+        set_box_all(box);
+    } else if (H5S_SEL_HYPERSLABS == sel_type) {
+        if ((is_regular = H5Sis_regular_hyperslab(space_id)) < 0) {
+            fprintf(stderr, "unable to check if the hyperslab selection is regular\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if (!is_regular) {
+            ret_value = 0;
+            goto done;
+        }
+
+        if (H5Sget_regular_hyperslab(space_id, box->start, box->stride, box->count, box->block) < 0) {
+            fprintf(stderr, "unable to get the regular hyperslab selection\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        /* The hyperslab is given without the offset set with H5Soffset_simple, while the bounds of the
+         * selection include it.  A selection the offset moves out of the extent is left to the library
+         * to report. */
+        H5E_BEGIN_TRY {
+            bounds_status = H5Sget_select_bounds(space_id, low, high);
+        } H5E_END_TRY;
+
+        if (bounds_status < 0) {
+            ret_value = 0;
+            goto done;
+        }
+
+        for (d = 0; d < box->rank; d++)
+            box->start[d] = low[d];
+    } else {
+        ret_value = 0;
+        goto done;
+    }
+
+    set_box_pitches(box);
+
+done:
+    return ret_value;
+} /* end get_hyper_box() */
+
+/* Select the whole extent of the box */
+static void
+set_box_all(hyper_box_t *box)
+{
+    int d;
+
+    for (d = 0; d < box->rank; d++) {
+        box->start[d]  = 0;
+        box->stride[d] = box->dims[d];
+        box->count[d]  = 1;
+        box->block[d]  = box->dims[d];
+    }
+} /* end set_box_all() */
+
+static void
+set_box_pitches(hyper_box_t *box)
+{
+    int d;
+
+    /* Pitches go from the fastest-changing dimension outward */
+    box->npoints = 1;
+
+    for (d = box->rank - 1; d >= 0; d--) {
+        /* The stride is meaningless for a single block.  Make it the block size so that
+         * the block arithmetic never has to deal with it */
+        if (box->count[d] == 1)
+            box->stride[d] = box->block[d];
+
+        box->sel_pitch[d] = box->npoints;
+        box->pitch[d]     = (d == box->rank - 1) ? 1 : box->pitch[d + 1] * box->dims[d + 1];
+        box->npoints     *= box->count[d] * box->block[d];
+    }
+} /* end set_box_pitches() */
+
+/* Number of selected coordinates below 'x' in dimension 'd' of the box */
+static inline hsize_t
+box_coords_before(const hyper_box_t *box, int d, hsize_t x)
+{
+    hsize_t rel, k;
+
+    if (x <= box->start[d])
+        return 0;
+
+    rel = x - box->start[d];
+    k   = rel / box->stride[d];
+
+    if (k >= box->count[d])
+        return box->count[d] * box->block[d];
+
+    return k * box->block[d] + MIN(rel % box->stride[d], box->block[d]);
+}
+
+/* Find the first selected coordinate in [lo, hi) for dimension 'd' of the box and the
+ * block it belongs to.  Returns false if no coordinate in the range is selected. */
+static inline bool
+box_first_in_range(const hyper_box_t *box, int d, hsize_t lo, hsize_t hi, hsize_t *k_out, hsize_t *x_out)
+{
+    hsize_t k = 0;
+    hsize_t x = box->start[d];
+
+    if (lo > box->start[d]) {
+        k = (lo - box->start[d]) / box->stride[d];
+
+        if ((lo - box->start[d]) % box->stride[d] < box->block[d])
+            x = lo;
+        else {
+            k++;
+            x = box->start[d] + k * box->stride[d];
+        }
+    }
+
+    if (k >= box->count[d] || x >= hi)
+        return false;
+
+    *k_out = k;
+    *x_out = x;
+
+    return true;
+}
+
+/* Split a piece of I/O into tasks no bigger than nelmts_max, the same way process_vectors() does */
+static herr_t
+submit_box_run(chunk_cb_info_t *cb_info, haddr_t chunk_addr, hsize_t file_off, hsize_t mem_off, hsize_t len,
+               int *local_count_for_signal)
+{
+    sel_info_t *selection_info = cb_info->selection_info;
+    size_t io_len;
+    size_t dtype_size = selection_info->dtype_size;
+    herr_t ret_value = 0;
+
+    /* The chunk isn't allocated: the run gets the fill value, whose size is the memory datatype's */
+    if (cb_info->fill_chunk) {
+        size_t first = (size_t)((char *)cb_info->rbuf + mem_off - (char *)selection_info->mem_buf) / dtype_size;
+
+        ret_value = submit_fill_run(cb_info->task_queue, selection_info,
+                                    (char *)selection_info->mem_buf + first * selection_info->mem_dtype_size,
+                                    (size_t)(len / dtype_size) * selection_info->mem_dtype_size,
+                                    local_count_for_signal);
+        goto done;
+    }
+
+    /* The chunk is already decoded in memory: copy the run instead of reading it */
+    if (cb_info->chunk_data) {
+        const char *src = (const char *)cb_info->chunk_data + file_off;
+
+        if (selection_info->conv_func) {
+            size_t first = (size_t)((char *)cb_info->rbuf + mem_off - (char *)selection_info->mem_buf) / dtype_size;
+
+            selection_info->conv_func(src, (char *)selection_info->mem_buf + first * selection_info->mem_dtype_size,
+                                      len / dtype_size);
+        }
+        else
+            memcpy((uint8_t *)cb_info->rbuf + mem_off, src, len);
+
+        goto done;
+    }
+
+    /* The chunk is being put together in memory to be encoded: copy the run into it */
+    if (cb_info->chunk_out) {
+        memcpy((uint8_t *)cb_info->chunk_out + file_off, (const uint8_t *)cb_info->rbuf + mem_off, len);
+        goto done;
+    }
+
+    while (len > 0) {
+        io_len = MIN(len, (hsize_t)MAX(nelmts_max - nelmts_max % dtype_size, dtype_size));
+
+        if (submit_io_task(cb_info->task_queue, cb_info->selection_info, chunk_addr + file_off, io_len,
+                           (void *)((uint8_t *)cb_info->rbuf + mem_off), local_count_for_signal) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
+        file_off += io_len;
+        mem_off  += io_len;
+        len      -= io_len;
+    }
+
+done:
+    return ret_value;
+} /* end submit_box_run() */
+
+/* The selection falling into a chunk is the product of the selected coordinates of each
+ * dimension within the chunk.  The fastest-changing dimension is walked one block at a time
+ * and the others one coordinate at a time, so each step is a run of elements contiguous both
+ * in the chunk and in the order of the selection.  A run's index in the selection order gives
+ * its place in the memory selection, where it's split at memory block boundaries.  Pieces
+ * contiguous in both file and memory are merged before being queued. */
+static herr_t
+process_chunk_boxes(chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets, haddr_t chunk_addr)
+{
+    const hyper_box_t *fbox = &cb_info->file_box;
+    const hyper_box_t *mbox = &cb_info->mem_box;
+    int      rank  = cb_info->dset_dim_rank;
+    int      mlast = mbox->rank - 1;
+    size_t   dtype_size = cb_info->selection_info->dtype_size;
+    hsize_t  lo[DIM_RANK_MAX], hi[DIM_RANK_MAX];
+    hsize_t  k0[DIM_RANK_MAX], x0[DIM_RANK_MAX];
+    hsize_t  k[DIM_RANK_MAX], x[DIM_RANK_MAX];
+    hsize_t  run_len, sel_idx, file_elem, mem_elem, mem_coord, nelem = 0;
+    hsize_t  pend_file = 0, pend_mem = 0, pend_len = 0;
+    hsize_t  file_off, mem_off, len;
+    int      local_count_for_signal = 0;
+    int      d;
+    herr_t   ret_value = 0;
+
+    /* Clip the chunk to the dataset extent and find the first selected coordinate in each
+     * dimension.  If any dimension has none, the chunk isn't touched by the selection. */
+    for (d = 0; d < rank; d++) {
+        lo[d] = chunk_offsets[d];
+        hi[d] = MIN(lo[d] + cb_info->chunk_dims[d], cb_info->dset_dims[d]);
+
+        if (!box_first_in_range(fbox, d, lo[d], hi[d], &k0[d], &x0[d]))
+            goto done;
+
+        k[d] = k0[d];
+        x[d] = x0[d];
+    }
+
+    while (1) {
+        /* The run extends to the end of the current block in the fastest-changing dimension */
+        run_len = MIN(fbox->start[rank - 1] + k[rank - 1] * fbox->stride[rank - 1] + fbox->block[rank - 1],
+                      hi[rank - 1]) - x[rank - 1];
+
+        /* Position of the run in the chunk and in the selection order */
+        file_elem = 0;
+        sel_idx   = 0;
+
+        for (d = 0; d < rank; d++) {
+            file_elem += (x[d] - lo[d]) * cb_info->chunk_pitch[d];
+            sel_idx   += box_coords_before(fbox, d, x[d]) * fbox->sel_pitch[d];
+        }
+
+        while (run_len > 0) {
+            /* Locate the element with the same selection index in memory */
+            mem_elem = 0;
+
+            for (d = 0; d <= mlast; d++) {
+                mem_coord = (sel_idx / mbox->sel_pitch[d]) % (mbox->count[d] * mbox->block[d]);
+                mem_elem += (mbox->start[d] + (mem_coord / mbox->block[d]) * mbox->stride[d] +
+                             mem_coord % mbox->block[d]) * mbox->pitch[d];
+
+                /* Elements left in the current memory block */
+                if (d == mlast)
+                    nelem = MIN(run_len, mbox->block[d] - mem_coord % mbox->block[d]);
+            }
+
+            file_off = file_elem * dtype_size;
+            mem_off  = mem_elem * dtype_size;
+            len      = nelem * dtype_size;
+
+            if (pend_len > 0 && pend_file + pend_len == file_off && pend_mem + pend_len == mem_off)
+                pend_len += len;
+            else {
+                if (pend_len > 0 &&
+                    submit_box_run(cb_info, chunk_addr, pend_file, pend_mem, pend_len, &local_count_for_signal) < 0) {
+                    ret_value = -1;
+                    goto done;
+                }
+
+                pend_file = file_off;
+                pend_mem  = mem_off;
+                pend_len  = len;
+            }
+
+            sel_idx   += nelem;
+            file_elem += nelem;
+            run_len   -= nelem;
+        }
+
+        /* Move to the next block in the fastest-changing dimension, carrying into the outer
+         * dimensions (one coordinate at a time) once the chunk's range is used up */
+        d = rank - 1;
+        k[d]++;
+        x[d] = fbox->start[d] + k[d] * fbox->stride[d];
+
+        while (k[d] >= fbox->count[d] || x[d] >= hi[d]) {
+            k[d] = k0[d];
+            x[d] = x0[d];
+
+            if (--d < 0)
+                goto finish;
+
+            x[d]++;
+
+            if (x[d] >= MIN(fbox->start[d] + k[d] * fbox->stride[d] + fbox->block[d], hi[d])) {
+                k[d]++;
+                x[d] = fbox->start[d] + k[d] * fbox->stride[d];
+            }
+        }
+    }
+
+finish:
+    if (pend_len > 0 &&
+        submit_box_run(cb_info, chunk_addr, pend_file, pend_mem, pend_len, &local_count_for_signal) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+done:
+    /* Tasks already queued must be processed even on failure, since the caller waits for them */
+    if (signal_leftover_tasks(local_count_for_signal) < 0)
+        ret_value = -1;
+
+    return ret_value;
+} /* end process_chunk_boxes() */
+
+static int
+collect_chunk_cb(const hsize_t *chunk_offsets, unsigned filter_mask, haddr_t chunk_addr, hsize_t chunk_size,
+                 void *op_data)
+{
+    chunk_xlate_t *xlate = (chunk_xlate_t *)op_data;
+    chunk_cb_info_t *cb_info = &xlate->cb_info;
+    hsize_t k, x;
+    int d;
+    int ret_value = H5_ITER_CONT;
+
+    /* Skip the chunks the selection doesn't touch */
+    for (d = 0; d < cb_info->dset_dim_rank; d++)
+        if (!box_first_in_range(&cb_info->file_box, d, chunk_offsets[d],
+                                MIN(chunk_offsets[d] + cb_info->chunk_dims[d], cb_info->dset_dims[d]), &k, &x))
+            goto done;
+
+    if (append_xlate_chunk(xlate, chunk_offsets, chunk_addr, chunk_size, filter_mask) < 0)
+        ret_value = H5_ITER_STOP;
+
+done:
+    return ret_value;
+} /* end collect_chunk_cb() */
+
+static herr_t
+append_xlate_chunk(chunk_xlate_t *xlate, const hsize_t *chunk_offsets, haddr_t chunk_addr, hsize_t chunk_size,
+                   unsigned filter_mask)
+{
+    chunk_cb_info_t *cb_info = &xlate->cb_info;
+    hsize_t *new_offsets = NULL;
+    haddr_t *new_addrs = NULL;
+    hsize_t *new_sizes = NULL;
+    unsigned *new_masks = NULL;
+    size_t new_alloc;
+    herr_t ret_value = 0;
+
+    if (xlate->nchunks == xlate->nalloc) {
+        new_alloc = xlate->nalloc ? 2 * xlate->nalloc : 1024;
+
+        if ((new_offsets = (hsize_t *)realloc(xlate->chunk_offsets,
+                                              new_alloc * cb_info->dset_dim_rank * sizeof(hsize_t))) == NULL) {
+            fprintf(stderr, "failed to enlarge chunk list\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        xlate->chunk_offsets = new_offsets;
+
+        if ((new_addrs = (haddr_t *)realloc(xlate->chunk_addrs, new_alloc * sizeof(haddr_t))) == NULL) {
+            fprintf(stderr, "failed to enlarge chunk list\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        xlate->chunk_addrs = new_addrs;
+
+        if (cb_info->nfilters > 0) {
+            if ((new_sizes = (hsize_t *)realloc(xlate->chunk_sizes, new_alloc * sizeof(hsize_t))) == NULL) {
+                fprintf(stderr, "failed to enlarge chunk list\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            xlate->chunk_sizes = new_sizes;
+
+            if ((new_masks = (unsigned *)realloc(xlate->filter_masks, new_alloc * sizeof(unsigned))) == NULL) {
+                fprintf(stderr, "failed to enlarge chunk list\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            xlate->filter_masks = new_masks;
+        }
+
+        xlate->nalloc = new_alloc;
+    }
+
+    memcpy(xlate->chunk_offsets + xlate->nchunks * cb_info->dset_dim_rank, chunk_offsets,
+           cb_info->dset_dim_rank * sizeof(hsize_t));
+    xlate->chunk_addrs[xlate->nchunks] = chunk_addr;
+
+    if (cb_info->nfilters > 0) {
+        xlate->chunk_sizes[xlate->nchunks]  = chunk_size;
+        xlate->filter_masks[xlate->nchunks] = filter_mask;
+    }
+
+    xlate->nchunks++;
+
+done:
+    return ret_value;
+} /* end append_xlate_chunk() */
+
+static int
+cmp_chunk_index(const void *a, const void *b)
+{
+    hsize_t x = *(const hsize_t *)a, y = *(const hsize_t *)b;
+
+    return (x > y) - (x < y);
+} /* end cmp_chunk_index() */
+
+/* Chunk iteration only reports the chunks written.  The chunks of the grid range covered by the
+ * selection are walked the same way as in the pipelined mode, and those touched by the selection but
+ * missing from the list are added with an undefined address, which makes their selection get the
+ * fill value.  The list is looked up through the sorted linear indices of its chunks in the grid. */
+static herr_t
+add_missing_chunks(chunk_xlate_t *xlate)
+{
+    const chunk_cb_info_t *cb_info = &xlate->cb_info;
+    const hyper_box_t *fbox = &cb_info->file_box;
+    int      rank = cb_info->dset_dim_rank;
+    hsize_t  first_idx[DIM_RANK_MAX], last_idx[DIM_RANK_MAX], idx[DIM_RANK_MAX];
+    hsize_t  grid_pitch[DIM_RANK_MAX];
+    hsize_t  chunk_offsets[DIM_RANK_MAX];
+    hsize_t *stored = NULL;
+    hsize_t  k, x, sel_end, linear;
+    size_t   nstored = xlate->nchunks;
+    size_t   c;
+    bool     touched;
+    int      d;
+    herr_t   ret_value = 0;
+
+    for (d = rank - 1; d >= 0; d--) {
+        grid_pitch[d] = (d == rank - 1) ? 1 :
+            grid_pitch[d + 1] * ((cb_info->dset_dims[d + 1] + cb_info->chunk_dims[d + 1] - 1) / cb_info->chunk_dims[d + 1]);
+
+        sel_end = MIN(fbox->start[d] + (fbox->count[d] - 1) * fbox->stride[d] + fbox->block[d],
+                      cb_info->dset_dims[d]);
+
+        first_idx[d] = fbox->start[d] / cb_info->chunk_dims[d];
+        last_idx[d]  = (sel_end - 1) / cb_info->chunk_dims[d];
+        idx[d]       = first_idx[d];
+    }
+
+    if (nstored > 0) {
+        if ((stored = (hsize_t *)malloc(nstored * sizeof(hsize_t))) == NULL) {
+            fprintf(stderr, "failed to allocate chunk index\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        for (c = 0; c < nstored; c++) {
+            stored[c] = 0;
+
+            for (d = 0; d < rank; d++)
+                stored[c] += (xlate->chunk_offsets[c * rank + d] / cb_info->chunk_dims[d]) * grid_pitch[d];
+        }
+
+        qsort(stored, nstored, sizeof(hsize_t), cmp_chunk_index);
+    }
+
+    while (1) {
+        touched = true;
+        linear  = 0;
+
+        for (d = 0; d < rank; d++) {
+            chunk_offsets[d] = idx[d] * cb_info->chunk_dims[d];
+            linear += idx[d] * grid_pitch[d];
+
+            if (!box_first_in_range(fbox, d, chunk_offsets[d],
+                                    MIN(chunk_offsets[d] + cb_info->chunk_dims[d], cb_info->dset_dims[d]), &k, &x))
+                touched = false;
+        }
+
+        if (touched && (nstored == 0 || !bsearch(&linear, stored, nstored, sizeof(hsize_t), cmp_chunk_index)) &&
+            append_xlate_chunk(xlate, chunk_offsets, HADDR_UNDEF, 0, 0) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
+        /* Move to the next chunk in the grid */
+        for (d = rank - 1; d >= 0; d--) {
+            if (++idx[d] <= last_idx[d])
+                break;
+
+            idx[d] = first_idx[d];
+        }
+
+        if (d < 0)
+            break;
+    }
+
+done:
+    free(stored);
+
+    return ret_value;
+} /* end add_missing_chunks() */
+
+/* The library has no call allocating chunks alone, so the chunks missing from the selection of a
+ * write are created by writing them whole with the fill value (zeros if there's none to write), the
+ * way H5Dwrite_chunk does, all during the same hold of the global lock.  Their addresses are then
+ * looked up, and the selection is written into them by the thread pool like into the other chunks. */
+static herr_t
+allocate_missing_chunks(H5VL_bypass_t *dset_obj, chunk_xlate_t *xlate, hid_t dxpl_id, void **req)
+{
+    Bypass_dataset_t *dset = &dset_obj->u.dataset;
+    H5VL_native_dataset_optional_args_t dset_opt_args;
+    H5VL_optional_args_t opt_args;
+    H5VL_dataset_get_args_t get_args;
+    unsigned char fill_value[FILL_VALUE_MAX];
+    size_t   chunk_nbytes = xlate->cb_info.chunk_nbytes;
+    void    *fill_buf = NULL;
+    unsigned filter_mask;
+    hsize_t  chunk_size;
+    size_t   c;
+    bool     allocated = false;
+    herr_t   ret_value = 0;
+
+    get_args.args.get_type.type_id = H5I_INVALID_HID;
+
+    for (c = 0; c < xlate->nchunks; c++) {
+        const hsize_t *chunk_offsets = xlate->chunk_offsets + c * xlate->cb_info.dset_dim_rank;
+
+        if (xlate->chunk_addrs[c] != HADDR_UNDEF)
+            continue;
+
+        /* The same chunk of fill value is written for all of them */
+        if (fill_buf == NULL) {
+            if (chunk_nbytes > UINT32_MAX) {
+                fprintf(stderr, "chunk of %zu bytes is too big to be allocated\n", chunk_nbytes);
+                ret_value = -1;
+                goto done;
+            }
+
+            if ((fill_buf = calloc(1, chunk_nbytes)) == NULL) {
+                fprintf(stderr, "failed to allocate buffer of fill value\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if (dset->fill_time != H5D_FILL_TIME_NEVER && dset->fill_status == H5D_FILL_VALUE_USER_DEFINED) {
+                if (dset->dtype_info.size > FILL_VALUE_MAX) {
+                    fprintf(stderr, "fill value of %zu bytes is too big\n", dset->dtype_info.size);
+                    ret_value = -1;
+                    goto done;
+                }
+
+                get_args.op_type = H5VL_DATASET_GET_TYPE;
+
+                if (H5VLdataset_get(dset_obj->under_object, dset_obj->under_vol_id, &get_args, dxpl_id, req) < 0 ||
+                    H5Pget_fill_value(dset->dcpl_id, get_args.args.get_type.type_id, fill_value) < 0) {
+                    fprintf(stderr, "unable to get fill value of dataset\n");
+                    ret_value = -1;
+                    goto done;
+                }
+
+                fill_pattern(fill_buf, chunk_nbytes, fill_value, dset->dtype_info.size);
+            }
+        }
+
+        dset_opt_args.chunk_write.offset  = chunk_offsets;
+        dset_opt_args.chunk_write.filters = 0;
+        dset_opt_args.chunk_write.size    = (uint32_t)chunk_nbytes;
+        dset_opt_args.chunk_write.buf     = fill_buf;
+        opt_args.op_type                  = H5VL_NATIVE_DATASET_CHUNK_WRITE;
+        opt_args.args                     = &dset_opt_args;
+
+        if (H5VLdataset_optional(dset_obj->under_object, dset_obj->under_vol_id, &opt_args, dxpl_id, req) < 0) {
+            fprintf(stderr, "unable to allocate chunk\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        allocated = true;
+
+        dset_opt_args.get_chunk_info_by_coord.offset      = chunk_offsets;
+        dset_opt_args.get_chunk_info_by_coord.filter_mask = &filter_mask;
+        dset_opt_args.get_chunk_info_by_coord.addr        = &xlate->chunk_addrs[c];
+        dset_opt_args.get_chunk_info_by_coord.size        = &chunk_size;
+        opt_args.op_type                                  = H5VL_NATIVE_DATASET_GET_CHUNK_INFO_BY_COORD;
+
+        if (H5VLdataset_optional(dset_obj->under_object, dset_obj->under_vol_id, &opt_args, dxpl_id, req) < 0 ||
+            xlate->chunk_addrs[c] == HADDR_UNDEF) {
+            fprintf(stderr, "unable to get address of chunk allocated\n");
+            ret_value = -1;
+            goto done;
+        }
+    }
+
+done:
+    /* The chunk index in the snapshot of the dataset is out of date */
+    if (allocated)
+        publish_dset_snapshot(dset, NULL);
+
+    if (get_args.args.get_type.type_id > 0 && H5Tclose(get_args.args.get_type.type_id) < 0) {
+        fprintf(stderr, "unable to close datatype\n");
+        ret_value = -1;
+    }
+
+    free(fill_buf);
+
+    return ret_value;
+} /* end allocate_missing_chunks() */
+
+/* Split the chunk list into 'nparts' tasks for the thread pool.  With no partitions, the calling
+ * thread translates the chunks itself. */
+static herr_t
+submit_xlate_tasks(task_queue_t *task_queue, chunk_xlate_t *xlate, size_t nparts)
+{
+    Bypass_task_t *task = NULL;
+    size_t part, first = 0, nchunks;
+    size_t c;
+    int    local_count_for_signal = 0;
+    bool   locked = false;
+    herr_t ret_value = 0;
+
+    if (nparts == 0) {
+        xlate->cb_info.task_queue = task_queue;
+
+        for (c = 0; c < xlate->nchunks; c++)
+            if (process_xlate_chunk(&xlate->cb_info, xlate, c) < 0) {
+                fprintf(stderr, "unable to map the selection in chunk\n");
+                ret_value = -1;
+                break;
+            }
+
+        release_chunk_xlate(xlate);
+        goto done;
+    }
+
+    /* The caller's reference goes to the partitions */
+    atomic_fetch_add(&xlate->ref_count, (int)nparts - 1);
+
+    if (pthread_mutex_lock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to lock local mutex\n");
+        ret_value = -1;
+        part = 0;
+        goto unref;
+    }
+
+    locked = true;
+
+    for (part = 0; part < nparts; part++) {
+        /* Spread the remainder over the first partitions */
+        nchunks = xlate->nchunks / nparts + (part < xlate->nchunks % nparts ? 1 : 0);
+
+        if ((task = bypass_task_create(&xlate->selection_info, HADDR_UNDEF, 0, NULL)) == NULL) {
+            fprintf(stderr, "Failed to assemble chunk translation task\n");
+            ret_value = -1;
+            goto unref;
+        }
+
+        task->xlate = xlate;
+        task->first_chunk = first;
+        task->nchunks = nchunks;
+
+        if (bypass_queue_push(task_queue, task, false) < 0) {
+            fprintf(stderr, "Failed to push task to queue\n");
+            /* Its reference is dropped below */
+            task->xlate = NULL;
+            bypass_task_release(task);
+            ret_value = -1;
+            goto unref;
+        }
+
+        first += nchunks;
+        local_count_for_signal++;
+    }
+
+    goto done;
+
+unref:
+    /* Drop the references of the partitions which never made it into the queue */
+    for (; part < nparts; part++)
+        release_chunk_xlate(xlate);
+
+done:
+    if (local_count_for_signal > 0)
+        pthread_cond_broadcast(&cond_local);
+
+    if (locked && pthread_mutex_unlock(&mutex_local) != 0) {
+        fprintf(stderr, "failed to unlock local mutex\n");
+        ret_value = -1;
+    }
+
+    return ret_value;
+} /* end submit_xlate_tasks() */
+
+static herr_t
+translate_chunk_partition(Bypass_task_t *task)
+{
+    chunk_xlate_t  *xlate = task->xlate;
+    chunk_cb_info_t cb_info = xlate->cb_info;
+    task_queue_t    local_queue;
+    Bypass_task_t  *io_task = NULL;
+    size_t          c;
+    herr_t          ret_value = 0;
+
+    memset(&local_queue, 0, sizeof(task_queue_t));
+
+    /* Tasks go into a queue private to this thread and are done right away by it */
+    cb_info.task_queue = &local_queue;
+
+    for (c = task->first_chunk; c < task->first_chunk + task->nchunks && ret_value == 0; c++) {
+        if (process_xlate_chunk(&cb_info, xlate, c) < 0) {
+            fprintf(stderr, "unable to map the selection in chunk\n");
+            ret_value = -1;
+        }
+
+        /* The count can't drop to zero here since this translation task is still counted */
+        while ((io_task = bypass_queue_pop(&local_queue, false)) != NULL) {
+            if (run_task_stages(io_task, true) < 0) {
+                fprintf(stderr, "operate_data_io failed within file %s\n", io_task->file->u.file.name);
+                ret_value = -1;
+            }
+
+            atomic_fetch_sub(io_task->task_count_ptr, 1);
+            bypass_task_release(io_task);
+        }
+    }
+
+    /* The chunk list is let go with the task */
+    return ret_value;
+} /* end translate_chunk_partition() */
+
+static void
+release_chunk_xlate(chunk_xlate_t *xlate)
+{
+    size_t c;
+
+    if (atomic_fetch_sub(&xlate->ref_count, 1) > 1)
+        return;
+
+    if (xlate->encoded)
+        for (c = 0; c < xlate->nchunks; c++)
+            free(xlate->encoded[c]);
+
+    free(xlate->encoded);
+
+    free(xlate->chunk_offsets);
+    free(xlate->chunk_addrs);
+    free(xlate->chunk_sizes);
+    free(xlate->filter_masks);
+    free(xlate);
+} /* end release_chunk_xlate() */
+
+static herr_t
+process_xlate_chunk(chunk_cb_info_t *cb_info, chunk_xlate_t *xlate, size_t c)
+{
+    const hsize_t *chunk_offsets = xlate->chunk_offsets + c * cb_info->dset_dim_rank;
+    chunk_cb_info_t fill_info;
+
+    /* Filtered chunks are written whole, whether they're allocated yet or not */
+    if (!cb_info->selection_info->read_data && cb_info->nfilters > 0)
+        return encode_filtered_chunk(cb_info, xlate, c);
+
+    if (xlate->chunk_addrs[c] == HADDR_UNDEF) {
+        fill_info = *cb_info;
+        fill_info.fill_chunk = true;
+
+        return process_chunk_boxes(&fill_info, chunk_offsets, HADDR_UNDEF);
+    }
+
+    if (cb_info->nfilters > 0)
+        return read_filtered_chunk(cb_info, chunk_offsets, xlate->chunk_addrs[c], xlate->chunk_sizes[c],
+                                   xlate->filter_masks[c]);
+
+    return process_chunk_boxes(cb_info, chunk_offsets, xlate->chunk_addrs[c]);
+} /* end process_xlate_chunk() */
+
+static bool
+filter_supported(const filter_info_t *filter)
+{
+    if (filter->id == H5Z_FILTER_DEFLATE || filter->id == H5Z_FILTER_SHUFFLE || filter->id == H5Z_FILTER_FLETCHER32)
+        return true;
+
+    return filter->plugin != NULL;
+} /* end filter_supported() */
+
+/* Plugins are found the way the library finds them: a shared library in one of the directories of the
+ * plugin path whose H5PLget_plugin_info() returns the class of the filter.  The library doesn't hand
+ * out the classes of the filters it loaded, so the connector loads the plugin once more for itself.
+ * Called with the global lock of the HDF5 library when datasets are opened.  Filters without a plugin
+ * are remembered too, so the directories are only searched once for each filter.  Filters not on the
+ * allowlist aren't looked up at all, so the library undoes them. */
+static filter_plugin_t *
+find_filter_plugin(H5Z_filter_t filter_id)
+{
+    typedef H5PL_type_t (*plugin_type_func_t)(void);
+    typedef const void *(*plugin_info_func_t)(void);
+
+    filter_plugin_t    *plugin = NULL;
+    const H5Z_class2_t *cls = NULL;
+    plugin_type_func_t  get_type;
+    plugin_info_func_t  get_info;
+    DIR                *dir = NULL;
+    struct dirent      *entry;
+    char                path_dir[PATH_MAX];
+    char                path_lib[PATH_MAX];
+    void               *handle = NULL;
+    unsigned            npaths = 0, p;
+    int                 i;
+
+    for (i = 0; i < nfilter_allowlist; i++)
+        if (filter_allowlist[i] == filter_id)
+            break;
+
+    if (i == nfilter_allowlist)
+        return NULL;
+
+    pthread_mutex_lock(&filter_plugins_mutex);
+
+    for (i = 0; i < nfilter_plugins; i++) {
+        if (filter_plugins[i].id == filter_id) {
+            plugin = &filter_plugins[i];
+            goto done;
+        }
+    }
+
+    if (nfilter_plugins >= FILTER_PLUGINS_MAX)
+        goto done;
+
+    /* The library must be able to apply the filter too, or the chunks are left to it to fail */
+    if (H5Zfilter_avail(filter_id) <= 0 || H5PLsize(&npaths) < 0)
+        npaths = 0;
+
+    for (p = 0; p < npaths && !cls; p++) {
+        if (H5PLget(p, path_dir, sizeof(path_dir)) <= 0 || (dir = opendir(path_dir)) == NULL)
+            continue;
+
+        while (!cls && (entry = readdir(dir)) != NULL) {
+            if (!strstr(entry->d_name, ".so") && !strstr(entry->d_name, ".dylib"))
+                continue;
+
+            snprintf(path_lib, sizeof(path_lib), "%s/%s", path_dir, entry->d_name);
+
+            if ((handle = dlopen(path_lib, RTLD_NOW | RTLD_LOCAL)) == NULL)
+                continue;
+
+            get_type = (plugin_type_func_t)dlsym(handle, "H5PLget_plugin_type");
+            get_info = (plugin_info_func_t)dlsym(handle, "H5PLget_plugin_info");
+
+            if (get_type && get_info && get_type() == H5PL_TYPE_FILTER) {
+                cls = (const H5Z_class2_t *)get_info();
+
+                if (cls && (cls->id != filter_id || !cls->decoder_present || !cls->filter))
+                    cls = NULL;
+            }
+
+            if (!cls) {
+                dlclose(handle);
+                handle = NULL;
+            }
+        }
+
+        closedir(dir);
+    }
+
+    plugin = &filter_plugins[nfilter_plugins++];
+
+    plugin->id     = filter_id;
+    plugin->cls    = cls;
+    plugin->handle = handle;
+
+done:
+    pthread_mutex_unlock(&filter_plugins_mutex);
+
+    return (plugin && plugin->cls) ? plugin : NULL;
+} /* end find_filter_plugin() */
+
+/* The callback is given the thread buffer holding the chunk and may free it and return another one
+ * allocated with malloc(), which then becomes the thread buffer.  HDF5 has no way for a filter to
+ * declare whether it's thread-safe or calls into the library, so only the plugins on the allowlist get
+ * here, and they are called by many threads at once without the global lock of the library.  The
+ * threads can't take the lock around the call instead: threads holding it wait for tasks of the thread
+ * pool, such as the writes done behind, which would never run once all the threads were waiting for
+ * the lock. */
+static herr_t
+decode_plugin_filter(const filter_info_t *filter, int cur, size_t *nbytes)
+{
+    filter_plugin_t *plugin   = filter->plugin;
+    size_t           buf_size = thread_buf_sizes[cur];
+    size_t           out_nbytes;
+    herr_t           ret_value = 0;
+
+    out_nbytes = plugin->cls->filter(filter->flags | H5Z_FLAG_REVERSE, filter->cd_nelmts, filter->cd_values,
+                                     *nbytes, &buf_size, &thread_bufs[cur]);
+
+    /* The buffer is the filter's to keep or replace, even when it fails */
+    thread_buf_sizes[cur] = thread_bufs[cur] ? buf_size : 0;
+
+    if (out_nbytes == 0) {
+        fprintf(stderr, "filter %d failed to decode chunk\n", (int)filter->id);
+        ret_value = -1;
+        goto done;
+    }
+
+    *nbytes = out_nbytes;
+
+done:
+    return ret_value;
+} /* end decode_plugin_filter() */
+
+static herr_t
+decode_chunk_filter(const filter_info_t *filter, int *cur, size_t *nbytes, size_t max_nbytes, bool skip_edc)
+{
+    int            other = (*cur == THREAD_BUF_CHUNK) ? THREAD_BUF_DECODE : THREAD_BUF_CHUNK;
+    void          *out   = NULL;
+    unsigned char *in    = (unsigned char *)thread_bufs[*cur];
+    uLongf         out_len;
+    uint32_t       stored, fletcher, reversed;
+    herr_t         ret_value = 0;
+
+    switch (filter->id) {
+        case H5Z_FILTER_DEFLATE:
+            /* The library deflates whole chunks, so the output is no bigger than a chunk with the
+             * checksums of the filters undone after this one */
+            if ((out = get_thread_buf(other, max_nbytes)) == NULL) {
+                ret_value = -1;
+                goto done;
+            }
+
+            out_len = (uLongf)max_nbytes;
+
+            if (uncompress((Bytef *)out, &out_len, (const Bytef *)thread_bufs[*cur], (uLong)*nbytes) != Z_OK) {
+                fprintf(stderr, "failed to inflate chunk\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            *nbytes = (size_t)out_len;
+            *cur    = other;
+            break;
+
+        case H5Z_FILTER_SHUFFLE:
+            /* The library sets the element size as the first client data value */
+            if (filter->cd_nelmts < 1) {
+                fprintf(stderr, "shuffle filter has no element size\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if ((out = get_thread_buf(other, *nbytes)) == NULL) {
+                ret_value = -1;
+                goto done;
+            }
+
+            unshuffle_bytes((unsigned char *)out, in, *nbytes, (size_t)filter->cd_values[0]);
+
+            *cur = other;
+            break;
+
+        case H5Z_FILTER_FLETCHER32:
+            if (*nbytes < FLETCHER32_SIZE) {
+                fprintf(stderr, "chunk is too small for a Fletcher32 checksum\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            /* The checksum is stored little-endian after the data, which stays where it is */
+            *nbytes -= FLETCHER32_SIZE;
+
+            if (skip_edc)
+                break;
+
+            stored = (uint32_t)in[*nbytes] | ((uint32_t)in[*nbytes + 1] << 8) | ((uint32_t)in[*nbytes + 2] << 16) |
+                     ((uint32_t)in[*nbytes + 3] << 24);
+            fletcher = checksum_fletcher32(in, *nbytes);
+
+            /* Files from library versions before 1.6.3 have the bytes of each half swapped */
+            reversed = ((fletcher & 0x00ff00ffu) << 8) | ((fletcher >> 8) & 0x00ff00ffu);
+
+            if (stored != fletcher && stored != reversed) {
+                fprintf(stderr, "data error detected by Fletcher32 checksum\n");
+                ret_value = -1;
+                goto done;
+            }
+            break;
+
+        default:
+            if (!filter->plugin) {
+                fprintf(stderr, "filter %d isn't supported by the Bypass VOL\n", (int)filter->id);
+                ret_value = -1;
+                goto done;
+            }
+
+            if (decode_plugin_filter(filter, *cur, nbytes) < 0) {
+                ret_value = -1;
+                goto done;
+            }
+            break;
+    }
+
+done:
+    return ret_value;
+} /* end decode_chunk_filter() */
+
+/* The whole chunk is read, since the selected part can't be located in the stored data, and the
+ * filters are undone in the opposite order of the pipeline.  Filters which failed when the chunk was
+ * written are flagged in its filter mask and skipped.  The decoded chunk stays in the buffers of the
+ * calling thread while the box engine copies the selection out of it. */
+static herr_t
+read_filtered_chunk(chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets, haddr_t chunk_addr, hsize_t chunk_size,
+                    unsigned filter_mask)
+{
+    int    cur;
+    herr_t ret_value = 0;
+
+    if (read_chunk_stage(cb_info->selection_info, chunk_addr, chunk_size) < 0 ||
+        (cur = decode_chunk_stage(cb_info, (size_t)chunk_size, filter_mask)) < 0 ||
+        scatter_chunk_stage(cb_info, chunk_offsets, chunk_addr, thread_bufs[cur]) < 0)
+        ret_value = -1;
+
+    return ret_value;
+} /* end read_filtered_chunk() */
+
+static bool
+filter_encodable(const filter_info_t *filter)
+{
+    return filter->id == H5Z_FILTER_DEFLATE || filter->id == H5Z_FILTER_SHUFFLE ||
+           filter->id == H5Z_FILTER_FLETCHER32;
+} /* end filter_encodable() */
+
+static htri_t
+filters_writable(Bypass_dataset_t *dset)
+{
+    unsigned chunk_opts = 0;
+    int      i;
+
+    for (i = 0; i < dset->num_filters; i++)
+        if (!filter_encodable(&dset->filters[i]))
+            return false;
+
+    if (dset->num_filters == 0)
+        return true;
+
+    /* The library stores partial edge chunks unfiltered if asked to */
+    if (H5Pget_chunk_opts(dset->dcpl_id, &chunk_opts) < 0) {
+        fprintf(stderr, "unable to get chunk options of dataset\n");
+        return -1;
+    }
+
+    return (chunk_opts & H5D_CHUNK_DONT_FILTER_PARTIAL_CHUNKS) == 0;
+} /* end filters_writable() */
+
+static bool
+chunk_covered(const chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets)
+{
+    hsize_t hi;
+    int     d;
+
+    for (d = 0; d < cb_info->dset_dim_rank; d++) {
+        hi = chunk_offsets[d] + cb_info->chunk_dims[d];
+
+        if (hi > cb_info->dset_dims[d] ||
+            box_coords_before(&cb_info->file_box, d, hi) - box_coords_before(&cb_info->file_box, d, chunk_offsets[d]) !=
+                cb_info->chunk_dims[d])
+            return false;
+    }
+
+    return true;
+} /* end chunk_covered() */
+
+/* A chunk written is put together in the buffers of the calling thread: the selection is copied
+ * over the stored chunk, decoded, if the write only covers part of it, or else over the fill value.
+ * The filters are applied in the order of the pipeline and the result is kept in the chunk list
+ * for the library to store. */
+static herr_t
+encode_filtered_chunk(chunk_cb_info_t *cb_info, chunk_xlate_t *xlate, size_t c)
+{
+    sel_info_t     *selection_info = cb_info->selection_info;
+    chunk_cb_info_t gather_info = *cb_info;
+    const hsize_t  *chunk_offsets = xlate->chunk_offsets + c * cb_info->dset_dim_rank;
+    size_t          nbytes = cb_info->chunk_nbytes;
+    size_t          buf_size;
+    int             cur = THREAD_BUF_CHUNK;
+    int             i;
+    herr_t          ret_value = 0;
+
+    if (chunk_covered(cb_info, chunk_offsets)) {
+        if (get_thread_buf(cur, nbytes) == NULL) {
+            ret_value = -1;
+            goto done;
+        }
+    } else if (xlate->chunk_addrs[c] != HADDR_UNDEF) {
+        if (read_chunk_stage(selection_info, xlate->chunk_addrs[c], xlate->chunk_sizes[c]) < 0 ||
+            (cur = decode_chunk_stage(cb_info, (size_t)xlate->chunk_sizes[c], xlate->filter_masks[c])) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+    } else {
+        if (get_thread_buf(cur, nbytes) == NULL) {
+            ret_value = -1;
+            goto done;
+        }
+
+        if (selection_info->fill_size > 0)
+            fill_pattern(thread_bufs[cur], nbytes, selection_info->fill_value, selection_info->fill_size);
+        else
+            memset(thread_bufs[cur], 0, nbytes);
+    }
+
+    gather_info.chunk_out = thread_bufs[cur];
+
+    if (process_chunk_boxes(&gather_info, chunk_offsets, HADDR_UNDEF) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    for (i = 0; i < cb_info->nfilters; i++)
+        if (encode_chunk_filter(&cb_info->filters[i], &cur, &nbytes) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
+    /* The buffer leaves the thread with the chunk */
+    xlate->encoded[c]      = take_thread_buf(cur, &buf_size);
+    xlate->chunk_sizes[c]  = (hsize_t)nbytes;
+    xlate->filter_masks[c] = 0;
+
+done:
+    return ret_value;
+} /* end encode_filtered_chunk() */
+
+static herr_t
+encode_chunk_filter(const filter_info_t *filter, int *cur, size_t *nbytes)
+{
+    int            other = (*cur == THREAD_BUF_CHUNK) ? THREAD_BUF_DECODE : THREAD_BUF_CHUNK;
+    unsigned char *in    = (unsigned char *)thread_bufs[*cur];
+    unsigned char *out   = NULL;
+    uLongf         out_len;
+    uint32_t       fletcher;
+    int            level;
+    herr_t         ret_value = 0;
+
+    switch (filter->id) {
+        case H5Z_FILTER_DEFLATE:
+            /* The library sets the compression level as the first client data value */
+            level   = (filter->cd_nelmts > 0) ? (int)filter->cd_values[0] : Z_DEFAULT_COMPRESSION;
+            out_len = compressBound((uLong)*nbytes);
+
+            if ((out = (unsigned char *)get_thread_buf(other, (size_t)out_len)) == NULL) {
+                ret_value = -1;
+                goto done;
+            }
+
+            if (compress2((Bytef *)out, &out_len, (const Bytef *)in, (uLong)*nbytes, level) != Z_OK) {
+                fprintf(stderr, "failed to deflate chunk\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            *nbytes = (size_t)out_len;
+            break;
+
+        case H5Z_FILTER_SHUFFLE:
+            if (filter->cd_nelmts < 1) {
+                fprintf(stderr, "shuffle filter has no element size\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if ((out = (unsigned char *)get_thread_buf(other, *nbytes)) == NULL) {
+                ret_value = -1;
+                goto done;
+            }
+
+            shuffle_bytes(out, in, *nbytes, (size_t)filter->cd_values[0]);
+            break;
+
+        case H5Z_FILTER_FLETCHER32:
+            /* The checksum is stored little-endian after the data */
+            if ((out = (unsigned char *)get_thread_buf(other, *nbytes + FLETCHER32_SIZE)) == NULL) {
+                ret_value = -1;
+                goto done;
+            }
+
+            fletcher = checksum_fletcher32(in, *nbytes);
+
+            memcpy(out, in, *nbytes);
+
+            out[*nbytes]     = (unsigned char)(fletcher & 0xff);
+            out[*nbytes + 1] = (unsigned char)((fletcher >> 8) & 0xff);
+            out[*nbytes + 2] = (unsigned char)((fletcher >> 16) & 0xff);
+            out[*nbytes + 3] = (unsigned char)((fletcher >> 24) & 0xff);
+
+            *nbytes += FLETCHER32_SIZE;
+            break;
+
+        default:
+            fprintf(stderr, "filter %d can't be applied by the Bypass VOL\n", (int)filter->id);
+            ret_value = -1;
+            goto done;
+    }
+
+    *cur = other;
+
+done:
+    return ret_value;
+} /* end encode_chunk_filter() */
+
+/* The chunks of a write are encoded by the thread pool, one task per chunk, while the calling thread
+ * lets the global lock go.  The library can't set aside file space for a chunk without writing it,
+ * so the encoded chunks are then handed to it in one batch the way H5Dwrite_chunk does, which
+ * allocates the space for their new sizes and stores them. */
+static herr_t
+write_filtered_chunks(task_queue_t *task_queue, chunk_xlate_t *xlate, size_t nparts, H5VL_bypass_t *dset_obj,
+                      hid_t dxpl_id, void **req, bool *acquired_global, unsigned int *lock_count)
+{
+    sel_info_t *selection_info = &xlate->selection_info;
+    H5VL_native_dataset_optional_args_t dset_opt_args;
+    H5VL_optional_args_t opt_args;
+    bool   dropped = false;
+    bool   written = false;
+    size_t c;
+    herr_t ret_value = 0;
+
+    if ((xlate->encoded = (void **)calloc(MAX(xlate->nchunks, 1), sizeof(void *))) == NULL) {
+        fprintf(stderr, "failed to allocate list of encoded chunks\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* Keep the chunk list for after the tasks */
+    atomic_fetch_add(&xlate->ref_count, 1);
+
+    if (submit_xlate_tasks(task_queue, xlate, nparts) < 0) {
+        fprintf(stderr, "failed to submit chunk encoding\n");
+        ret_value = -1;
+    }
+
+    /* The chunks are stored right after, so the tasks of a fused request can't wait for the others */
+    if (task_queue->fused && submit_fused_tasks(task_queue) < 0) {
+        drop_fused_tasks(task_queue);
+        ret_value = -1;
+    }
+
+    if (queue_runs_in_pool(task_queue)) {
+        if (*acquired_global) {
+            if (release_global_mutex(lock_count, acquired_global) < 0)
+                ret_value = -1;
+
+            dropped = true;
+        }
+
+        pthread_mutex_lock(&mutex_local);
+
+        while (atomic_load(selection_info->task_count_ptr) > 0)
+            pthread_cond_wait(selection_info->local_condition_ptr, &mutex_local);
+
+        pthread_mutex_unlock(&mutex_local);
+
+        if (dropped) {
+            dropped = false;
+
+            if (acquire_global_mutex(*lock_count, acquired_global) < 0) {
+                ret_value = -1;
+                goto done;
+            }
+        }
+    }
+
+    /* Nothing is stored unless all the chunks were encoded */
+    if (ret_value < 0 || atomic_load(selection_info->task_error_ptr) > 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    opt_args.op_type = H5VL_NATIVE_DATASET_CHUNK_WRITE;
+    opt_args.args    = &dset_opt_args;
+
+    for (c = 0; c < xlate->nchunks; c++) {
+        if (xlate->encoded[c] == NULL || xlate->chunk_sizes[c] > UINT32_MAX) {
+            fprintf(stderr, "chunk wasn't encoded or is too big to be stored\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        dset_opt_args.chunk_write.offset  = xlate->chunk_offsets + c * xlate->cb_info.dset_dim_rank;
+        dset_opt_args.chunk_write.filters = xlate->filter_masks[c];
+        dset_opt_args.chunk_write.size    = (uint32_t)xlate->chunk_sizes[c];
+        dset_opt_args.chunk_write.buf     = xlate->encoded[c];
+
+        if (H5VLdataset_optional(dset_obj->under_object, dset_obj->under_vol_id, &opt_args, dxpl_id, req) < 0) {
+            fprintf(stderr, "unable to store encoded chunk\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        written = true;
+    }
+
+done:
+    /* The chunk index in the snapshot of the dataset is out of date */
+    if (written)
+        publish_dset_snapshot(&dset_obj->u.dataset, NULL);
+
+    release_chunk_xlate(xlate);
+
+    return ret_value;
+} /* end write_filtered_chunks() */
+
+static herr_t
+read_chunk_stage(sel_info_t *selection_info, haddr_t chunk_addr, hsize_t chunk_size)
+{
+    herr_t ret_value = 0;
+
+    if (get_thread_buf(THREAD_BUF_CHUNK, (size_t)chunk_size) == NULL) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if (operate_data_io(selection_info->file->u.file.fd, thread_bufs[THREAD_BUF_CHUNK], (size_t)chunk_size,
+                        chunk_addr, true) < 0) {
+        fprintf(stderr, "failed to read filtered chunk\n");
+        ret_value = -1;
+        goto done;
+    }
+
+done:
+    return ret_value;
+} /* end read_chunk_stage() */
+
+static int
+decode_chunk_stage(chunk_cb_info_t *cb_info, size_t nbytes, unsigned filter_mask)
+{
+    sel_info_t *selection_info = cb_info->selection_info;
+    size_t      max_nbytes;
+    int         cur = THREAD_BUF_CHUNK;
+    int         i, j;
+    int         ret_value;
+
+    /* Chunks are decoded in the threads of the pool, so the checksums of many chunks are verified
+     * at the same time */
+    for (i = cb_info->nfilters - 1; i >= 0; i--) {
+        if (filter_mask & (1u << i))
+            continue;
+
+        /* The checksums of the filters still to be undone are part of this filter's output */
+        max_nbytes = cb_info->chunk_nbytes;
+
+        for (j = 0; j < i; j++)
+            if (!(filter_mask & (1u << j)) && cb_info->filters[j].id == H5Z_FILTER_FLETCHER32)
+                max_nbytes += FLETCHER32_SIZE;
+
+        if (decode_chunk_filter(&cb_info->filters[i], &cur, &nbytes, max_nbytes, selection_info->skip_edc) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+    }
+
+    if (nbytes != cb_info->chunk_nbytes) {
+        fprintf(stderr, "decoded chunk has %zu bytes instead of %zu\n", nbytes, cb_info->chunk_nbytes);
+        ret_value = -1;
+        goto done;
+    }
+
+    if (selection_info->swap_size > 1)
+        swap_bytes(thread_bufs[cur], nbytes / selection_info->swap_size, selection_info->swap_size);
+
+    ret_value = cur;
+
+done:
+    return ret_value;
+} /* end decode_chunk_stage() */
+
+static herr_t
+scatter_chunk_stage(chunk_cb_info_t *cb_info, const hsize_t *chunk_offsets, haddr_t chunk_addr, const void *chunk_data)
+{
+    chunk_cb_info_t scatter_info = *cb_info;
+
+    scatter_info.chunk_data = chunk_data;
+
+    return process_chunk_boxes(&scatter_info, chunk_offsets, chunk_addr);
+} /* end scatter_chunk_stage() */
+
+/* Check the selections of a read or write the way process_chunks() will see them, before the native
+ * path is ruled out */
+static htri_t
+selections_are_regular(Bypass_dataset_t *dset, hid_t mem_space_id, hid_t file_space_id)
+{
+    hyper_box_t box;
+    htri_t      ret_value;
+
+    if (H5S_ALL == file_space_id)
+        file_space_id = dset->space_id;
+
+    if (H5S_ALL == mem_space_id)
+        mem_space_id = file_space_id;
+
+    if ((ret_value = get_hyper_box(file_space_id, &box)) <= 0)
+        goto done;
+
+    ret_value = get_hyper_box(mem_space_id, &box);
+
+done:
+    return ret_value;
+} /* end selections_are_regular() */
+
+/* Take the global lock of the library in three stages: try it a bounded number of times, then
+ * sleep between tries for exponentially longer, then block on a condition variable signaled by the
+ * other threads of this connector when they let the lock go.  Threads outside the connector let it go
+ * without signaling, so the block is timed and the lock is tried again after each wait. */
+static herr_t
+acquire_global_mutex(unsigned int lock_count, bool *acquired_global)
+{
+    struct timespec start_time, end_time, deadline, delay;
+    unsigned long   generation;
+    unsigned long long wait_ns, max_wait_ns;
+    bool            waiting = false, locked = false, blocked = false;
+    int             i;
+    herr_t          ret_value = 0;
+
+    if (H5TSmutex_acquire(lock_count, acquired_global) < 0) {
+        fprintf(stderr, "In %s of %s at line %d: H5TSmutex_acquire failed\n", __func__, __FILE__, __LINE__);
+        ret_value = -1;
+        goto done;
+    }
+
+    if (*acquired_global)
+        goto done;
+
+    if (lock_stats)
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    /* Spin */
+    for (i = 1; i < GLOBAL_LOCK_SPINS && !*acquired_global; i++)
+        if (H5TSmutex_acquire(lock_count, acquired_global) < 0) {
+            fprintf(stderr, "In %s of %s at line %d: H5TSmutex_acquire failed\n", __func__, __FILE__, __LINE__);
+            ret_value = -1;
+            goto done;
+        }
+
+    /* Back off, doubling the sleep from one microsecond */
+    for (i = 0; i < GLOBAL_LOCK_BACKOFFS && !*acquired_global; i++) {
+        delay.tv_sec  = 0;
+        delay.tv_nsec = 1000L << i;
+        nanosleep(&delay, NULL);
+
+        if (H5TSmutex_acquire(lock_count, acquired_global) < 0) {
+            fprintf(stderr, "In %s of %s at line %d: H5TSmutex_acquire failed\n", __func__, __FILE__, __LINE__);
+            ret_value = -1;
+            goto done;
+        }
+    }
+
+    /* Block.  Reading the release count before each try makes sure a release between the try and the
+     * wait isn't missed. */
+    if (!*acquired_global) {
+        blocked = true;
+        atomic_fetch_add(&global_lock_waiters, 1);
+        waiting = true;
+
+        pthread_mutex_lock(&global_lock_mutex);
+        locked = true;
+
+        while (1) {
+            generation = global_lock_releases;
+
+            pthread_mutex_unlock(&global_lock_mutex);
+            locked = false;
+
+            if (H5TSmutex_acquire(lock_count, acquired_global) < 0) {
+                fprintf(stderr, "In %s of %s at line %d: H5TSmutex_acquire failed\n", __func__, __FILE__, __LINE__);
+                ret_value = -1;
+                goto done;
+            }
+
+            if (*acquired_global)
+                break;
+
+            pthread_mutex_lock(&global_lock_mutex);
+            locked = true;
+
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += GLOBAL_LOCK_WAIT_USEC * 1000L;
+            deadline.tv_sec  += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+
+            while (generation == global_lock_releases &&
+                   pthread_cond_timedwait(&global_lock_cond, &global_lock_mutex, &deadline) != ETIMEDOUT)
+                ;
+        }
+    }
+
+    if (lock_stats) {
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+        wait_ns = (unsigned long long)(end_time.tv_sec - start_time.tv_sec) * 1000000000ULL +
+                  (unsigned long long)end_time.tv_nsec - (unsigned long long)start_time.tv_nsec;
+
+        atomic_fetch_add(&global_lock_stats.contended, 1);
+        atomic_fetch_add(&global_lock_stats.wait_ns, wait_ns);
+
+        if (blocked)
+            atomic_fetch_add(&global_lock_stats.blocked, 1);
+
+        max_wait_ns = atomic_load(&global_lock_stats.max_wait_ns);
+
+        while (wait_ns > max_wait_ns &&
+               !atomic_compare_exchange_weak(&global_lock_stats.max_wait_ns, &max_wait_ns, wait_ns))
+            ;
+    }
+
+done:
+    if (locked)
+        pthread_mutex_unlock(&global_lock_mutex);
+
+    if (waiting)
+        atomic_fetch_sub(&global_lock_waiters, 1);
+
+    if (lock_stats && *acquired_global)
+        atomic_fetch_add(&global_lock_stats.acquires, 1);
+
+    return ret_value;
+} /* end acquire_global_mutex() */
+
+static herr_t
+release_global_mutex(unsigned int *lock_count, bool *acquired_global)
+{
+    herr_t ret_value = 0;
+
+    if (!*acquired_global)
+        goto done;
+
+    if (H5TSmutex_release(lock_count) != 0) {
+        fprintf(stderr, "In %s of %s at line %d: H5TSmutex_release failed\n", __func__, __FILE__, __LINE__);
+        ret_value = -1;
+    }
+
+    /* Wake up a thread blocked for the lock */
+    if (atomic_load(&global_lock_waiters) > 0) {
+        pthread_mutex_lock(&global_lock_mutex);
+        global_lock_releases++;
+        pthread_cond_signal(&global_lock_cond);
+        pthread_mutex_unlock(&global_lock_mutex);
+    }
+
+done:
+    *acquired_global = false;
+
+    return ret_value;
+} /* end release_global_mutex() */
+
+/* Instead of iterating over all chunks in one library call, walk the grid of chunks covered by the
+ * selection and look up pipeline_chunks of them at a time by their coordinates.  Each batch goes to
+ * the thread pool as soon as it's looked up, and the library lock, which this thread took, is let go
+ * while the batch is queued so that other threads get a turn.  The lock is held again on return. */
+static herr_t
+process_chunks_pipelined(chunk_cb_info_t *cb_info, H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req,
+                         bool *acquired_global, unsigned int *lock_count)
+{
+    H5VL_native_dataset_optional_args_t dset_opt_args;
+    H5VL_optional_args_t opt_args;
+    const hyper_box_t *fbox = &cb_info->file_box;
+    chunk_xlate_t *xlate = NULL;
+    int      rank = cb_info->dset_dim_rank;
+    hsize_t  first_idx[DIM_RANK_MAX], last_idx[DIM_RANK_MAX], idx[DIM_RANK_MAX];
+    hsize_t  chunk_offsets[DIM_RANK_MAX];
+    hsize_t  k, x, sel_end;
+    hsize_t  chunk_size = 0;
+    haddr_t  chunk_addr = HADDR_UNDEF;
+    unsigned filter_mask = 0;
+    bool     dropped = false;
+    bool     all_visited = false;
+    bool     touched;
+    int      d;
+    herr_t   ret_value = 0;
+
+    /* The range of chunks covered by the selection in each dimension */
+    for (d = 0; d < rank; d++) {
+        sel_end = MIN(fbox->start[d] + (fbox->count[d] - 1) * fbox->stride[d] + fbox->block[d],
+                      cb_info->dset_dims[d]);
+
+        first_idx[d] = fbox->start[d] / cb_info->chunk_dims[d];
+        last_idx[d]  = (sel_end - 1) / cb_info->chunk_dims[d];
+        idx[d]       = first_idx[d];
+    }
+
+    dset_opt_args.get_chunk_info_by_coord.offset = chunk_offsets;
+    dset_opt_args.get_chunk_info_by_coord.filter_mask = &filter_mask;
+    dset_opt_args.get_chunk_info_by_coord.addr = &chunk_addr;
+    dset_opt_args.get_chunk_info_by_coord.size = &chunk_size;
+
+    opt_args.args = (void*) &dset_opt_args;
+    opt_args.op_type = H5VL_NATIVE_DATASET_GET_CHUNK_INFO_BY_COORD;
+
+    while (!all_visited) {
+        if (dropped) {
+            if (acquire_global_mutex(*lock_count, acquired_global) < 0) {
+                ret_value = -1;
+                goto done;
+            }
+
+            dropped = false;
+        }
+
+        if ((xlate = (chunk_xlate_t *)calloc(1, sizeof(chunk_xlate_t))) == NULL ||
+            (xlate->chunk_offsets = (hsize_t *)malloc((size_t)pipeline_chunks * rank * sizeof(hsize_t))) == NULL ||
+            (xlate->chunk_addrs = (haddr_t *)malloc((size_t)pipeline_chunks * sizeof(haddr_t))) == NULL) {
+            fprintf(stderr, "failed to allocate chunk list\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        atomic_init(&xlate->ref_count, 1);
+        xlate->cb_info = *cb_info;
+        xlate->selection_info = *cb_info->selection_info;
+        xlate->cb_info.selection_info = &xlate->selection_info;
+        xlate->nalloc = (size_t)pipeline_chunks;
+
+        /* Look up a batch of chunks while holding the library lock */
+        while (!all_visited && xlate->nchunks < xlate->nalloc) {
+            touched = true;
+
+            for (d = 0; d < rank; d++) {
+                chunk_offsets[d] = idx[d] * cb_info->chunk_dims[d];
+
+                if (!box_first_in_range(fbox, d, chunk_offsets[d],
+                                        MIN(chunk_offsets[d] + cb_info->chunk_dims[d], cb_info->dset_dims[d]), &k, &x))
+                    touched = false;
+            }
+
+            if (touched) {
+                if (H5VLdataset_optional(dset_obj->under_object, dset_obj->under_vol_id, &opt_args, dxpl_id, req) < 0) {
+                    fprintf(stderr, "failed to get chunk info by coordinates\n");
+                    ret_value = -1;
+                    goto done;
+                }
+
+                /* Unallocated chunks are skipped, the same as in chunk iteration, unless their
+                 * selection gets the fill value */
+                if (chunk_addr != HADDR_UNDEF || cb_info->selection_info->fill_size > 0) {
+                    memcpy(xlate->chunk_offsets + xlate->nchunks * rank, chunk_offsets, rank * sizeof(hsize_t));
+                    xlate->chunk_addrs[xlate->nchunks] = chunk_addr;
+                    xlate->nchunks++;
+                }
+            }
+
+            /* Move to the next chunk in the grid */
+            for (d = rank - 1; d >= 0; d--) {
+                if (++idx[d] <= last_idx[d])
+                    break;
+
+                idx[d] = first_idx[d];
+            }
+
+            if (d < 0)
+                all_visited = true;
+        }
+
+        /* Let other threads into the library while this batch is handed to the thread pool */
+        if (*acquired_global) {
+            if (release_global_mutex(lock_count, acquired_global) < 0) {
+                ret_value = -1;
+                goto done;
+            }
+
+            dropped = true;
+        }
+
+        if (xlate->nchunks > 0) {
+            if (submit_xlate_tasks(&queue_for_tpool, xlate, 1) < 0) {
+                xlate = NULL;
+                fprintf(stderr, "failed to submit chunk translation to thread pool\n");
+                ret_value = -1;
+                goto done;
+            }
+        } else
+            release_chunk_xlate(xlate);
+
+        xlate = NULL;
+    }
+
+done:
+    if (xlate)
+        release_chunk_xlate(xlate);
+
+    if (dropped && acquire_global_mutex(*lock_count, acquired_global) < 0)
+        ret_value = -1;
+
+    return ret_value;
+} /* end process_chunks_pipelined() */
+
+static int
+process_chunk_cb(const hsize_t *chunk_offsets, unsigned filter_mask,
+    haddr_t chunk_addr, hsize_t chunk_size, void *op_data) {
+
+    /* Set to H5_ITER_STOP in case of error here - see note in lib documentation on H5D_chunk_iter_op_t */
+    herr_t ret_value = H5_ITER_CONT;
+    chunk_cb_info_t *cb_info = (chunk_cb_info_t *)op_data;
+
+    int select_npoints = 0;
+    hid_t mem_selection_id = H5I_INVALID_HID;
+
+    assert(cb_info);
+
+    /* Regular selections are mapped directly without touching any dataspace */
+    if (cb_info->use_boxes) {
+        if (process_chunk_boxes(cb_info, chunk_offsets, chunk_addr) < 0) {
+            fprintf(stderr, "unable to map the selection in chunk\n");
+            ret_value = H5_ITER_STOP;
+        }
+
+        goto done;
+    }
+
+    if (H5Sset_extent_simple(cb_info->file_space_copy, cb_info->dset_dim_rank, cb_info->dset_dims, NULL) < 0) {
+        fprintf(stderr, "unable to set the extent of the file space\n");
+        ret_value = H5_ITER_STOP;
+        goto done;
+    }
+
+    /* Reset the file space copy to initial selection/extent */
+    // TBD - This may only be necessary if the selection is a hyperslab
+    if (H5Sselect_copy(cb_info->file_space_copy, cb_info->file_space) < 0) {
+        fprintf(stderr, "unable to copy file space\n");
+        ret_value = H5_ITER_STOP;
+        goto done;
+    }
+
+    /* To calculate the intersection area in the next step, there must be a hyperslab selection to start
+        * with. If there is no hyperslab selection in the file dataspace, select the whole dataspace. */
+    if (H5S_SEL_HYPERSLABS != cb_info->select_type) {
+        if (H5Sselect_hyperslab(cb_info->file_space_copy, H5S_SELECT_SET,
+            ZERO_OFFSETS, NULL, cb_info->dset_dims, NULL) < 0) {
+
+            printf("In %s of %s at line %d: H5Sselect_hyperslab failed\n", __func__, __FILE__, __LINE__);
+            ret_value = H5_ITER_STOP;
+            goto done;
+        }
+    }
+
+    /* Get the intersection between file space selection and this chunk. In other words,
+     * get the file space selection falling into this chunk. */
+    if (H5Sselect_hyperslab(cb_info->file_space_copy, H5S_SELECT_AND, chunk_offsets, NULL, cb_info->chunk_dims, NULL) < 0) {
+        printf("In %s of %s at line %d: H5Sselect_hyperslab failed\n", __func__, __FILE__, __LINE__);
+        ret_value = H5_ITER_STOP;
+        goto done;
+    }
+
+    if ((select_npoints = H5Sget_select_npoints(cb_info->file_space_copy)) < 0) {
+        fprintf(stderr, "unable to get the number of points in file selection\n");
+        ret_value = H5_ITER_STOP;
+        goto done;
+    }
+
+    /* No selection overlap; move on to the next chunk */
+    if (select_npoints == 0)
+        goto done;
+
+    /* Key function: get the data selection in memory which matches the file space selection falling
+     * into this chunk */
+    if ((mem_selection_id = H5Sselect_project_intersection(cb_info->file_space,
+        cb_info->mem_space, cb_info->file_space_copy)) < 0) {
+        fprintf(stderr, "unable to get projected dataspace intersection\n");
+        ret_value = H5_ITER_STOP;
+        goto done;
+    }
+
+    /* Move the file space selection in this chunk to upper-left corner and adjust (shrink) its extent
+     * to the size of the chunk. In other words, the 'file_space_copy' that contains the data
+     * selection in file which falls into the current chunk is adjusted from the size of the dataset
+     * to the size of chunk which still contains the same data selection. 'chunk_addr' is the original
+     * point for 'file_space_copy'.
+     */
+    if (H5Sselect_adjust(cb_info->file_space_copy, chunk_offsets) < 0) {
+        printf("In %s of %s at line %d: H5Sselect_adjust failed\n", __func__, __FILE__, __LINE__);
+        ret_value = H5_ITER_STOP;
+        goto done;
+    }
+
+    if (H5Sset_extent_simple(cb_info->file_space_copy, cb_info->dset_dim_rank,
+        cb_info->chunk_dims, cb_info->chunk_dims) < 0) {
+        fprintf(stderr, "unable to set dataspace extent\n");
+        ret_value = H5_ITER_STOP;
+        goto done;
+    }
+
+    /* Save the information for this chunk */
+    cb_info->selection_info->mem_space_id  = mem_selection_id;
+    cb_info->selection_info->file_space_id = cb_info->file_space_copy;
+    cb_info->selection_info->chunk_addr    = chunk_addr;
+
+    /* Retrieve the pieces of data (vectors) from the chunk and put them into the memory */
+    process_vectors(cb_info->task_queue, cb_info->rbuf, cb_info->selection_info);
 
-            /* Enlarge the size of the info for C and Re-allocate the memory if
-             * necessary */
-            if (info_count == info_size) {
-                info_size *= 2;
-                if ((info_stuff = (info_t *)realloc(info_stuff, info_size * sizeof(info_t))) == NULL) {
-                    fprintf(stderr, "failed to reallocate info table\n");
-                    ret_value = -1;
-                    goto done;
-                }
-            }
+done:
+    /* Close the space ID for the memory selection */
+    if (ret_value == H5_ITER_CONT) {
+        if (mem_selection_id > 0 && H5Sclose(mem_selection_id) < 0) {
+            fprintf(stderr, "unable to close memory selection\n");
+            ret_value = H5_ITER_STOP;
+        }
+    } else {
+        H5E_BEGIN_TRY {
+            H5Sclose(mem_selection_id);
+        } H5E_END_TRY;
+    }
 
-            /* Save the info in the structure */
-            strcpy(info_stuff[info_count].file_name, selection_info->file->u.file.name);
-            strcpy(info_stuff[info_count].dset_name, selection_info->dset_name);
-            info_stuff[info_count].dset_loc         = selection_info->chunk_addr;
-            info_stuff[info_count].data_offset_file = file_off[file_seq_i] / selection_info->dtype_size;
-            info_stuff[info_count].real_offset =
-                info_stuff[info_count].dset_loc + info_stuff[info_count].data_offset_file;
-            info_stuff[info_count].nelmts          = io_len / selection_info->dtype_size;
-            info_stuff[info_count].data_offset_mem = mem_off[mem_seq_i] / selection_info->dtype_size;
-            info_stuff[info_count].end_of_read     = false;
+    return ret_value;
+} /* process_chunk_cb */
 
-            // printf("%s: %d, info_count = %d, end_of_read = %d\n", __func__,
-            // __LINE__, info_count, info_stuff[info_count].end_of_read);
+static herr_t process_chunks(task_queue_t *task_queue, void *rbuf, void *dset, hid_t dcpl_id, hid_t dxpl_id,
+               hid_t mem_space, hid_t file_space, sel_info_t *selection_info, void **req,
+               bool *acquired_global, unsigned int *lock_count) {
+    herr_t ret_value = 0;
+    H5VL_bypass_t *dset_obj = (H5VL_bypass_t *)dset;
+    H5VL_native_dataset_optional_args_t dset_opt_args;
+    H5VL_optional_args_t opt_args;
+    chunk_cb_info_t chunk_cb_info;
+    chunk_xlate_t *xlate = NULL;
+    size_t nparts;
+    htri_t is_regular;
+    int d;
 
-            /* Increment the counter */
-            info_count++;
+    assert(dset_obj);
+    assert(dset_obj->under_object);
 
-	    if (pthread_mutex_unlock(&mutex_local) != 0) {
-		fprintf(stderr, "failed to unlock local mutex\n");
-		ret_value = -1;
-		goto done;
-	    }
-	}
-#endif
+    chunk_cb_info.file_space_copy = H5I_INVALID_HID;
 
-        /* Update file sequence */
-        if (io_len == file_len[file_seq_i])
-            file_seq_i++;
-        else {
-            file_off[file_seq_i] += io_len;
-            file_len[file_seq_i] -= io_len;
-        }
+    if ((chunk_cb_info.dset_dim_rank = H5Sget_simple_extent_ndims(file_space)) < 0) {
+        fprintf(stderr, "unable to get the file space rank of chunked dataset\n");
+        ret_value = -1;
+        goto done;
+    }
 
-        /* Update memory sequence */
-        if (io_len == mem_len[mem_seq_i])
-            mem_seq_i++;
-        else {
-            mem_off[mem_seq_i] += io_len;
-            mem_len[mem_seq_i] -= io_len;
+    /* Get selection type */
+    if ((chunk_cb_info.select_type = H5Sget_select_type(file_space)) < 0) {
+        fprintf(stderr, "unable to get the selection type of file space\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* Retrieve dataset dimensions */
+    if (H5Sget_simple_extent_dims(file_space, chunk_cb_info.dset_dims, NULL) < 0) {
+        fprintf(stderr, "failed to get dataset dimensions\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* Retrieve chunk dimensions from DCPL */
+    if (H5Pget_chunk(dcpl_id, chunk_cb_info.dset_dim_rank, chunk_cb_info.chunk_dims) < 0) {
+        fprintf(stderr, "failed to get chunk dimensions from DCPL\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    for (d = chunk_cb_info.dset_dim_rank - 1; d >= 0; d--)
+        chunk_cb_info.chunk_pitch[d] = (d == chunk_cb_info.dset_dim_rank - 1) ? 1 :
+            chunk_cb_info.chunk_pitch[d + 1] * chunk_cb_info.chunk_dims[d + 1];
+
+    /* When both selections are regular hyperslabs (or "all"), the box engine maps each chunk
+     * without creating, projecting or adjusting any dataspace */
+    chunk_cb_info.use_boxes = false;
+
+    if ((is_regular = get_hyper_box(file_space, &chunk_cb_info.file_box)) < 0 ||
+        (is_regular > 0 && (is_regular = get_hyper_box(mem_space, &chunk_cb_info.mem_box)) < 0)) {
+        fprintf(stderr, "failed to check for regular selections\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (is_regular > 0) {
+        if (chunk_cb_info.file_box.npoints != chunk_cb_info.mem_box.npoints) {
+            fprintf(stderr, "the number of selected elements in file (%" PRIuHSIZE ") isn't equal to the number in memory (%" PRIuHSIZE ")\n",
+                    chunk_cb_info.file_box.npoints, chunk_cb_info.mem_box.npoints);
+            ret_value = -1;
+            goto done;
         }
+
+        chunk_cb_info.use_boxes = true;
     }
 
-    /* If there is any leftover entries in the queue, signal the thread pool to
-     * read them.  The tasks have been enqueued earlier. */
-    if (local_count_for_signal > 0 && local_count_for_signal < nsteps_tpool) {
-        if (pthread_mutex_lock(&mutex_local) != 0) {
-	    printf("In %s of %s at line %d: pthread_mutex_lock failed\n", __func__, __FILE__, __LINE__);
-	    ret_value = -1;
-	    goto done;
+    /* Otherwise create a temporary dataspace that will have its select/extent modified during each
+     * chunk callback */
+    if (!chunk_cb_info.use_boxes && (chunk_cb_info.file_space_copy = H5Scopy(file_space)) < 0) {
+        fprintf(stderr, "failed to copy file space\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    chunk_cb_info.file_space = file_space;
+    chunk_cb_info.mem_space = mem_space;
+    chunk_cb_info.selection_info = selection_info;
+    chunk_cb_info.rbuf = rbuf;
+    chunk_cb_info.task_queue = task_queue;
+    chunk_cb_info.filters = dset_obj->u.dataset.filters;
+    chunk_cb_info.nfilters = dset_obj->u.dataset.num_filters;
+    chunk_cb_info.chunk_data = NULL;
+    chunk_cb_info.chunk_out = NULL;
+    chunk_cb_info.fill_chunk = false;
+    chunk_cb_info.chunk_nbytes = selection_info->dtype_size;
+
+    for (d = 0; d < chunk_cb_info.dset_dim_rank; d++)
+        chunk_cb_info.chunk_nbytes *= (size_t)chunk_cb_info.chunk_dims[d];
+
+    /* Filtered chunks are only decoded and encoded for the box engine, dataset_read() and dataset_write()
+     * check the selections first */
+    if (chunk_cb_info.nfilters > 0 && !chunk_cb_info.use_boxes) {
+        fprintf(stderr, "selections of filtered datasets must be regular hyperslabs\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    dset_opt_args.chunk_iter.op = process_chunk_cb;
+    dset_opt_args.chunk_iter.op_data = (void*)&chunk_cb_info;
+
+    /* In the pipelined mode, the thread pool starts on the first chunks while the rest are still being
+     * looked up.  Writes with chunks to allocate need them all collected first, so they aren't pipelined.
+     * Nor is anything when this thread can't let the library lock go between batches (its caller already
+     * held it), since the lookups would only run back to back under the lock. */
+    if (chunk_cb_info.use_boxes && chunk_cb_info.nfilters == 0 && task_queue == &queue_for_tpool &&
+        pipeline_chunks > 0 && !selection_info->write_behind && !selection_info->alloc_chunks &&
+        acquired_global && *acquired_global) {
+        if (process_chunks_pipelined(&chunk_cb_info, dset_obj, dxpl_id, req, acquired_global, lock_count) < 0) {
+            fprintf(stderr, "failed to process chunks in pipelined mode\n");
+            ret_value = -1;
         }
 
-        pthread_cond_broadcast(&cond_local);
+        goto done;
+    }
 
-        if (pthread_mutex_unlock(&mutex_local) != 0) {
-	    printf("In %s of %s at line %d: pthread_mutex_unlock failed\n", __func__, __FILE__, __LINE__);
-	    ret_value = -1;
-	    goto done;
+    /* The box engine doesn't call into the library, so the translation of chunk selections can be
+     * handed to the thread pool.  Only collect the touched chunks during the iteration here.  Filtered
+     * chunks are always collected, since they are decoded by the tasks, and so are the chunks of
+     * datasets read with their fill value or written with chunks to allocate, to find the chunks
+     * missing.  Data written behind is copied as it's translated, so that stays in the calling thread. */
+    if (chunk_cb_info.use_boxes && (chunk_cb_info.nfilters > 0 || selection_info->fill_size > 0 ||
+                                    selection_info->alloc_chunks ||
+                                    (queue_runs_in_pool(task_queue) && xlate_min_chunks > 0 &&
+                                     !selection_info->write_behind))) {
+        if ((xlate = (chunk_xlate_t *)calloc(1, sizeof(chunk_xlate_t))) == NULL) {
+            fprintf(stderr, "failed to allocate chunk list\n");
+            ret_value = -1;
+            goto done;
         }
+
+        atomic_init(&xlate->ref_count, 1);
+        xlate->cb_info = chunk_cb_info;
+        xlate->selection_info = *selection_info;
+        xlate->cb_info.selection_info = &xlate->selection_info;
+
+        dset_opt_args.chunk_iter.op = collect_chunk_cb;
+        dset_opt_args.chunk_iter.op_data = (void*)xlate;
     }
 
-    if (H5Ssel_iter_close(file_iter_id) < 0) {
-        fprintf(stderr, "failed to close file sel iterator\n");
+    opt_args.args = (void*) &dset_opt_args;
+    opt_args.op_type = H5VL_NATIVE_DATASET_CHUNK_ITER;
+
+    if (H5VLdataset_optional(dset_obj->under_object, dset_obj->under_vol_id, &opt_args, dxpl_id, req) < 0) {
+        fprintf(stderr, "failed to iterate over chunks for processing\n");
         ret_value = -1;
         goto done;
     }
 
-    if (H5Ssel_iter_close(mem_iter_id) < 0) {
-        fprintf(stderr, "failed to close mem sel iterator\n");
+    if (xlate && (selection_info->fill_size > 0 || selection_info->alloc_chunks ||
+                  (!selection_info->read_data && chunk_cb_info.nfilters > 0)) && add_missing_chunks(xlate) < 0) {
+        fprintf(stderr, "failed to find the chunks not allocated\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (xlate && selection_info->alloc_chunks && allocate_missing_chunks(dset_obj, xlate, dxpl_id, req) < 0) {
+        fprintf(stderr, "failed to allocate the chunks missing\n");
         ret_value = -1;
         goto done;
     }
 
+    if (xlate) {
+        if (chunk_cb_info.nfilters > 0)
+            /* Decoding dwarfs the translation: one task per chunk, so many are inflated at once */
+            nparts = queue_runs_in_pool(task_queue) ? xlate->nchunks : 0;
+        else if (!queue_runs_in_pool(task_queue) || xlate_min_chunks == 0 || selection_info->write_behind)
+            nparts = 0;
+        else {
+            nparts = MIN(xlate->nchunks / (size_t)xlate_min_chunks, (size_t)nthreads_tpool);
+
+            /* Not worth splitting up: translate in the calling thread */
+            if (nparts < 2)
+                nparts = 0;
+        }
+
+        /* The chunks written are stored by the library once they're encoded */
+        if (!selection_info->read_data && chunk_cb_info.nfilters > 0) {
+            ret_value = write_filtered_chunks(task_queue, xlate, nparts, dset_obj, dxpl_id, req, acquired_global,
+                                              lock_count);
+            xlate = NULL;
+            goto done;
+        }
+
+        /* The tasks own the chunk list from here on */
+        if (submit_xlate_tasks(task_queue, xlate, nparts) < 0) {
+            fprintf(stderr, "failed to submit chunk translation to thread pool\n");
+            ret_value = -1;
+        }
+
+        xlate = NULL;
+    }
+
 done:
+    if (xlate)
+        release_chunk_xlate(xlate);
+
+    if (chunk_cb_info.file_space_copy >= 0 && H5Sclose(chunk_cb_info.file_space_copy) < 0) {
+        fprintf(stderr, "failed to close file space copy\n");
+        ret_value = -1;
+    }
+
     return ret_value;
-} /* end of process_vectors() */
+} /* end process_chunks() */
 
-static int
-process_chunk_cb(const hsize_t *chunk_offsets, unsigned filter_mask,
-    haddr_t chunk_addr, hsize_t chunk_size, void *op_data) {
+/* Find the boxes of a read's selections and check them against the extent in the snapshot.  Only
+ * regular selections fully inside the extent qualify, anything else is left for the library to
+ * check and report. */
+static htri_t
+get_snapshot_boxes(const Bypass_dset_snapshot_t *snapshot, hid_t file_space_id, hid_t mem_space_id,
+                   chunk_cb_info_t *cb_info)
+{
+    const hyper_box_t *box;
+    htri_t is_regular;
+    int    b, d;
+    htri_t ret_value = 1;
 
-    /* Set to H5_ITER_STOP in case of error here - see note in lib documentation on H5D_chunk_iter_op_t */
-    herr_t ret_value = H5_ITER_CONT;
-    chunk_cb_info_t *cb_info = (chunk_cb_info_t *)op_data;
+    if (H5S_BLOCK == file_space_id || H5S_PLIST == file_space_id || H5S_BLOCK == mem_space_id ||
+        H5S_PLIST == mem_space_id) {
+        ret_value = 0;
+        goto done;
+    }
 
-    int select_npoints = 0;
-    hid_t mem_selection_id = H5I_INVALID_HID;
+    if (H5S_ALL == file_space_id) {
+        cb_info->file_box.rank = snapshot->rank;
+        memcpy(cb_info->file_box.dims, snapshot->dims, snapshot->rank * sizeof(hsize_t));
+        set_box_all(&cb_info->file_box);
+        set_box_pitches(&cb_info->file_box);
+    } else if ((is_regular = get_hyper_box(file_space_id, &cb_info->file_box)) <= 0) {
+        ret_value = is_regular;
+        goto done;
+    }
 
-    assert(cb_info);
+    /* The file space must have the extent the snapshot was taken with */
+    if (cb_info->file_box.rank != snapshot->rank) {
+        ret_value = 0;
+        goto done;
+    }
 
-    if (H5Sset_extent_simple(cb_info->file_space_copy, cb_info->dset_dim_rank, cb_info->dset_dims, NULL) < 0) {
-        fprintf(stderr, "unable to set the extent of the file space\n");
-        ret_value = H5_ITER_STOP;
+    for (d = 0; d < snapshot->rank; d++)
+        if (cb_info->file_box.dims[d] != snapshot->dims[d]) {
+            ret_value = 0;
+            goto done;
+        }
+
+    if (H5S_ALL == mem_space_id)
+        cb_info->mem_box = cb_info->file_box;
+    else if ((is_regular = get_hyper_box(mem_space_id, &cb_info->mem_box)) <= 0) {
+        ret_value = is_regular;
         goto done;
     }
 
-    /* Reset the file space copy to initial selection/extent */
-    // TBD - This may only be necessary if the selection is a hyperslab
-    if (H5Sselect_copy(cb_info->file_space_copy, cb_info->file_space) < 0) {
-        fprintf(stderr, "unable to copy file space\n");
-        ret_value = H5_ITER_STOP;
+    if (cb_info->file_box.npoints == 0 || cb_info->file_box.npoints != cb_info->mem_box.npoints) {
+        ret_value = 0;
+        goto done;
+    }
+
+    for (b = 0; b < 2; b++) {
+        box = b ? &cb_info->mem_box : &cb_info->file_box;
+
+        for (d = 0; d < box->rank; d++)
+            if (box->start[d] + (box->count[d] - 1) * box->stride[d] + box->block[d] > box->dims[d]) {
+                ret_value = 0;
+                goto done;
+            }
+    }
+
+    cb_info->dset_dim_rank = snapshot->rank;
+    cb_info->file_space_copy = H5I_INVALID_HID;
+    cb_info->use_boxes = true;
+
+    for (d = 0; d < snapshot->rank; d++) {
+        cb_info->dset_dims[d]  = snapshot->dims[d];
+        cb_info->chunk_dims[d] = (H5D_CHUNKED == snapshot->layout) ? snapshot->chunk_dims[d] : snapshot->dims[d];
+    }
+
+    for (d = snapshot->rank - 1; d >= 0; d--)
+        cb_info->chunk_pitch[d] = (d == snapshot->rank - 1) ? 1 :
+            cb_info->chunk_pitch[d + 1] * cb_info->chunk_dims[d + 1];
+
+done:
+    return ret_value;
+} /* end get_snapshot_boxes() */
+
+/* Read the datasets using only the snapshots of their metadata, so that the global lock of the
+ * library isn't held while the read is planned and done.  The selections are still queried with the
+ * H5S functions, each of which takes the lock for the time of the call only.  A contiguous dataset is mapped as a single chunk, and the chunks of a
+ * chunked dataset are looked up in the snapshot's chunk map instead of being iterated over by the
+ * library.  Nothing is done and 0 is returned if any of the reads needs the library. */
+static htri_t
+dataset_read_fast(size_t count, void *dset[], hid_t mem_type_id[], hid_t mem_space_id[], hid_t file_space_id[],
+                  void *buf[])
+{
+    Bypass_dset_snapshot_t **snapshots = NULL;
+    Bypass_dset_snapshot_t  *snapshot;
+    chunk_cb_info_t *cb_infos = NULL;
+    chunk_xlate_t   *xlate = NULL;
+    sel_info_t       selection_info;
+    task_queue_t     local_queue;
+    task_queue_t    *task_queue;
+    Bypass_task_t   *task = NULL;
+    const hyper_box_t *fbox;
+    hsize_t          first_idx[DIM_RANK_MAX], last_idx[DIM_RANK_MAX], idx[DIM_RANK_MAX];
+    hsize_t          chunk_offsets[DIM_RANK_MAX];
+    hsize_t          grid_idx;
+    hsize_t          storage_size;
+    size_t           nparts;
+    size_t           j;
+    atomic_int       local_task_count = 0;
+    atomic_int       local_task_errors = 0;
+    pthread_cond_t   local_condition;
+    bool             submitted = false;
+    htri_t           eligible;
+    int              d, t;
+    htri_t           ret_value = 1;
+
+    pthread_cond_init(&local_condition, NULL);
+
+    /* Make sure no garbage in any field */
+    memset(&local_queue, 0, sizeof(task_queue_t));
+
+    /* Each thread reads from its own task queue if 'BYPASS_VOL_NO_TPOOL' environment variable is set.
+     * The tasks reading many datasets are handed to the thread pool together once all are planned. */
+    local_queue.fused = !no_tpool && count > 1;
+    task_queue = (no_tpool || local_queue.fused) ? &local_queue : &queue_for_tpool;
+
+    if ((snapshots = (Bypass_dset_snapshot_t **)calloc(count, sizeof(Bypass_dset_snapshot_t *))) == NULL ||
+        (cb_infos = (chunk_cb_info_t *)calloc(count, sizeof(chunk_cb_info_t))) == NULL) {
+        fprintf(stderr, "failed to allocate snapshot list\n");
+        ret_value = -1;
         goto done;
     }
 
-    /* To calculate the intersection area in the next step, there must be a hyperslab selection to start
-        * with. If there is no hyperslab selection in the file dataspace, select the whole dataspace. */
-    if (H5S_SEL_HYPERSLABS != cb_info->select_type) {
-        if (H5Sselect_hyperslab(cb_info->file_space_copy, H5S_SELECT_SET,
-            ZERO_OFFSETS, NULL, cb_info->dset_dims, NULL) < 0) {
+    /* Check all the reads before queuing any I/O */
+    for (j = 0; j < count; j++) {
+        if (((H5VL_bypass_t *)dset[j])->type != H5I_DATASET ||
+            (snapshots[j] = grab_dset_snapshot(&((H5VL_bypass_t *)dset[j])->u.dataset)) == NULL ||
+            !snapshots[j]->usable) {
+            ret_value = 0;
+            goto done;
+        }
+
+        /* Only the memory types needing no conversion */
+        for (t = 0; t < snapshots[j]->nmem_types; t++)
+            if (mem_type_id[j] == snapshots[j]->mem_type_ids[t])
+                break;
+
+        if (t == snapshots[j]->nmem_types) {
+            ret_value = 0;
+            goto done;
+        }
+
+        /* The library must flush data of the dataset it may still hold first, which needs the lock */
+        storage_size = snapshots[j]->dtype_info.size;
+
+        for (d = 0; d < snapshots[j]->rank; d++)
+            storage_size *= snapshots[j]->dims[d];
+
+        if (dirty_range_hit((H5VL_bypass_t *)dset[j],
+                            (snapshots[j]->layout == H5D_CONTIGUOUS && !snapshots[j]->external) ? snapshots[j]->addr
+                                                                                                 : HADDR_UNDEF,
+                            storage_size)) {
+            ret_value = 0;
+            goto done;
+        }
+
+        if ((eligible = get_snapshot_boxes(snapshots[j], file_space_id[j], mem_space_id[j], &cb_infos[j])) <= 0) {
+            ret_value = eligible;
+            goto done;
+        }
+    }
+
+    for (j = 0; j < count; j++) {
+        snapshot = snapshots[j];
+
+        memset(&selection_info, 0, sizeof(sel_info_t));
+        selection_info.file = ((H5VL_bypass_t *)dset[j])->u.dataset.file;
+        selection_info.dtype_size = snapshot->dtype_info.size;
+        selection_info.chunk_addr = snapshot->addr;
+        selection_info.external = snapshot->external;
+        selection_info.num_external = snapshot->num_external;
+        selection_info.task_count_ptr = &local_task_count;
+        selection_info.task_error_ptr = &local_task_errors;
+        selection_info.local_condition_ptr = &local_condition;
+        selection_info.read_data = true;
+
+        cb_infos[j].selection_info = &selection_info;
+        cb_infos[j].rbuf = buf[j];
+        cb_infos[j].task_queue = task_queue;
+
+        /* From here on, wait for whatever has been queued even if something fails */
+        submitted = true;
+
+        /* The copy of a compact dataset is scattered into the buffer by this thread */
+        if (H5D_COMPACT == snapshot->layout) {
+            cb_infos[j].chunk_data = snapshot->compact_data;
+
+            if (process_chunk_boxes(&cb_infos[j], ZERO_OFFSETS, HADDR_UNDEF) < 0) {
+                fprintf(stderr, "unable to copy the selection in compact dataset\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            continue;
+        }
 
-            printf("In %s of %s at line %d: H5Sselect_hyperslab failed\n", __func__, __FILE__, __LINE__);
-            ret_value = H5_ITER_STOP;
+        if (H5D_CONTIGUOUS == snapshot->layout) {
+            if (process_chunk_boxes(&cb_infos[j], ZERO_OFFSETS, snapshot->addr) < 0) {
+                fprintf(stderr, "unable to map the selection in contiguous dataset\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            continue;
+        }
+
+        if ((xlate = (chunk_xlate_t *)calloc(1, sizeof(chunk_xlate_t))) == NULL) {
+            fprintf(stderr, "failed to allocate chunk list\n");
+            ret_value = -1;
             goto done;
         }
-    }
 
-    /* Get the intersection between file space selection and this chunk. In other words,
-     * get the file space selection falling into this chunk. */
-    if (H5Sselect_hyperslab(cb_info->file_space_copy, H5S_SELECT_AND, chunk_offsets, NULL, cb_info->chunk_dims, NULL) < 0) {
-        printf("In %s of %s at line %d: H5Sselect_hyperslab failed\n", __func__, __FILE__, __LINE__);
-        ret_value = H5_ITER_STOP;
-        goto done;
-    }
+        atomic_init(&xlate->ref_count, 1);
+        xlate->cb_info = cb_infos[j];
+        xlate->selection_info = selection_info;
+        xlate->cb_info.selection_info = &xlate->selection_info;
 
-    if ((select_npoints = H5Sget_select_npoints(cb_info->file_space_copy)) < 0) {
-        fprintf(stderr, "unable to get the number of points in file selection\n");
-        ret_value = H5_ITER_STOP;
-        goto done;
-    }
+        /* Walk the chunks covered by the selection in the chunk map */
+        fbox = &cb_infos[j].file_box;
 
-    /* No selection overlap; move on to the next chunk */
-    if (select_npoints == 0)
-        goto done;
+        for (d = 0; d < snapshot->rank; d++) {
+            first_idx[d] = fbox->start[d] / snapshot->chunk_dims[d];
+            last_idx[d]  = (fbox->start[d] + (fbox->count[d] - 1) * fbox->stride[d] + fbox->block[d] - 1) /
+                           snapshot->chunk_dims[d];
+            idx[d]       = first_idx[d];
+        }
 
-    /* Key function: get the data selection in memory which matches the file space selection falling
-     * into this chunk */
-    if ((mem_selection_id = H5Sselect_project_intersection(cb_info->file_space,
-        cb_info->mem_space, cb_info->file_space_copy)) < 0) {
-        fprintf(stderr, "unable to get projected dataspace intersection\n");
-        ret_value = H5_ITER_STOP;
-        goto done;
-    }
+        do {
+            grid_idx = 0;
 
-    /* Move the file space selection in this chunk to upper-left corner and adjust (shrink) its extent
-     * to the size of the chunk. In other words, the 'file_space_copy' that contains the data
-     * selection in file which falls into the current chunk is adjusted from the size of the dataset
-     * to the size of chunk which still contains the same data selection. 'chunk_addr' is the original
-     * point for 'file_space_copy'.
-     */
-    if (H5Sselect_adjust(cb_info->file_space_copy, chunk_offsets) < 0) {
-        printf("In %s of %s at line %d: H5Sselect_adjust failed\n", __func__, __FILE__, __LINE__);
-        ret_value = H5_ITER_STOP;
-        goto done;
-    }
+            for (d = 0; d < snapshot->rank; d++) {
+                chunk_offsets[d] = idx[d] * snapshot->chunk_dims[d];
+                grid_idx = grid_idx * snapshot->grid_dims[d] + idx[d];
+            }
 
-    if (H5Sset_extent_simple(cb_info->file_space_copy, cb_info->dset_dim_rank,
-        cb_info->chunk_dims, cb_info->chunk_dims) < 0) {
-        fprintf(stderr, "unable to set dataspace extent\n");
-        ret_value = H5_ITER_STOP;
-        goto done;
-    }
+            /* Skips the chunks the selection doesn't touch */
+            if (collect_chunk_cb(chunk_offsets, 0, snapshot->chunk_addrs[grid_idx], 0, xlate) != H5_ITER_CONT) {
+                fprintf(stderr, "failed to collect chunks\n");
+                ret_value = -1;
+                goto done;
+            }
 
-    /* Save the information for this chunk */
-    cb_info->selection_info->mem_space_id  = mem_selection_id;
-    cb_info->selection_info->file_space_id = cb_info->file_space_copy;
-    cb_info->selection_info->chunk_addr    = chunk_addr;
+            for (d = snapshot->rank - 1; d >= 0; d--) {
+                if (++idx[d] <= last_idx[d])
+                    break;
 
-    /* Retrieve the pieces of data (vectors) from the chunk and put them into the memory */
-    process_vectors(cb_info->task_queue, cb_info->rbuf, cb_info->selection_info);
+                idx[d] = first_idx[d];
+            }
+        } while (d >= 0);
 
-done:
-    /* Close the space ID for the memory selection */
-    if (ret_value == H5_ITER_CONT) {
-        if (mem_selection_id > 0 && H5Sclose(mem_selection_id) < 0) {
-            fprintf(stderr, "unable to close memory selection\n");
-            ret_value = H5_ITER_STOP;
+        nparts = 0;
+
+        if (queue_runs_in_pool(task_queue) && xlate_min_chunks > 0)
+            nparts = MIN(xlate->nchunks / (size_t)xlate_min_chunks, (size_t)nthreads_tpool);
+
+        /* Not worth splitting up: translate in the calling thread */
+        if (nparts < 2)
+            nparts = 0;
+
+        /* The tasks own the chunk list from here on */
+        if (submit_xlate_tasks(task_queue, xlate, nparts) < 0) {
+            fprintf(stderr, "failed to submit chunk translation\n");
+            ret_value = -1;
         }
-    } else {
-        H5E_BEGIN_TRY {
-            H5Sclose(mem_selection_id);
-        } H5E_END_TRY;
+
+        xlate = NULL;
+
+        if (ret_value < 0)
+            goto done;
     }
 
-    return ret_value;
-} /* process_chunk_cb */
+done:
+    if (xlate)
+        release_chunk_xlate(xlate);
 
-static herr_t process_chunks(task_queue_t *task_queue, void *rbuf, void *dset, hid_t dcpl_id, hid_t dxpl_id,
-               hid_t mem_space, hid_t file_space, sel_info_t *selection_info, void **req) {
-    herr_t ret_value = 0;
-    H5VL_bypass_t *dset_obj = (H5VL_bypass_t *)dset;
-    H5VL_native_dataset_optional_args_t dset_opt_args;
-    H5VL_optional_args_t opt_args;
-    chunk_cb_info_t chunk_cb_info;
+    if (submitted && no_tpool) {
+        while (local_queue.tasks_in_queue) {
+            if ((task = bypass_queue_pop(&local_queue, false)) == NULL) {
+                fprintf(stderr, "failed to pop task from queue\n");
+                ret_value = -1;
+                break;
+            }
 
-    assert(dset_obj);
-    assert(dset_obj->under_object);
+            if (run_task_stages(task, true) < 0) {
+                fprintf(stderr, "operate_data_io failed within file %s\n", task->file->u.file.name);
+                ret_value = -1;
+            }
 
-    if ((chunk_cb_info.dset_dim_rank = H5Sget_simple_extent_ndims(file_space)) < 0) {
-        fprintf(stderr, "unable to get the file space rank of chunked dataset\n");
-        ret_value = -1;
-        goto done;
-    }
+            bypass_task_release(task);
+        }
+    } else if (submitted) {
+        if (local_queue.fused && submit_fused_tasks(&local_queue) < 0) {
+            fprintf(stderr, "failed to hand the read tasks to the thread pool\n");
+            drop_fused_tasks(&local_queue);
+            ret_value = -1;
+        }
 
-    /* Get selection type */
-    if ((chunk_cb_info.select_type = H5Sget_select_type(file_space)) < 0) {
-        fprintf(stderr, "unable to get the selection type of file space\n");
-        ret_value = -1;
-        goto done;
-    }
+        /* Do not return until the thread pool finishes the read.  A failure may have skipped
+         * signal_leftover_tasks(), so wake the pool up for the tasks left in the queue. */
+        pthread_mutex_lock(&mutex_local);
 
-    /* Retrieve dataset dimensions */
-    if (H5Sget_simple_extent_dims(file_space, chunk_cb_info.dset_dims, NULL) < 0) {
-        fprintf(stderr, "failed to get dataset dimensions\n");
-        ret_value = -1;
-        goto done;
-    }
+        pthread_cond_broadcast(&cond_local);
 
-    /* Retrieve chunk dimensions from DCPL */
-    if (H5Pget_chunk(dcpl_id, chunk_cb_info.dset_dim_rank, chunk_cb_info.chunk_dims) < 0) {
-        fprintf(stderr, "failed to get chunk dimensions from DCPL\n");
-        ret_value = -1;
-        goto done;
-    }
+        while (atomic_load(&local_task_count) > 0)
+            pthread_cond_wait(&local_condition, &mutex_local);
 
-    /* Create a temporary dataspace that will have its select/extent modified during each
-     * chunk callback */
-    if ((chunk_cb_info.file_space_copy = H5Scopy(file_space)) < 0) {
-        fprintf(stderr, "failed to copy file space\n");
-        ret_value = -1;
-        goto done;
+        pthread_mutex_unlock(&mutex_local);
+
+        /* Any failed task makes the whole read fail */
+        if (atomic_load(&local_task_errors) > 0) {
+            fprintf(stderr, "%d tasks of the read failed\n", atomic_load(&local_task_errors));
+            ret_value = -1;
+        }
     }
 
-    chunk_cb_info.file_space = file_space;
-    chunk_cb_info.mem_space = mem_space;
-    chunk_cb_info.selection_info = selection_info;
-    chunk_cb_info.rbuf = rbuf;
-    chunk_cb_info.task_queue = task_queue;
+    /* The next selections are prefetched once this read is done, not competing with it */
+    if (ret_value > 0 && prefetch_max > 0)
+        for (j = 0; j < count; j++) {
+            fbox = &cb_infos[j].file_box;
 
-    dset_opt_args.chunk_iter.op = process_chunk_cb;
-    dset_opt_args.chunk_iter.op_data = (void*)&chunk_cb_info;
+            for (d = 0; d < snapshots[j]->rank; d++) {
+                first_idx[d] = fbox->start[d];
+                last_idx[d]  = fbox->start[d] + (fbox->count[d] - 1) * fbox->stride[d] + fbox->block[d] - 1;
+            }
 
-    opt_args.args = (void*) &dset_opt_args;
-    opt_args.op_type = H5VL_NATIVE_DATASET_CHUNK_ITER;
+            track_read_pattern((H5VL_bypass_t *)dset[j], snapshots[j], first_idx, last_idx);
+        }
 
-    if (H5VLdataset_optional(dset_obj->under_object, dset_obj->under_vol_id, &opt_args, dxpl_id, req) < 0) {
-        fprintf(stderr, "failed to iterate over chunks for processing\n");
-        ret_value = -1;
-        goto done;
-    }
+    if (snapshots) {
+        for (j = 0; j < count; j++)
+            if (snapshots[j])
+                release_dset_snapshot(snapshots[j]);
 
-done:
-    if (H5Sclose(chunk_cb_info.file_space_copy) < 0) {
-        fprintf(stderr, "failed to close file space copy\n");
-        ret_value = -1;
-        goto done;
+        free(snapshots);
     }
 
+    free(cb_infos);
+
+    pthread_cond_destroy(&local_condition);
+
     return ret_value;
-} /* end process_chunks() */
+} /* end dataset_read_fast() */
 
 /*-------------------------------------------------------------------------
  * Function:    H5VL_bypass_dataset_read
@@ -2636,16 +8231,33 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
     H5S_sel_type mem_sel_type = H5S_SEL_ERROR;
     H5S_sel_type file_sel_type = H5S_SEL_ERROR;
     bool types_equal = false;
+    bool types_swapped = false;
+    bool conv_swapped = false;
+    conv_func_t conv_func = NULL;
+    H5T_conv_except_func_t conv_except_func = NULL;
+    void *conv_except_data = NULL;
     bool must_block = false;
     bool locked = false;
     dtype_info_t mem_type_info;
     task_queue_t local_queue;
+    task_queue_t fused_queue;
+    task_queue_t *pool_queue;
     H5D_space_status_t dset_space_status = H5D_SPACE_STATUS_ERROR;
     bool         has_global = false, acquired_global = false;
     unsigned int lock_count = 1;
     atomic_int   local_task_count = 0;
+    atomic_int   local_task_errors = 0;
     int          load_local_task_count = 0;;
     pthread_cond_t  local_condition;
+    Bypass_dset_snapshot_t *snapshot = NULL;
+    htri_t       read_done = 0;
+    htri_t       is_regular;
+    htri_t       ext_opened;
+    htri_t       vds_read;
+    hssize_t     npoints;
+    hsize_t      storage_size;
+    hsize_t      read_start[H5S_MAX_RANK], read_end[H5S_MAX_RANK];
+    H5Z_EDC_t    edc_check = H5Z_ENABLE_EDC;
 
 #ifdef ENABLE_BYPASS_LOGGING
     printf("------- BYPASS  VOL DATASET Read\n");
@@ -2653,6 +8265,35 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 
     pthread_cond_init(&local_condition, NULL);
 
+    /* The tasks reading many datasets are handed to the thread pool together once all are planned, so
+     * they're done in the order of the file and put together where the datasets are next to each other */
+    memset(&fused_queue, 0, sizeof(task_queue_t));
+    fused_queue.fused = !no_tpool && count > 1;
+    pool_queue = fused_queue.fused ? &fused_queue : &queue_for_tpool;
+
+    /* Reads see the data of the writes done before, including those still being written behind to the
+     * same datasets.  The library reads the sources of a virtual dataset itself, which may be any
+     * dataset.  The data gathered in the aggregation buffers is written out by the reads overlapping it. */
+    for (j = 0; j < (int)count; j++) {
+        bypass_dset = &((H5VL_bypass_t *)dset[j])->u.dataset;
+
+        if ((bypass_dset->layout == H5D_VIRTUAL ? wait_file_write_behind(NULL)
+                                                : wait_write_behind(bypass_dset->object)) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+    }
+
+    /* Reads which can be mapped with the metadata snapshots of the datasets don't hold the global lock */
+    if ((read_done = dataset_read_fast(count, dset, mem_type_id, mem_space_id, file_space_id, buf)) < 0) {
+        fprintf(stderr, "failed to read datasets with their snapshots\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (read_done > 0)
+        goto done;
+
     if (H5TShave_mutex(&has_global) < 0) {
         fprintf(stderr, "In %s of %s at line %d: H5TShave_mutex failed\n", __func__, __FILE__, __LINE__);
         ret_value = -1;
@@ -2661,15 +8302,9 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
     //fprintf(stderr, "In %s of %s at line %d: has_global = %d\n", __func__, __FILE__, __LINE__, has_global);
 
     /* Grab the global lock of the HDF5 library */
-    if (!has_global) {
-	/* TODO: Use a condition variable instead of this while loop */
-        while (!acquired_global) {
-            if (H5TSmutex_acquire(lock_count, &acquired_global) < 0) {
-                fprintf(stderr, "In %s of %s at line %d: H5TSmutex_acquire failed\n", __func__, __FILE__, __LINE__);
-                ret_value = -1;
-                goto done;
-	    }
-        }
+    if (!has_global && acquire_global_mutex(lock_count, &acquired_global) < 0) {
+        ret_value = -1;
+        goto done;
     }
 
     /* Loop through all datasets and process them individually */
@@ -2705,6 +8340,13 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             goto done;
         }
 
+        /* Another handle of the dataset changed its extent */
+        if (bypass_dset->space_gen != atomic_load(&bypass_dset->object->gen) &&
+            refresh_dset_space(bypass_obj, plist_id, req) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
         // fprintf(stderr, "%s at %d: file_name = %s\n", __func__, __LINE__, file_name);
 
         selection_info.file = bypass_dset->file;
@@ -2734,6 +8376,27 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
         if (file_sel_type == H5S_SEL_NONE)
             continue;
 
+        /* The selection of a virtual dataset is read from its source datasets instead */
+        if (H5D_VIRTUAL == bypass_dset->layout && !bypass_dset->use_native && mem_space_id[j] != H5S_BLOCK &&
+            file_space_id[j] != H5S_BLOCK && mem_space_id[j] != H5S_PLIST && file_space_id[j] != H5S_PLIST) {
+            /* Flushing the virtual dataset flushes its sources written through it */
+            if (flush_dirty_ranges(dset[j], HADDR_UNDEF, 0, plist_id, req) < 0) {
+                fprintf(stderr, "failed to flush data cached by the library\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if ((vds_read = read_virtual_dataset(bypass_obj, mem_type_id[j], mem_space_id[j], file_space_id[j],
+                                                 plist_id, buf[j], req)) < 0) {
+                fprintf(stderr, "failed to read virtual dataset\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if (vds_read)
+                continue;
+        }
+
         if (get_dtype_info_helper(mem_type_id[j], &mem_type_info) < 0) {
             fprintf(stderr, "failed to get mem dtype info\n");
             ret_value = -1;
@@ -2742,26 +8405,101 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 
         types_equal = bypass_types_equal(&bypass_dset->dtype_info, &mem_type_info);
 
+        /* Data in the opposite byte order is read as it is and swapped in place by the thread pool */
+        types_swapped = !types_equal && bypass_types_swapped(&bypass_dset->dtype_info, &mem_type_info);
+
+        /* Other numbers are converted by the thread pool too, unless the application handles the
+         * exceptions of conversions itself */
+        conv_func = NULL;
+        conv_swapped = false;
+
+        if (!types_equal && !types_swapped) {
+            if (H5Pget_type_conv_cb(plist_id, &conv_except_func, &conv_except_data) < 0) {
+                fprintf(stderr, "failed to get conversion exception callback\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if (!conv_except_func)
+                conv_func = get_conv_func(&bypass_dset->dtype_info, &mem_type_info, &conv_swapped);
+        }
+
         if ((dset_space_status = get_dset_space_status(dset[j], plist_id, req)) < 0) {
             fprintf(stderr, "failed to get dataset space status\n");
             ret_value = -1;
             goto done;
         }
 
-        read_use_native = bypass_dset->use_native || !types_equal ||
-            mem_sel_type == H5S_SEL_POINTS || file_sel_type == H5S_SEL_POINTS
-            || dset_space_status != H5D_SPACE_STATUS_ALLOCATED || mem_space_id[j] == H5S_BLOCK
+        /* Take a snapshot of the metadata once the storage is allocated, for the later reads to go
+         * without holding the global lock */
+        if (!bypass_dset->use_native && dset_space_status == H5D_SPACE_STATUS_ALLOCATED) {
+            snapshot = grab_dset_snapshot(bypass_dset);
+
+            if ((snapshot == NULL || snapshot->space_status != H5D_SPACE_STATUS_ALLOCATED) &&
+                refresh_dset_snapshot(dset[j], plist_id, req) < 0) {
+                fprintf(stderr, "failed to take dataset snapshot\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if (snapshot)
+                release_dset_snapshot(snapshot);
+
+            snapshot = NULL;
+        }
+
+        /* Storage not allocated is read as the fill value: the whole selection of datasets with none,
+         * the chunks missing from chunked datasets with some */
+        read_use_native = bypass_dset->use_native || (!types_equal && !types_swapped && !conv_func) ||
+            bypass_dset->layout == H5D_COMPACT || bypass_dset->layout == H5D_VIRTUAL || mem_sel_type == H5S_SEL_POINTS || file_sel_type == H5S_SEL_POINTS
+            || (dset_space_status == H5D_SPACE_STATUS_PART_ALLOCATED && bypass_dset->layout != H5D_CHUNKED)
+            || mem_space_id[j] == H5S_BLOCK
             || file_space_id[j] == H5S_BLOCK || mem_space_id[j] == H5S_PLIST || file_space_id[j] == H5S_PLIST;
 
+        /* Filtered chunks are only decoded, and missing chunks only found, for regular selections */
+        if (!read_use_native &&
+            (bypass_dset->num_filters > 0 || dset_space_status == H5D_SPACE_STATUS_PART_ALLOCATED)) {
+            if ((is_regular = selections_are_regular(bypass_dset, mem_space_id[j], file_space_id[j])) < 0) {
+                fprintf(stderr, "failed to check for regular selections\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            read_use_native = !is_regular;
+        }
+
+        if (!read_use_native && bypass_dset->num_filters > 0) {
+            /* Checksums of filtered chunks are verified unless the application turned it off */
+            if ((edc_check = H5Pget_edc_check(plist_id)) < 0) {
+                fprintf(stderr, "failed to get error detection setting\n");
+                ret_value = -1;
+                goto done;
+            }
+        }
+
+        /* External files which can't be opened are left to the library to report */
+        if (!read_use_native && bypass_dset->num_external > 0) {
+            if ((ext_opened = open_external_files(dset[j], plist_id, req)) < 0) {
+                fprintf(stderr, "failed to open external files of dataset\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            read_use_native = !ext_opened;
+        }
+
         if (read_use_native) {
             /* Let go the global lock of the HDF5 library */
-	    if (acquired_global && H5TSmutex_release(&lock_count) != 0) {
-		fprintf(stderr, "In %s of %s at line %d: H5TSmutex_release failed\n", __func__, __FILE__, __LINE__);
-		ret_value = -1;
-		goto done;
-	    }
+            if (release_global_mutex(&lock_count, &acquired_global) < 0) {
+                ret_value = -1;
+                goto done;
+            }
 
-	    acquired_global = false;
+            /* The library reads the file itself */
+            if (flush_all_write_agg() < 0) {
+                ret_value = -1;
+                goto done;
+            }
 
             /* Populate the array of under objects */
             under_vol_id = ((H5VL_bypass_t *)(dset[0]))->under_vol_id;
@@ -2787,6 +8525,28 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
                 goto done;
             }
 
+            /* The tasks map the offsets in the data of the dataset to its external files */
+            if (bypass_dset->external) {
+                selection_info.chunk_addr   = 0;
+                selection_info.external     = bypass_dset->external;
+                selection_info.num_external = bypass_dset->num_external;
+            }
+
+            /* Data the library wrote to this dataset, or to any other in the same bytes, may still be in
+             * its caches.  Reads elsewhere in the file don't flush anything. */
+            if (bypass_dset->layout == H5D_CONTIGUOUS && !bypass_dset->external &&
+                (npoints = H5Sget_simple_extent_npoints(bypass_dset->space_id)) >= 0)
+                storage_size = (hsize_t)npoints * bypass_dset->dtype_info.size;
+            else
+                storage_size = 0;
+
+            if (flush_dirty_ranges(dset[j], storage_size > 0 ? selection_info.chunk_addr : HADDR_UNDEF,
+                                   storage_size, plist_id, req) < 0) {
+                fprintf(stderr, "failed to flush data cached by the library\n");
+                ret_value = -1;
+                goto done;
+            }
+
             /* Decide the dataspaces in memory and file */
             if (check_dspaces_helper(bypass_dset->space_id, file_space_id[j], &file_space_id_copy, mem_space_id[j],
                                      &mem_space_id_copy) < 0) {
@@ -2800,19 +8560,6 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             pthread_mutex_lock(&mutex_local);
             locked = true;
 
-            /* TODO: remove it because No need to flush the file */
-            /* Future optimization: Only flush when a write has been performed.
-             * Currently, some tests (specifically H5TEST-objcopy, likely others) fail because the Bypass VOL
-             * attempts to read a dataset under the assumption that all written data has been flushed to file,
-             * when in reality it is still cached. At the low level, this manifested as pread() being passed
-             * write requests that went out of bounds of the posix file.  By flushing before each file before
-             * read, we make sure that all previous writes are reflected in the filesystem.
-             */
-            /* if (flush_containing_file((H5VL_bypass_t *)dset[j]) < 0) {
-                fprintf(stderr, "failed to flush dataset\n");
-                ret_value = -1;
-                goto done;
-            } */
 
             /* At least one read is being done through the Bypass VOL.
              * We should block until all tasks are complete. */
@@ -2831,10 +8578,19 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             //printf("%s: %d: load_local_task_count = %d\n", __func__, __LINE__, load_local_task_count);
 
             selection_info.dtype_size = bypass_dset->dtype_info.size;
+            selection_info.swap_size  = (types_swapped || conv_swapped) ? bypass_dset->dtype_info.size : 0;
+
+            /* The selections are still mapped with the size of the file datatype, the tasks
+             * put the converted data where it belongs in the buffer */
+            selection_info.conv_func      = conv_func;
+            selection_info.mem_dtype_size = mem_type_info.size;
+            selection_info.mem_buf        = buf[j];
+            selection_info.skip_edc       = (edc_check == H5Z_DISABLE_EDC);
 
 	    /* When the application is multi-threaded, this pointer keeps track of the number of tasks
              * in the queue for the current thread */
 	    selection_info.task_count_ptr = &local_task_count;
+	    selection_info.task_error_ptr = &local_task_errors;
 
 	    /* When the application is multi-threaded, This pointer passes the local condition variable
              * for the current thread to the thread pool */
@@ -2843,7 +8599,26 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             /* Indicate this operation is a read */
             selection_info.read_data = true;
 
-            if (H5D_CHUNKED == bypass_dset->layout) {
+            /* The library converts the fill value to the memory datatype */
+            if (dset_space_status != H5D_SPACE_STATUS_ALLOCATED &&
+                get_read_fill_value(bypass_dset, mem_type_id[j], &selection_info) < 0) {
+                fprintf(stderr, "failed to get the fill value of dataset\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if (dset_space_status == H5D_SPACE_STATUS_NOT_ALLOCATED) {
+                /* Nothing to read: the memory selection is set to the fill value, or left as it is */
+                memset(&local_queue, 0, sizeof(task_queue_t));
+
+                if (selection_info.fill_size > 0 &&
+                    submit_fill_selection(no_tpool ? &local_queue : pool_queue, buf[j], mem_space_id_copy,
+                                          &selection_info) < 0) {
+                    fprintf(stderr, "failed to fill the selection of unallocated dataset\n");
+                    ret_value = -1;
+                    goto done;
+                }
+            } else if (H5D_CHUNKED == bypass_dset->layout) {
                 /* Iterate through all chunks and map the data selection in each chunk to the memory.
                  * Put the selections into a queue for the thread pool to read the data */
                 if (no_tpool) {
@@ -2852,11 +8627,19 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
                     /* Make sure no garbage in any field */
                     memset(&local_queue, 0, sizeof(task_queue_t));
 
-                    process_chunks(&local_queue, buf[j], dset[j], bypass_dset->dcpl_id, plist_id, mem_space_id_copy, file_space_id_copy,
-                                   &selection_info, req);
+                    if (process_chunks(&local_queue, buf[j], dset[j], bypass_dset->dcpl_id, plist_id, mem_space_id_copy,
+                                       file_space_id_copy, &selection_info, req, &acquired_global, &lock_count) < 0) {
+                        fprintf(stderr, "failed to process chunks\n");
+                        ret_value = -1;
+                        goto done;
+                    }
                 } else {
-                    process_chunks(&queue_for_tpool, buf[j], dset[j], bypass_dset->dcpl_id, plist_id, mem_space_id_copy, file_space_id_copy,
-                                   &selection_info, req);
+                    if (process_chunks(pool_queue, buf[j], dset[j], bypass_dset->dcpl_id, plist_id, mem_space_id_copy,
+                                       file_space_id_copy, &selection_info, req, &acquired_global, &lock_count) < 0) {
+                        fprintf(stderr, "failed to process chunks\n");
+                        ret_value = -1;
+                        goto done;
+                    }
                 }
             } else if (H5D_CONTIGUOUS == bypass_dset->layout) {
                 selection_info.file_space_id = file_space_id_copy;
@@ -2875,7 +8658,7 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 		    }
                 } else {
                     /* Use the global instance of task_queue_t for thread pool */
-		    if (process_vectors(&queue_for_tpool, buf[j], &selection_info) < 0) {
+		    if (process_vectors(pool_queue, buf[j], &selection_info) < 0) {
 			fprintf(stderr, "failed to insert vectors into queue\n");
 			ret_value = -1;
 			goto done;
@@ -2891,14 +8674,20 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
                 goto done;
             }
 
-            /* Let go the global lock of the HDF5 library */
-	    if (acquired_global && H5TSmutex_release(&lock_count) != 0) {
-		fprintf(stderr, "In %s of %s at line %d: H5TSmutex_release failed\n", __func__, __FILE__, __LINE__);
-		ret_value = -1;
-		goto done;
-	    }
+            /* The next selection is read ahead by the system alongside this one */
+            if (prefetch_max > 0 && (snapshot = grab_dset_snapshot(bypass_dset)) != NULL) {
+                if (H5Sget_select_bounds(file_space_id_copy, read_start, read_end) >= 0)
+                    track_read_pattern(bypass_obj, snapshot, read_start, read_end);
 
-	    acquired_global = false;
+                release_dset_snapshot(snapshot);
+                snapshot = NULL;
+            }
+
+            /* Let go the global lock of the HDF5 library */
+            if (release_global_mutex(&lock_count, &acquired_global) < 0) {
+                ret_value = -1;
+                goto done;
+            }
 
             /* Each thread reads from its own task queue if 'BYPASS_VOL_NO_TPOOL' environment variable is set */
             if (no_tpool) {
@@ -2911,7 +8700,7 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 			goto done;
 		    }
 
-		    if (operate_data_io(task->file->u.file.fd, task->vec_buf, task->size, task->addr, task->read_data) < 0) {
+		    if (run_task_stages(task, true) < 0) {
 			fprintf(stderr, "operate_data_io failed within file %s\n", task->file->u.file.name);
 			/* Return a failure code, but try to complete the rest of the read request.
 			 * This is important to properly decrement the reference count/num_reads on the local file object */
@@ -2964,6 +8753,12 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
     if (req && *req)
         *req = H5VL_bypass_new_obj(*req, under_vol_id);
 
+    if (fused_queue.fused && submit_fused_tasks(&fused_queue) < 0) {
+        fprintf(stderr, "failed to hand the read tasks to the thread pool\n");
+        ret_value = -1;
+        goto done;
+    }
+
     if (!no_tpool) {
 	/* Do not return until the thread pool finishes the read */
 	/* TBD: Enforcing this will become more complicated once multiple
@@ -2998,9 +8793,13 @@ H5VL_bypass_dataset_read(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 	}
 
 	locked = false;
-    }
 
-    pthread_cond_destroy(&local_condition);
+	/* Any failed task makes the whole read fail */
+	if (atomic_load(&local_task_errors) > 0) {
+	    fprintf(stderr, "%d tasks of the read failed\n", atomic_load(&local_task_errors));
+	    ret_value = -1;
+	}
+    }
 
     //fprintf(stderr, "%s: %d\n", __func__, __LINE__);
 
@@ -3008,13 +8807,37 @@ done:
     if (locked)
         pthread_mutex_unlock(&mutex_local);
 
+    /* Tasks never handed to the thread pool after a failure */
+    if (fused_queue.fused)
+        drop_fused_tasks(&fused_queue);
+
+    if (snapshot)
+        release_dset_snapshot(snapshot);
+
+    /* The tasks run by this thread without the thread pool may have staged data */
+    if (no_tpool)
+        release_thread_bufs();
+
     /* Let go the global lock of the HDF5 library */
-    if (acquired_global && H5TSmutex_release(&lock_count) != 0) {
-	fprintf(stderr, "In %s of %s at line %d: H5TSmutex_release failed\n", __func__, __FILE__, __LINE__);
-	ret_value = -1;
+    if (release_global_mutex(&lock_count, &acquired_global) < 0)
+        ret_value = -1;
+
+    /* The tasks queued by this call point to its counters and condition variable, so it waits for them
+     * even after a failure */
+    if (must_block && !no_tpool) {
+        pthread_mutex_lock(&mutex_local);
+
+        /* A failure may have skipped signal_leftover_tasks(), so wake the pool up for the tasks left
+         * in the queue */
+        pthread_cond_broadcast(&cond_local);
+
+        while (atomic_load(&local_task_count) > 0)
+            pthread_cond_wait(&local_condition, &mutex_local);
+
+        pthread_mutex_unlock(&mutex_local);
     }
 
-    acquired_global = false;
+    pthread_cond_destroy(&local_condition);
 
     return ret_value;
 } /* end H5VL_bypass_dataset_read() */
@@ -3035,6 +8858,7 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 {
 
     void  *o_arr[count]; /* Array of under objects */
+    H5VL_bypass_t *sync_files[count]; /* Files written through the Bypass VOL, to be synced with group commit */
     hid_t  under_vol_id; /* VOL ID for all objects */
     herr_t ret_value = 0;
 
@@ -3043,19 +8867,27 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
     H5VL_bypass_t *bypass_obj = NULL;
     Bypass_dataset_t *bypass_dset = NULL;
     sel_info_t   selection_info;
-    int          i;
+    int          i, j;
     bool         read_use_native   = false;
     H5S_sel_type mem_sel_type = H5S_SEL_ERROR;
     H5S_sel_type file_sel_type = H5S_SEL_ERROR;
     bool types_equal = false;
+    htri_t is_regular;
+    htri_t filters_encodable;
+    hssize_t npoints;
+    hsize_t storage_size;
+    haddr_t dirty_start, dirty_end;
     bool must_block = false;
     bool locked = false;
     dtype_info_t mem_type_info;
     task_queue_t local_queue;
+    task_queue_t fused_queue;
+    task_queue_t *pool_queue = &queue_for_tpool;
     H5D_space_status_t dset_space_status = H5D_SPACE_STATUS_ERROR;
     bool         has_global = false, acquired_global = false;
     unsigned int lock_count = 1;
     atomic_int   local_task_count = 0;
+    atomic_int   local_task_errors = 0;
     int          load_local_task_count = 0;;
     pthread_cond_t  local_condition;
 
@@ -3064,6 +8896,11 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
     printf("------- BYPASS  VOL DATASET Write\n");
 #endif
 
+    /* Like reads, the tasks writing many datasets are handed to the thread pool together, in the order
+     * of the file.  Writes done behind are queued right away, since their data is copied as it goes. */
+    memset(&fused_queue, 0, sizeof(task_queue_t));
+    fused_queue.fused = !no_tpool && count > 1;
+
     //fprintf(stderr, "%s: %d\n", __func__, __LINE__);
 
     pthread_cond_init(&local_condition, NULL);
@@ -3075,15 +8912,9 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
     }
 
     /* Grab the global lock of the HDF5 library */
-    if (!has_global) {
-	/* TODO: Use a condition variable instead of this while loop */
-        while (!acquired_global) {
-            if (H5TSmutex_acquire(lock_count, &acquired_global) < 0) {
-                fprintf(stderr, "In %s of %s at line %d: H5TSmutex_acquire failed\n", __func__, __FILE__, __LINE__);
-                ret_value = -1;
-                goto done;
-	    }
-        }
+    if (!has_global && acquire_global_mutex(lock_count, &acquired_global) < 0) {
+        ret_value = -1;
+        goto done;
     }
 
     /* Loop through all datasets and process them individually */
@@ -3096,6 +8927,7 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
         file_sel_type = H5S_SEL_ERROR;
         file_space_id_copy = H5I_INVALID_HID;
         mem_space_id_copy = H5I_INVALID_HID;
+        sync_files[i] = NULL;
 
         bypass_obj = (H5VL_bypass_t*)dset[i];
 
@@ -3115,6 +8947,13 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             goto done;
         }
 
+        /* Another handle of the dataset changed its extent */
+        if (bypass_dset->space_gen != atomic_load(&bypass_dset->object->gen) &&
+            refresh_dset_space(bypass_obj, plist_id, req) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
         selection_info.file = bypass_dset->file;
 
         /* Check selection type */
@@ -3159,21 +8998,54 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             goto done;
         }
 
-        read_use_native = bypass_dset->use_native || !types_equal ||
+        /* Chunks are only encoded with deflate, shuffle and Fletcher32, and always whole: datasets with
+         * other filters, or whose partial edge chunks aren't filtered, are written by the library.  So
+         * are compact datasets, whose data is in the object header, datasets in external files, which
+         * the library creates and extends, and virtual datasets.  Contiguous storage is allocated by
+         * the library on the first write, the chunks missing from chunked datasets by this connector. */
+        if ((filters_encodable = filters_writable(bypass_dset)) < 0) {
+            fprintf(stderr, "failed to check the filters of dataset\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        read_use_native = bypass_dset->use_native || !filters_encodable || !types_equal ||
+            bypass_dset->layout == H5D_COMPACT || bypass_dset->layout == H5D_VIRTUAL || bypass_dset->num_external > 0 ||
             mem_sel_type == H5S_SEL_POINTS || file_sel_type == H5S_SEL_POINTS
-            || dset_space_status != H5D_SPACE_STATUS_ALLOCATED || mem_space_id[i] == H5S_BLOCK
+            || (dset_space_status != H5D_SPACE_STATUS_ALLOCATED && bypass_dset->layout != H5D_CHUNKED)
+            || mem_space_id[i] == H5S_BLOCK
             || file_space_id[i] == H5S_BLOCK || mem_space_id[i] == H5S_PLIST || file_space_id[i] == H5S_PLIST;
 
+        /* Missing chunks are only found, and chunks encoded, for regular selections */
+        if (!read_use_native && (bypass_dset->num_filters > 0 || dset_space_status != H5D_SPACE_STATUS_ALLOCATED)) {
+            if ((is_regular = selections_are_regular(bypass_dset, mem_space_id[i], file_space_id[i])) < 0) {
+                fprintf(stderr, "failed to check for regular selections\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            read_use_native = !is_regular;
+            selection_info.alloc_chunks = is_regular && bypass_dset->num_filters == 0 &&
+                                          dset_space_status != H5D_SPACE_STATUS_ALLOCATED;
+        }
+
         if (read_use_native) {
             /* Let go the global lock of the HDF5 library */
-	    if (acquired_global && H5TSmutex_release(&lock_count) != 0) {
-		fprintf(stderr, "In %s of %s at line %d: H5TSmutex_release failed\n", __func__, __FILE__, __LINE__);
+            if (release_global_mutex(&lock_count, &acquired_global) < 0) {
+                ret_value = -1;
+                goto done;
+            }
+
+	    /* The library must not overwrite data still to be written behind or aggregated, or be
+	     * overwritten by it.  The bounds of the writes pending are left to the next write, since
+	     * others may come in once the lock is let go. */
+	    if ((bypass_dset->layout == H5D_VIRTUAL ? wait_file_write_behind(NULL)
+	                                            : wait_write_behind(bypass_dset->object)) < 0 ||
+	        flush_all_write_agg() < 0) {
 		ret_value = -1;
 		goto done;
 	    }
 
-	    acquired_global = false;
-
 	    /* Populate the array of under objects */
 	    under_vol_id = ((H5VL_bypass_t *)(dset[0]))->under_vol_id;
 
@@ -3185,6 +9057,29 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 		fprintf(stderr, "In %s of %s at line %d: H5VLdataset_write failed\n", __func__, __FILE__, __LINE__);
 		goto done;
 	    }
+
+	    /* The copies of a compact dataset in the snapshots of all its handles are out of date.  The
+	     * next read takes a new one.  Otherwise the library may keep the data in its caches until the
+	     * dataset is flushed, except for external files, which it writes right away. */
+	    if (bypass_dset->layout == H5D_COMPACT) {
+	        atomic_fetch_add(&bypass_dset->object->gen, 1);
+	        publish_dset_snapshot(bypass_dset, NULL);
+	    } else if (bypass_dset->num_external == 0) {
+	        dirty_start = HADDR_UNDEF;
+	        dirty_end   = HADDR_UNDEF;
+
+	        if (bypass_dset->layout == H5D_CONTIGUOUS &&
+	            (npoints = H5Sget_simple_extent_npoints(bypass_dset->space_id)) >= 0 &&
+	            get_dset_location(dset[i], plist_id, req, &dirty_start) >= 0 && dirty_start != HADDR_UNDEF)
+	            dirty_end = dirty_start + (haddr_t)npoints * bypass_dset->dtype_info.size;
+	        else
+	            dirty_start = HADDR_UNDEF;
+
+	        if (mark_dirty_range(dset[i], dirty_start, dirty_end) < 0) {
+	            ret_value = -1;
+	            goto done;
+	        }
+	    }
          } else { /* Coming into Bypass VOL when no data conversion and filter */
             if (get_dset_location(dset[i], plist_id, req, &selection_info.chunk_addr) < 0) {
                 fprintf(stderr, "failed to get file location of contiguous dataset\n");
@@ -3192,6 +9087,22 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
                 goto done;
             }
 
+            /* Data the library wrote to this dataset, or to any other in the same bytes, may still be in
+             * its caches, and would overwrite this write once flushed.  Partial chunks encoded again
+             * are also read back from the file. */
+            if (bypass_dset->layout == H5D_CONTIGUOUS && selection_info.chunk_addr != HADDR_UNDEF &&
+                (npoints = H5Sget_simple_extent_npoints(bypass_dset->space_id)) >= 0)
+                storage_size = (hsize_t)npoints * bypass_dset->dtype_info.size;
+            else
+                storage_size = 0;
+
+            if (flush_dirty_ranges(dset[i], storage_size > 0 ? selection_info.chunk_addr : HADDR_UNDEF,
+                                   storage_size, plist_id, req) < 0) {
+                fprintf(stderr, "failed to flush data cached by the library\n");
+                ret_value = -1;
+                goto done;
+            }
+
             /* Decide the dataspaces in memory and file */
             if (check_dspaces_helper(bypass_dset->space_id, file_space_id[i], &file_space_id_copy, mem_space_id[i],
                                      &mem_space_id_copy) < 0) {
@@ -3222,6 +9133,7 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 	    /* When the application is multi-threaded, this pointer keeps track of the number of tasks
              * in the queue for the current thread */
 	    selection_info.task_count_ptr = &local_task_count;
+	    selection_info.task_error_ptr = &local_task_errors;
 
 	    /* When the application is multi-threaded, This pointer passes the local condition variable
              * for the current thread to the thread pool */
@@ -3230,6 +9142,35 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             /* Indicate this operation is a write */
             selection_info.read_data = false;
 
+            /* Chunks written for the first time are filled before being encoded */
+            if (bypass_dset->num_filters > 0) {
+                selection_info.mem_dtype_size = mem_type_info.size;
+
+                if (get_read_fill_value(bypass_dset, mem_type_id[i], &selection_info) < 0) {
+                    fprintf(stderr, "failed to get the fill value of dataset\n");
+                    ret_value = -1;
+                    goto done;
+                }
+            }
+
+            /* Written behind, the tasks are counted apart from this call, which doesn't wait for them.
+             * Encoded chunks are stored by the library before the write returns. */
+            if (write_behind_max > 0 && !no_tpool && bypass_dset->num_filters == 0) {
+                if (order_write_behind(bypass_dset, file_space_id_copy) < 0) {
+                    ret_value = -1;
+                    goto done;
+                }
+
+                selection_info.write_behind = true;
+                selection_info.task_count_ptr = &bypass_dset->object->wb_tasks;
+                selection_info.task_error_ptr = &bypass_dset->object->wb_errors;
+                selection_info.local_condition_ptr = &bypass_dset->object->wb_cond;
+            }
+            else if (durability == DURABILITY_GROUP)
+                sync_files[i] = bypass_dset->file;
+
+            pool_queue = (fused_queue.fused && !selection_info.write_behind) ? &fused_queue : &queue_for_tpool;
+
             if (H5D_CHUNKED == bypass_dset->layout) {
                 /* Iterate through all chunks and map the data selection in each chunk to the memory.
                  * Put the selections into a queue for the thread pool to read the data */
@@ -3237,16 +9178,26 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
                     /* Make sure no garbage in any field */
                     memset(&local_queue, 0, sizeof(task_queue_t));
 
-                    process_chunks(&local_queue, buf[i], dset[i], bypass_dset->dcpl_id, plist_id, mem_space_id_copy, file_space_id_copy,
-                                   &selection_info, req);
+                    if (process_chunks(&local_queue, (void *)buf[i], dset[i], bypass_dset->dcpl_id, plist_id, mem_space_id_copy,
+                                       file_space_id_copy, &selection_info, req, &acquired_global, &lock_count) < 0) {
+                        fprintf(stderr, "failed to process chunks\n");
+                        ret_value = -1;
+                        goto done;
+                    }
                 } else {
-                    process_chunks(&queue_for_tpool, buf[i], dset[i], bypass_dset->dcpl_id, plist_id, mem_space_id_copy, file_space_id_copy,
-                                   &selection_info, req);
+                    if (process_chunks(pool_queue, (void *)buf[i], dset[i], bypass_dset->dcpl_id, plist_id, mem_space_id_copy,
+                                       file_space_id_copy, &selection_info, req, &acquired_global, &lock_count) < 0) {
+                        fprintf(stderr, "failed to process chunks\n");
+                        ret_value = -1;
+                        goto done;
+                    }
                 }
             } else if (H5D_CONTIGUOUS == bypass_dset->layout) {
                 selection_info.file_space_id = file_space_id_copy;
                 selection_info.mem_space_id  = mem_space_id_copy;
 
+                preallocate_dset(dset[i], selection_info.chunk_addr);
+
                 /* Handles the hyperslab selection and read the data */
                 if (no_tpool) {
                     /* Make sure no garbage in any field */
@@ -3260,7 +9211,7 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 		    }
                 } else {
                     /* Use the global instance of task_queue_t for thread pool */
-		    if (process_vectors(&queue_for_tpool, buf[i], &selection_info) < 0) {
+		    if (process_vectors(pool_queue, buf[i], &selection_info) < 0) {
 			fprintf(stderr, "failed to insert vectors into queue\n");
 			ret_value = -1;
 			goto done;
@@ -3273,13 +9224,10 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
             }
 
             /* Let go the global lock of the HDF5 library */
-	    if (acquired_global && H5TSmutex_release(&lock_count) != 0) {
-		fprintf(stderr, "In %s of %s at line %d: H5TSmutex_release failed\n", __func__, __FILE__, __LINE__);
-		ret_value = -1;
-		goto done;
-	    }
-
-	    acquired_global = false;
+            if (release_global_mutex(&lock_count, &acquired_global) < 0) {
+                ret_value = -1;
+                goto done;
+            }
 
             /* Each thread reads from its own task queue if 'BYPASS_VOL_NO_TPOOL' environment variable is set */
             if (no_tpool) {
@@ -3292,7 +9240,7 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 			goto done;
 		    }
 
-		    if (operate_data_io(task->file->u.file.fd, task->vec_buf, task->size, task->addr, task->read_data) < 0) {
+		    if (run_task_stages(task, true) < 0) {
 			fprintf(stderr, "operate_data_io failed within file %s\n", task->file->u.file.name);
 			/* Return a failure code, but try to complete the rest of the read request.
 			 * This is important to properly decrement the reference count/num_reads on the local file object */
@@ -3312,6 +9260,12 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
     if (req && *req)
         *req = H5VL_bypass_new_obj(*req, under_vol_id);
 
+    if (fused_queue.fused && submit_fused_tasks(&fused_queue) < 0) {
+        fprintf(stderr, "failed to hand the write tasks to the thread pool\n");
+        ret_value = -1;
+        goto done;
+    }
+
     if (!no_tpool) {
 	/* Do not return until the thread pool finishes the read */
 	/* TBD: Enforcing this will become more complicated once multiple
@@ -3346,9 +9300,31 @@ H5VL_bypass_dataset_write(size_t count, void *dset[], hid_t mem_type_id[], hid_t
 	}
 
 	locked = false;
+
+	/* Any failed task makes the whole write fail */
+	if (atomic_load(&local_task_errors) > 0) {
+	    fprintf(stderr, "%d tasks of the write failed\n", atomic_load(&local_task_errors));
+	    ret_value = -1;
+	}
     }
 
-    pthread_cond_destroy(&local_condition);
+    /* With group commit, the data is durable once the write returns.  The small writes still
+     * aggregated go out first. */
+    for (i = 0; i < count && ret_value >= 0; i++) {
+        if (!sync_files[i])
+            continue;
+
+        for (j = 0; j < i && sync_files[j] != sync_files[i]; j++)
+            ;
+
+        if (j < i)
+            continue;
+
+        if (flush_write_agg(sync_files[i]) < 0 || sync_file_data(&sync_files[i]->u.file) < 0) {
+            fprintf(stderr, "failed to make the data written durable\n");
+            ret_value = -1;
+        }
+    }
 
     //fprintf(stderr, "%s: %d\n", __func__, __LINE__);
 
@@ -3356,13 +9332,30 @@ done:
     if (locked)
         pthread_mutex_unlock(&mutex_local);
 
+    /* Tasks never handed to the thread pool after a failure */
+    if (fused_queue.fused)
+        drop_fused_tasks(&fused_queue);
+
     /* Let go the global lock of the HDF5 library */
-    if (acquired_global && H5TSmutex_release(&lock_count) != 0) {
-	fprintf(stderr, "In %s of %s at line %d: H5TSmutex_release failed\n", __func__, __FILE__, __LINE__);
-	ret_value = -1;
+    if (release_global_mutex(&lock_count, &acquired_global) < 0)
+        ret_value = -1;
+
+    /* The tasks queued by this call point to its counters and condition variable, so it waits for them
+     * even after a failure.  Those written behind are counted apart. */
+    if (must_block && !no_tpool) {
+        pthread_mutex_lock(&mutex_local);
+
+        /* A failure may have skipped signal_leftover_tasks(), so wake the pool up for the tasks left
+         * in the queue */
+        pthread_cond_broadcast(&cond_local);
+
+        while (atomic_load(&local_task_count) > 0)
+            pthread_cond_wait(&local_condition, &mutex_local);
+
+        pthread_mutex_unlock(&mutex_local);
     }
 
-    acquired_global = false;
+    pthread_cond_destroy(&local_condition);
 
     return ret_value;
 } /* end H5VL_bypass_dataset_write() */
@@ -3423,12 +9416,34 @@ H5VL_bypass_dataset_specific(void *obj, H5VL_dataset_specific_args_t *args, hid_
     // refresh destroying the current object
     under_vol_id = o->under_vol_id;
 
+    /* H5Dflush waits for the writes done behind, and so does changing the extent, which may free
+     * chunks still to be written */
+    if (args->op_type == H5VL_DATASET_FLUSH || args->op_type == H5VL_DATASET_SET_EXTENT) {
+        if (wait_write_behind(o->u.dataset.object) < 0 || flush_write_agg(o->u.dataset.file) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+
+        o->u.dataset.object->wb_pending = false;
+    }
+
     if (H5VLdataset_specific(o->under_object, o->under_vol_id, args, dxpl_id, req) < 0) {
         fprintf(stderr, "H5VLdataset_specific failed\n");
         ret_value = -1;
         goto done;
     }
 
+    /* The data cached by the library is in the file now, and goes to the disk as well unless the
+     * application doesn't care */
+    if (args->op_type == H5VL_DATASET_FLUSH) {
+        forget_dirty_range(o);
+
+        if (durability != DURABILITY_NONE && sync_file_data(&o->u.dataset.file->u.file) < 0) {
+            ret_value = -1;
+            goto done;
+        }
+    }
+
     /* Check for async request */
     if (req && *req) {
         *req = H5VL_bypass_new_obj(*req, under_vol_id);
@@ -3437,34 +9452,21 @@ H5VL_bypass_dataset_specific(void *obj, H5VL_dataset_specific_args_t *args, hid_
 
     /* If dataspace was changed, update the stored dataspace */
     if (args->op_type == H5VL_DATASET_SET_EXTENT) {
-        H5VL_dataset_get_args_t get_args;        
-
-        if (H5Sclose(o->u.dataset.space_id) < 0) {
-            fprintf(stderr, "unable to close old dataspace\n");
-            ret_value = -1;
-            goto done;
-        }
-        
-        o->u.dataset.space_id = H5I_INVALID_HID;
-
-        /* Figure out the dataset's dataspace */
-        get_args.op_type                 = H5VL_DATASET_GET_SPACE;
-        get_args.args.get_space.space_id = H5I_INVALID_HID;
+        /* The other handles of the dataset drop their snapshots and dataspaces */
+        atomic_fetch_add(&o->u.dataset.object->gen, 1);
 
-        /* Retrieve the dataset's dataspace ID */
-        if (H5VLdataset_get(o->under_object, o->under_vol_id, &get_args, dxpl_id, req) < 0) {
-            fprintf(stderr, "unable to get opened dataset's dataspace\n");
+        if (refresh_dset_space(o, dxpl_id, req) < 0) {
             ret_value = -1;
             goto done;
         }
 
-        if (get_args.args.get_space.space_id == H5I_INVALID_HID) {
-            fprintf(stderr, "retrieved invalid dataspace for dataset\n");
+        /* Replace the snapshot of a dataset read without holding the library lock, since the extent and
+         * possibly the chunks changed */
+        if (o->u.dataset.snapshot && refresh_dset_snapshot(o, dxpl_id, req) < 0) {
+            fprintf(stderr, "unable to refresh dataset snapshot\n");
             ret_value = -1;
             goto done;
         }
-
-        o->u.dataset.space_id = get_args.args.get_space.space_id;
     }
 
 done:
@@ -3519,6 +9521,7 @@ static herr_t
 H5VL_bypass_dataset_close(void *dset, hid_t dxpl_id, void **req)
 {
     H5VL_bypass_t *o = (H5VL_bypass_t *)dset;
+    herr_t         wb_status;
     herr_t         ret_value = 0;
 
     
@@ -3532,6 +9535,22 @@ H5VL_bypass_dataset_close(void *dset, hid_t dxpl_id, void **req)
     assert(o->u.dataset.file->u.file.ref_count > 0);
     */
 
+    /* The writes done behind or aggregated must be out before the dataset goes, since the library may
+     * free its storage.  If any of them failed, the close fails but still goes through. */
+    wb_status = wait_write_behind(o->u.dataset.object);
+
+    if (flush_write_agg(o->u.dataset.file) < 0)
+        wb_status = -1;
+
+    /* Closing the last handle of the dataset flushes its caches in the library.  While other handles
+     * keep it open, the caches are flushed now, since the range may name this handle. */
+    if (o->u.dataset.object && o->u.dataset.object->ref_count > 1) {
+        if (flush_dirty_ranges(o, HADDR_UNDEF, 0, dxpl_id, req) < 0)
+            wb_status = -1;
+    }
+    else
+        forget_dirty_range(o);
+
     if (H5VLdataset_close(o->under_object, o->under_vol_id, dxpl_id, req) < 0) {
         fprintf(stderr, "Failed to close dataset in underlying connectors\n");
         ret_value = -1;
@@ -3546,6 +9565,9 @@ H5VL_bypass_dataset_close(void *dset, hid_t dxpl_id, void **req)
     if (ret_value >= 0)
         H5VL_bypass_free_obj(o);
 
+    if (wb_status < 0)
+        ret_value = -1;
+
 done:
     return ret_value;
 } /* end H5VL_bypass_dataset_close() */
@@ -3796,6 +9818,12 @@ c_file_open_helper(H5VL_bypass_t *obj, const char *name, unsigned flags)
         goto done;
     }
 
+    /* The other handles of the same file are found by its device and inode */
+    if (attach_shared_file(file) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
     /* Initialize the reference count for this file */
     file->ref_count = 1;
 
@@ -3807,10 +9835,119 @@ c_file_open_helper(H5VL_bypass_t *obj, const char *name, unsigned flags)
     /* Initialize the condition variable for file closing. */
     pthread_cond_init(&(file->close_ready), NULL);
 
+    pthread_mutex_init(&file->sync_mutex, NULL);
+    pthread_cond_init(&file->sync_cond, NULL);
+
+    file->sync_requested = 0;
+    file->sync_done      = 0;
+    file->syncing        = false;
+    file->sync_failed    = false;
+
+    /* Files opened for writing gather small writes */
+    pthread_mutex_init(&file->agg_mutex, NULL);
+
+    file->agg_len = 0;
+
+    if (write_agg_size > 0 && file->flags == O_RDWR) {
+        if ((file->agg_buf = malloc(write_agg_size)) == NULL) {
+            fprintf(stderr, "failed to allocate write aggregation buffer\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        pthread_mutex_lock(&write_agg_files_mutex);
+        file->agg_next  = write_agg_files;
+        write_agg_files = file;
+        pthread_mutex_unlock(&write_agg_files_mutex);
+
+        atomic_fetch_add(&file->shared->nagg, 1);
+    }
+
 done:
     return ret_value;
 } /* c_file_open_helper */
 
+static herr_t
+attach_shared_file(Bypass_file_t *file)
+{
+    Bypass_shared_file_t *shared;
+    struct stat           sb;
+    herr_t                ret_value = 0;
+
+    if (fstat(file->fd, &sb) < 0) {
+        fprintf(stderr, "failed to get the status of file %s: %s\n", file->name, strerror(errno));
+        ret_value = -1;
+        goto done;
+    }
+
+    pthread_mutex_lock(&shared_files_mutex);
+
+    for (shared = shared_files; shared; shared = shared->next)
+        if (shared->dev == sb.st_dev && shared->ino == sb.st_ino)
+            break;
+
+    if (!shared) {
+        if ((shared = (Bypass_shared_file_t *)calloc(1, sizeof(Bypass_shared_file_t))) == NULL) {
+            pthread_mutex_unlock(&shared_files_mutex);
+            fprintf(stderr, "failed to allocate shared file record\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        shared->dev = sb.st_dev;
+        shared->ino = sb.st_ino;
+        atomic_init(&shared->nagg, 0);
+
+        /* The datasets written by the library through any handle of the file */
+        pthread_mutex_init(&shared->dirty_mutex, NULL);
+        atomic_init(&shared->ndirty, 0);
+
+        shared->next = shared_files;
+        shared_files = shared;
+    }
+
+    shared->ref_count++;
+    file->shared = shared;
+
+    pthread_mutex_unlock(&shared_files_mutex);
+
+done:
+    return ret_value;
+} /* end attach_shared_file() */
+
+static void
+detach_shared_file(Bypass_file_t *file)
+{
+    if (!file->shared)
+        return;
+
+    pthread_mutex_lock(&shared_files_mutex);
+
+    /* The datasets are closed before their file, but a barrier may still hold one */
+    if (--file->shared->ref_count == 0 && file->shared->objects == NULL)
+        free_shared_file(file->shared);
+
+    pthread_mutex_unlock(&shared_files_mutex);
+
+    file->shared = NULL;
+} /* end detach_shared_file() */
+
+static void
+free_shared_file(Bypass_shared_file_t *shared)
+{
+    Bypass_shared_file_t **prev;
+
+    for (prev = &shared_files; *prev != shared; prev = &(*prev)->next)
+        ;
+
+    *prev = shared->next;
+
+    free(shared->dirty);
+    pthread_mutex_destroy(&shared->dirty_mutex);
+
+    free(shared);
+} /* end free_shared_file() */
+
 /*-------------------------------------------------------------------------
  * Function:    H5VL_bypass_file_create
  *
@@ -4144,6 +10281,12 @@ H5VL_bypass_file_specific(void *file, H5VL_file_specific_args_t *args, hid_t dxp
 
     assert(o == NULL || o->type == H5I_FILE);
 
+    /* H5Fflush waits for the writes done behind and writes out the aggregated ones */
+    if (args->op_type == H5VL_FILE_FLUSH &&
+        (wait_file_write_behind(o ? o->u.file.shared : NULL) < 0 ||
+         (o ? flush_write_agg(o) : flush_all_write_agg()) < 0))
+        return (-1);
+
     /* Check for 'is accessible' operation */
     if (args->op_type == H5VL_FILE_IS_ACCESSIBLE) {
         /* Make a (shallow) copy of the arguments */
@@ -4216,6 +10359,11 @@ H5VL_bypass_file_specific(void *file, H5VL_file_specific_args_t *args, hid_t dxp
 
     ret_value = H5VLfile_specific(new_o, under_vol_id, new_args, dxpl_id, req);
 
+    /* The library has written out its caches, all of it goes to the disk now */
+    if (ret_value >= 0 && args->op_type == H5VL_FILE_FLUSH && o && durability != DURABILITY_NONE &&
+        sync_file_data(&o->u.file) < 0)
+        ret_value = -1;
+
     /* Check for async request */
     if (req && *req)
         *req = H5VL_bypass_new_obj(*req, under_vol_id);
@@ -4309,6 +10457,7 @@ static herr_t
 H5VL_bypass_file_close(void *file, hid_t dxpl_id, void **req)
 {
     H5VL_bypass_t *o = (H5VL_bypass_t *)file;
+    herr_t         wb_status;
     herr_t         ret_value;
 
 #ifdef ENABLE_BYPASS_LOGGING
@@ -4318,6 +10467,12 @@ H5VL_bypass_file_close(void *file, hid_t dxpl_id, void **req)
     assert(o->type == H5I_FILE);
     assert(o->u.file.ref_count > 0);
 
+    /* The tasks writing behind use the file until they're done, and the aggregated writes go out */
+    wb_status = wait_file_write_behind(o->u.file.shared);
+
+    if (flush_write_agg(o) < 0)
+        wb_status = -1;
+
     /* Release our wrapper, if underlying file was closed */
     pthread_mutex_lock(&mutex_local);
 
@@ -4337,6 +10492,9 @@ H5VL_bypass_file_close(void *file, hid_t dxpl_id, void **req)
         goto done;
     }
 
+    if (wb_status < 0)
+        ret_value = -1;
+
 done:
     pthread_mutex_unlock(&mutex_local);
 
@@ -4936,14 +11094,16 @@ H5VL_bypass_object_open(void *obj, const H5VL_loc_params_t *loc_params, H5I_type
 
     switch (new_obj->type) {
         case H5I_DATASET: {
+            fprintf(stderr, "Bypass VOL file up due to object (dset) open: %d -> %d\n", parent_file->u.file.ref_count, parent_file->u.file.ref_count + 1);
+            parent_file->u.file.ref_count++;
+            new_obj->u.dataset.file = parent_file;
+
+            /* The dataset is found among the others of its file */
             if (dset_open_helper(new_obj, dxpl_id, req) < 0) {
                 fprintf(stderr, "failed to populate bypass object\n");
                 goto error;
             }
 
-            fprintf(stderr, "Bypass VOL file up due to object (dset) open: %d -> %d\n", parent_file->u.file.ref_count, parent_file->u.file.ref_count + 1);
-            parent_file->u.file.ref_count++;
-            new_obj->u.dataset.file = parent_file;
             break;
         }
 
@@ -5546,99 +11706,59 @@ H5VL_bypass_token_from_str(void *obj, H5I_type_t obj_type, const char *token_str
  *
  * Return:      SUCCEED / FAIL
  *
- *-------------------------------------------------------------------------
- */
-herr_t
-H5VL_bypass_optional(void *obj, H5VL_optional_args_t *args, hid_t dxpl_id, void **req)
-{
-    H5VL_bypass_t *o = (H5VL_bypass_t *)obj;
-    herr_t         ret_value = 0;
-
-#ifdef ENABLE_BYPASS_LOGGING
-    printf("------- BYPASS VOL generic Optional\n");
-#endif
-
-    ret_value = H5VLoptional(o->under_object, o->under_vol_id, args, dxpl_id, req);
-
-    return ret_value;
-} /* end H5VL_bypass_optional() */
-
-static herr_t
-should_dset_use_native(Bypass_dataset_t* dset, bool read_data) {
-    int num_ext_files = 0;
-    herr_t ret_value = 0;
-
-    assert(dset);
-
-    if (dset->num_filters > 0) {
-        dset->use_native = true;
-        dset->use_native_checked = true;
-        goto done;
-    }
-        
-    if (H5D_VIRTUAL == dset->layout) {
-        dset->use_native = true;
-        dset->use_native_checked = true;
-
-        goto done;
-    }
-
-    if (H5T_INTEGER != dset->dtype_info.class) {
-        dset->use_native = true;
-        dset->use_native_checked = true;
-
-        goto done;
-    }
-
-    /* Some non-numeric library types (e.g. H5T_NATIVE_UCHAR) use the H5T_INTEGER class.
-     * This is a hack to avoid using the Bypass VOL for datatypes that are not equivalent to H5T_NATIVE_INT */
-    if (dset->dtype_info.size != sizeof(int)) {
-        dset->use_native = true;
-        dset->use_native_checked = true;
+ *-------------------------------------------------------------------------
+ */
+herr_t
+H5VL_bypass_optional(void *obj, H5VL_optional_args_t *args, hid_t dxpl_id, void **req)
+{
+    H5VL_bypass_t *o = (H5VL_bypass_t *)obj;
+    herr_t         ret_value = 0;
 
-        goto done;
-    }
+#ifdef ENABLE_BYPASS_LOGGING
+    printf("------- BYPASS VOL generic Optional\n");
+#endif
 
-    /* For now, the Bypass VOL only supports signed integers */
-    if (dset->dtype_info.sign != H5T_SGN_2) {
-        dset->use_native = true;
-        dset->use_native_checked = true;
+    ret_value = H5VLoptional(o->under_object, o->under_vol_id, args, dxpl_id, req);
 
-        goto done;
-    }
+    return ret_value;
+} /* end H5VL_bypass_optional() */
 
-    if (dset->layout == H5D_COMPACT) {
-        dset->use_native = true;
-        dset->use_native_checked = true;
+static herr_t
+should_dset_use_native(Bypass_dataset_t* dset, bool read_data) {
+    off_t   ext_offset;
+    hsize_t ext_size;
+    int i;
+    herr_t ret_value = 0;
 
-        goto done;
-    }
+    assert(dset);
 
-    /* If external link is used, let the native library handle it */
-    if ((num_ext_files = H5Pget_external_count(dset->dcpl_id)) < 0) {
-        fprintf(stderr, "failed to get external file count\n");
-        ret_value = -1;
-        goto done;
+    /* Chunks with filters the Bypass VOL can't undo are left to the library */
+    for (i = 0; i < dset->num_filters; i++) {
+        if (!filter_supported(&dset->filters[i])) {
+            dset->use_native = true;
+            dset->use_native_checked = true;
+            goto done;
+        }
     }
 
-    if (num_ext_files > 0) {
+    /* Only fixed-size integer and floating-point data can be copied as it is.  Whether the memory
+     * type of a read or write has the same representation is checked against dtype_info later. */
+    if (H5T_INTEGER != dset->dtype_info.class && H5T_FLOAT != dset->dtype_info.class) {
         dset->use_native = true;
         dset->use_native_checked = true;
 
         goto done;
     }
 
-    /* For writing data, Bypass VOL only supports early allocation time */
-    if (!read_data) {
-        H5D_alloc_time_t alloc_time;
-
-        if (H5Pget_alloc_time(dset->dcpl_id, &alloc_time) < 0) {
-            fprintf(stderr, "failed to get allocation time for chunked dataset\n");
+    /* External files are read by the Bypass VOL as long as no element straddles two of them */
+    for (i = 0; i < dset->num_external; i++) {
+        if (H5Pget_external(dset->dcpl_id, (unsigned)i, 0, NULL, &ext_offset, &ext_size) < 0) {
+            fprintf(stderr, "failed to get external file\n");
             ret_value = -1;
             goto done;
         }
 
-        if (alloc_time != H5D_ALLOC_TIME_EARLY) {
+        if (ext_size != H5F_UNLIMITED && ext_size % dset->dtype_info.size != 0) {
             dset->use_native = true;
             dset->use_native_checked = true;
 
@@ -5656,6 +11776,9 @@ release_dset_info(Bypass_dataset_t *dset) {
 
     assert(dset);
 
+    /* The dataset's record goes with its last handle, before the file's */
+    detach_dset_object(dset);
+
     /* Decrement the ref count of the corresponding Bypass VOL file object */
     //if (H5VL_bypass_file_close((void*) dset->file, H5P_DEFAULT, NULL) < 0) {
     if (H5VL_bypass_free_obj(dset->file) < 0) {
@@ -5683,6 +11806,20 @@ release_dset_info(Bypass_dataset_t *dset) {
     dset->num_filters = 0;
     dset->layout = H5D_LAYOUT_ERROR;
 
+    /* Reads still holding the snapshot free it themselves */
+    publish_dset_snapshot(dset, NULL);
+    pthread_mutex_destroy(&dset->snapshot_mutex);
+    pthread_mutex_destroy(&dset->pattern_mutex);
+
+    close_external_files(dset);
+    dset->num_external = 0;
+
+    if (dset->vds_sources)
+        close_vds_sources(dset->vds_sources, dset->num_vds_sources);
+
+    dset->vds_sources = NULL;
+    dset->num_vds_sources = 0;
+
 done:
     if (ret_value < 0) {
         H5E_BEGIN_TRY {
@@ -5698,6 +11835,7 @@ done:
 
 static herr_t
 release_file_info(Bypass_file_t *file) {
+    Bypass_file_t **prev;
     herr_t ret_value = 0;
 
     assert(file);
@@ -5713,6 +11851,38 @@ release_file_info(Bypass_file_t *file) {
 
     pthread_mutex_unlock(&mutex_local);
 
+    /* The small writes still buffered go out before the file is closed */
+    if (file->agg_buf) {
+        pthread_mutex_lock(&write_agg_files_mutex);
+
+        for (prev = &write_agg_files; *prev && *prev != file; prev = &(*prev)->agg_next)
+            ;
+
+        if (*prev) {
+            *prev = file->agg_next;
+            atomic_fetch_sub(&file->shared->nagg, 1);
+        }
+
+        pthread_mutex_unlock(&write_agg_files_mutex);
+
+        if (drain_write_agg(file, false) < 0)
+            ret_value = -1;
+
+        free(file->agg_buf);
+        file->agg_buf = NULL;
+    }
+
+    pthread_mutex_destroy(&file->agg_mutex);
+
+    /* Written through the library or not, the data is on the disk once the file is closed */
+    if (durability != DURABILITY_NONE && sync_file_data(file) < 0)
+        ret_value = -1;
+
+    pthread_mutex_destroy(&file->sync_mutex);
+    pthread_cond_destroy(&file->sync_cond);
+
+    detach_shared_file(file);
+
     /* Clean up the file object */
     if (close(file->fd) < 0) {
         fprintf(stderr, "failed to close file descriptor: %s\n", strerror(errno));
@@ -5842,6 +12012,49 @@ get_dtype_info_helper(hid_t type_id, dtype_info_t *type_info_out) {
     } else {
         type_info_out->sign = H5T_SGN_ERROR;
     }
+
+    /* The bit layout only means something for the atomic numeric classes */
+    if (type_info_out->class != H5T_INTEGER && type_info_out->class != H5T_FLOAT)
+        goto done;
+
+    if ((type_info_out->precision = H5Tget_precision(type_id)) == 0) {
+        fprintf(stderr, "unable to get dataset's datatype precision\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((type_info_out->offset = H5Tget_offset(type_id)) < 0) {
+        fprintf(stderr, "unable to get dataset's datatype offset\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (H5Tget_pad(type_id, &type_info_out->lsb_pad, &type_info_out->msb_pad) < 0) {
+        fprintf(stderr, "unable to get dataset's datatype padding\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (type_info_out->class == H5T_FLOAT) {
+        if (H5Tget_fields(type_id, &type_info_out->spos, &type_info_out->epos, &type_info_out->esize,
+                          &type_info_out->mpos, &type_info_out->msize) < 0) {
+            fprintf(stderr, "unable to get dataset's datatype fields\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if ((type_info_out->ebias = H5Tget_ebias(type_id)) == 0) {
+            fprintf(stderr, "unable to get dataset's datatype exponent bias\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if ((type_info_out->norm = H5Tget_norm(type_id)) == H5T_NORM_ERROR) {
+            fprintf(stderr, "unable to get dataset's datatype normalization\n");
+            ret_value = -1;
+            goto done;
+        }
+    }
 done:
     return ret_value;
 }
@@ -5863,9 +12076,103 @@ static bool bypass_types_equal(dtype_info_t *type_info1, dtype_info_t *type_info
             ret_value = false;
     }
 
+    /* Same size and order isn't enough: the significant bits and their padding must line up too */
+    if (ret_value && (type_info1->class == H5T_INTEGER || type_info1->class == H5T_FLOAT)) {
+        if (type_info1->precision != type_info2->precision || type_info1->offset != type_info2->offset ||
+            type_info1->lsb_pad != type_info2->lsb_pad || type_info1->msb_pad != type_info2->msb_pad)
+            ret_value = false;
+    }
+
+    /* IEEE and other float formats of the same size differ in where their fields are */
+    if (ret_value && type_info1->class == H5T_FLOAT) {
+        if (type_info1->spos != type_info2->spos || type_info1->epos != type_info2->epos ||
+            type_info1->esize != type_info2->esize || type_info1->mpos != type_info2->mpos ||
+            type_info1->msize != type_info2->msize || type_info1->ebias != type_info2->ebias ||
+            type_info1->norm != type_info2->norm)
+            ret_value = false;
+    }
+
     return ret_value;
 }
 
+static bool
+bypass_types_swapped(dtype_info_t *type_info1, dtype_info_t *type_info2)
+{
+    dtype_info_t same_order;
+
+    if (type_info1->class != H5T_INTEGER && type_info1->class != H5T_FLOAT)
+        return false;
+
+    if (type_info1->size != 2 && type_info1->size != 4 && type_info1->size != 8)
+        return false;
+
+    if (!((type_info1->order == H5T_ORDER_LE && type_info2->order == H5T_ORDER_BE) ||
+          (type_info1->order == H5T_ORDER_BE && type_info2->order == H5T_ORDER_LE)))
+        return false;
+
+    /* Everything else must be the same */
+    same_order       = *type_info2;
+    same_order.order = type_info1->order;
+
+    return bypass_types_equal(type_info1, &same_order);
+}
+
+/* Classify the file and memory types among the native integer and floating-point types.  The file
+ * type may also be in the opposite byte order, then the data is swapped before being converted. */
+static herr_t
+init_conv_types(void)
+{
+    hid_t native_types[CONV_NKINDS] = {H5T_NATIVE_INT8,  H5T_NATIVE_UINT8,  H5T_NATIVE_INT16, H5T_NATIVE_UINT16,
+                                       H5T_NATIVE_INT32, H5T_NATIVE_UINT32, H5T_NATIVE_INT64, H5T_NATIVE_UINT64,
+                                       H5T_NATIVE_FLOAT, H5T_NATIVE_DOUBLE};
+    int   i;
+
+    for (i = 0; i < CONV_NKINDS; i++) {
+        memset(&conv_native_info[i], 0, sizeof(dtype_info_t));
+
+        if (get_dtype_info_helper(native_types[i], &conv_native_info[i]) < 0) {
+            fprintf(stderr, "unable to get native datatype info\n");
+            return -1;
+        }
+    }
+
+    conv_native_ready = true;
+
+    return 0;
+} /* end init_conv_types() */
+
+static conv_func_t
+get_conv_func(dtype_info_t *file_type_info, dtype_info_t *mem_type_info, bool *swapped)
+{
+    dtype_info_t *native_info = conv_native_info;
+    int           file_kind = -1, mem_kind = -1;
+    int           i;
+
+    *swapped = false;
+
+    if (!conv_native_ready)
+        return NULL;
+
+    for (i = 0; i < CONV_NKINDS; i++) {
+        if (file_kind < 0 && bypass_types_equal(file_type_info, &native_info[i]))
+            file_kind = i;
+        else if (file_kind < 0 && bypass_types_swapped(file_type_info, &native_info[i])) {
+            file_kind = i;
+            *swapped  = true;
+        }
+
+        if (mem_kind < 0 && bypass_types_equal(mem_type_info, &native_info[i]))
+            mem_kind = i;
+    }
+
+    if (file_kind < 0 || mem_kind < 0) {
+        *swapped = false;
+        return NULL;
+    }
+
+    return conv_funcs[file_kind][mem_kind];
+}
+
 static H5D_space_status_t
 get_dset_space_status(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req) {
     H5D_space_status_t ret_value = H5D_SPACE_STATUS_ERROR;
@@ -5887,25 +12194,306 @@ done:
     return ret_value;
 }
 
-/* Flush the file containing the provided dataset */
+/* Fetch the dataspace of a dataset again, after a change of its extent.  The caller holds the lock. */
 static herr_t
-flush_containing_file(H5VL_bypass_t *dset) {
-    herr_t ret_value = 0;
-    H5VL_file_specific_args_t args;
+refresh_dset_space(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req)
+{
+    Bypass_dataset_t       *dset = &dset_obj->u.dataset;
+    H5VL_dataset_get_args_t get_args;
+    herr_t                  ret_value = 0;
+
+    dset->space_gen = atomic_load(&dset->object->gen);
+
+    if (dset->space_id != H5I_INVALID_HID && H5Sclose(dset->space_id) < 0) {
+        fprintf(stderr, "unable to close old dataspace\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    dset->space_id = H5I_INVALID_HID;
 
-    args.op_type = H5VL_FILE_FLUSH;
-    args.args.flush.obj_type = H5I_DATASET;
-    args.args.flush.scope = H5F_SCOPE_LOCAL;
+    /* Figure out the dataset's dataspace */
+    get_args.op_type                 = H5VL_DATASET_GET_SPACE;
+    get_args.args.get_space.space_id = H5I_INVALID_HID;
+
+    /* Retrieve the dataset's dataspace ID */
+    if (H5VLdataset_get(dset_obj->under_object, dset_obj->under_vol_id, &get_args, dxpl_id, req) < 0) {
+        fprintf(stderr, "unable to get opened dataset's dataspace\n");
+        ret_value = -1;
+        goto done;
+    }
 
-    if ((H5VLfile_specific((void*) dset->under_object, dset->under_vol_id, &args, H5P_DEFAULT, NULL) < 0)) {
-        fprintf(stderr, "unable to flush file\n");
+    if (get_args.args.get_space.space_id == H5I_INVALID_HID) {
+        fprintf(stderr, "retrieved invalid dataspace for dataset\n");
         ret_value = -1;
         goto done;
     }
 
+    dset->space_id = get_args.args.get_space.space_id;
+
 done:
     return ret_value;
-}
+} /* end refresh_dset_space() */
+
+/* Build a snapshot of what a read needs from the dataset's metadata: the extent, the datatype, the
+ * location of the contiguous data or of every chunk.  It's only usable when the dataset needs nothing
+ * else from the library, i.e. when the regular path would bypass it too and all of the storage is
+ * allocated.  The data of a compact dataset is kept in the object header, so the snapshot keeps a
+ * copy of it instead, read once by the library.  The caller holds the global lock of the library. */
+static herr_t
+refresh_dset_snapshot(H5VL_bypass_t *dset_obj, hid_t dxpl_id, void **req)
+{
+    Bypass_dataset_t       *dset = &dset_obj->u.dataset;
+    Bypass_dset_snapshot_t *snapshot = NULL;
+    H5VL_native_dataset_optional_args_t dset_opt_args;
+    H5VL_optional_args_t    opt_args;
+    hid_t        native_types[] = {H5T_NATIVE_SCHAR, H5T_NATIVE_UCHAR, H5T_NATIVE_SHORT, H5T_NATIVE_USHORT,
+                                   H5T_NATIVE_INT, H5T_NATIVE_UINT, H5T_NATIVE_LONG, H5T_NATIVE_ULONG,
+                                   H5T_NATIVE_LLONG, H5T_NATIVE_ULLONG, H5T_NATIVE_FLOAT, H5T_NATIVE_DOUBLE,
+                                   H5T_NATIVE_INT8, H5T_NATIVE_UINT8, H5T_NATIVE_INT16, H5T_NATIVE_UINT16,
+                                   H5T_NATIVE_INT32, H5T_NATIVE_UINT32, H5T_NATIVE_INT64, H5T_NATIVE_UINT64};
+    dtype_info_t mem_type_info;
+    hid_t        all_space_id = H5S_ALL;
+    hsize_t      nchunks = 1, c;
+    size_t       nbytes;
+    size_t       i;
+    int          d;
+    htri_t       ext_opened;
+    herr_t       ret_value = 0;
+
+    assert(dset_obj->type == H5I_DATASET);
+
+    if ((snapshot = (Bypass_dset_snapshot_t *)calloc(1, sizeof(Bypass_dset_snapshot_t))) == NULL) {
+        fprintf(stderr, "failed to allocate dataset snapshot\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    atomic_init(&snapshot->ref_count, 1);
+    snapshot->layout     = dset->layout;
+    snapshot->addr       = HADDR_UNDEF;
+    snapshot->dtype_info = dset->dtype_info;
+    snapshot->gen        = atomic_load(&dset->object->gen);
+
+    /* Another handle changed the extent of the dataset since this one retrieved it */
+    if (dset->space_gen != snapshot->gen && refresh_dset_space(dset_obj, dxpl_id, req) < 0) {
+        ret_value = -1;
+        goto done;
+    }
+
+    if (!dset->use_native_checked && should_dset_use_native(dset, true) < 0) {
+        fprintf(stderr, "failed to determine if native function should be used\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if ((snapshot->space_status = get_dset_space_status(dset_obj, dxpl_id, req)) < 0) {
+        fprintf(stderr, "failed to get dataset space status\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    /* Filtered chunks are decoded by the box engine of the slow path */
+    if (dset->use_native ||
+        (H5D_CONTIGUOUS != dset->layout && H5D_CHUNKED != dset->layout && H5D_COMPACT != dset->layout) ||
+        dset->num_filters > 0 || snapshot->space_status != H5D_SPACE_STATUS_ALLOCATED)
+        goto publish;
+
+    if ((snapshot->rank = H5Sget_simple_extent_ndims(dset->space_id)) < 0 ||
+        H5Sget_simple_extent_dims(dset->space_id, snapshot->dims, NULL) < 0) {
+        fprintf(stderr, "failed to get dataset dimensions\n");
+        ret_value = -1;
+        goto done;
+    }
+
+    if (snapshot->rank == 0)
+        goto publish;
+
+    /* Memory types are checked by their IDs during the read, so keep the predefined types which
+     * are the same as the dataset's type */
+    for (i = 0; i < sizeof(native_types) / sizeof(hid_t) && snapshot->nmem_types < SNAPSHOT_MEM_TYPES_MAX; i++) {
+        if (get_dtype_info_helper(native_types[i], &mem_type_info) < 0) {
+            fprintf(stderr, "failed to get mem dtype info\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        if (bypass_types_equal(&dset->dtype_info, &mem_type_info))
+            snapshot->mem_type_ids[snapshot->nmem_types++] = native_types[i];
+    }
+
+    if (snapshot->nmem_types == 0)
+        goto publish;
+
+    if (H5D_COMPACT == dset->layout) {
+        for (d = 0, nbytes = dset->dtype_info.size; d < snapshot->rank; d++)
+            nbytes *= (size_t)snapshot->dims[d];
+
+        if ((snapshot->compact_data = malloc(MAX(nbytes, 1))) == NULL) {
+            fprintf(stderr, "failed to allocate compact dataset copy\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        /* A predefined type with the dataset's representation reads the bytes as they are */
+        if (H5VLdataset_read(1, &dset_obj->under_object, dset_obj->under_vol_id, &snapshot->mem_type_ids[0],
+                             &all_space_id, &all_space_id, dxpl_id, &snapshot->compact_data, req) < 0) {
+            fprintf(stderr, "failed to read compact dataset\n");
+            ret_value = -1;
+            goto done;
+        }
+    } else if (H5D_CONTIGUOUS == dset->layout) {
+        if (get_dset_location(dset_obj, dxpl_id, req, &snapshot->addr) < 0) {
+            fprintf(stderr, "failed to get file location of contiguous dataset\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        /* The data of the dataset is spread over its external files instead */
+        if (dset->num_external > 0) {
+            if ((ext_opened = open_external_files(dset_obj, dxpl_id, req)) < 0) {
+                fprintf(stderr, "failed to open external files of dataset\n");
+                ret_value = -1;
+                goto done;
+            }
+
+            if (!ext_opened)
+                goto publish;
+
+            snapshot->addr         = 0;
+            snapshot->external     = dset->external;
+            snapshot->num_external = dset->num_external;
+        }
+
+        if (snapshot->addr == HADDR_UNDEF)
+            goto publish;
+    } else {
+        if (H5Pget_chunk(dset->dcpl_id, snapshot->rank, snapshot->chunk_dims) < 0) {
+            fprintf(stderr, "failed to get chunk dimensions from DCPL\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        for (d = 0; d < snapshot->rank; d++) {
+            snapshot->grid_dims[d] = (snapshot->dims[d] + snapshot->chunk_dims[d] - 1) / snapshot->chunk_dims[d];
+            nchunks *= snapshot->grid_dims[d];
+
+            /* Too many chunks to keep a map of */
+            if (nchunks == 0 || nchunks > SNAPSHOT_CHUNKS_MAX)
+                goto publish;
+        }
+
+        if ((snapshot->chunk_addrs = (haddr_t *)malloc(nchunks * sizeof(haddr_t))) == NULL) {
+            fprintf(stderr, "failed to allocate chunk map\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        for (c = 0; c < nchunks; c++)
+            snapshot->chunk_addrs[c] = HADDR_UNDEF;
+
+        dset_opt_args.chunk_iter.op      = snapshot_chunk_cb;
+        dset_opt_args.chunk_iter.op_data = (void *)snapshot;
+
+        opt_args.args    = (void *)&dset_opt_args;
+        opt_args.op_type = H5VL_NATIVE_DATASET_CHUNK_ITER;
+
+        if (H5VLdataset_optional(dset_obj->under_object, dset_obj->under_vol_id, &opt_args, dxpl_id, req) < 0) {
+            fprintf(stderr, "failed to iterate over chunks for snapshot\n");
+            ret_value = -1;
+            goto done;
+        }
+
+        for (c = 0; c < nchunks; c++)
+            if (snapshot->chunk_addrs[c] == HADDR_UNDEF)
+                goto publish;
+    }
+
+    snapshot->usable = true;
+
+publish:
+    publish_dset_snapshot(dset, snapshot);
+    snapshot = NULL;
+
+done:
+    if (ret_value < 0) {
+        /* Don't leave an outdated snapshot behind */
+        publish_dset_snapshot(dset, NULL);
+
+        if (snapshot)
+            release_dset_snapshot(snapshot);
+    }
+
+    return ret_value;
+} /* end refresh_dset_snapshot() */
+
+static void
+publish_dset_snapshot(Bypass_dataset_t *dset, Bypass_dset_snapshot_t *snapshot)
+{
+    Bypass_dset_snapshot_t *old = NULL;
+
+    pthread_mutex_lock(&dset->snapshot_mutex);
+    old = dset->snapshot;
+    dset->snapshot = snapshot;
+    pthread_mutex_unlock(&dset->snapshot_mutex);
+
+    /* Reads still using the old snapshot keep it alive until they finish */
+    if (old)
+        release_dset_snapshot(old);
+} /* end publish_dset_snapshot() */
+
+/* A snapshot taken before a change of the dataset through another handle is left to the next read
+ * holding the global lock to replace */
+static Bypass_dset_snapshot_t *
+grab_dset_snapshot(Bypass_dataset_t *dset)
+{
+    Bypass_dset_snapshot_t *ret_value = NULL;
+
+    pthread_mutex_lock(&dset->snapshot_mutex);
+
+    if ((ret_value = dset->snapshot) != NULL) {
+        if (ret_value->gen != atomic_load(&dset->object->gen))
+            ret_value = NULL;
+        else
+            atomic_fetch_add(&ret_value->ref_count, 1);
+    }
+
+    pthread_mutex_unlock(&dset->snapshot_mutex);
+
+    return ret_value;
+} /* end grab_dset_snapshot() */
+
+static void
+release_dset_snapshot(Bypass_dset_snapshot_t *snapshot)
+{
+    if (atomic_fetch_sub(&snapshot->ref_count, 1) > 1)
+        return;
+
+    free(snapshot->chunk_addrs);
+    free(snapshot->compact_data);
+    free(snapshot);
+} /* end release_dset_snapshot() */
+
+static int
+snapshot_chunk_cb(const hsize_t *chunk_offsets, unsigned filter_mask, haddr_t chunk_addr, hsize_t chunk_size,
+                  void *op_data)
+{
+    Bypass_dset_snapshot_t *snapshot = (Bypass_dset_snapshot_t *)op_data;
+    hsize_t grid_idx = 0;
+    int     d;
+
+    for (d = 0; d < snapshot->rank; d++) {
+        /* Ignore chunks left beyond the extent */
+        if (chunk_offsets[d] / snapshot->chunk_dims[d] >= snapshot->grid_dims[d])
+            return H5_ITER_CONT;
+
+        grid_idx = grid_idx * snapshot->grid_dims[d] + chunk_offsets[d] / snapshot->chunk_dims[d];
+    }
+
+    snapshot->chunk_addrs[grid_idx] = chunk_addr;
+
+    return H5_ITER_CONT;
+} /* end snapshot_chunk_cb() */
 
 static herr_t
 bypass_queue_destroy(task_queue_t *queue, bool need_mutex) {
@@ -6062,6 +12650,33 @@ bypass_task_create(sel_info_t *sel_info, haddr_t addr, size_t size, void *buf) {
     ret_value->task_count_ptr = sel_info->task_count_ptr;
     ret_value->local_condition_ptr = sel_info->local_condition_ptr;
     ret_value->read_data = sel_info->read_data;
+    ret_value->xlate = NULL;
+    ret_value->first_chunk = 0;
+    ret_value->nchunks = 0;
+    ret_value->swap_size = sel_info->swap_size;
+    ret_value->conv_func = NULL;
+    ret_value->conv_buf = NULL;
+    ret_value->conv_nelmts = 0;
+    ret_value->fill_size = 0;
+    ret_value->ext_fd = -1;
+    ret_value->wb_size = 0;
+    ret_value->stage = STAGE_IO;
+    ret_value->stage_buf = NULL;
+    ret_value->stage_buf_size = 0;
+    ret_value->task_error_ptr = sel_info->task_error_ptr;
+    ret_value->iov = NULL;
+    ret_value->iovcnt = 0;
+    ret_value->iov_cap = 0;
+
+    /* The offsets in memory were computed with the size of the file datatype.  Find where the
+     * converted elements go in the buffer of the application. */
+    if (sel_info->conv_func && buf) {
+        size_t first = (size_t)((char *)buf - (char *)sel_info->mem_buf) / sel_info->dtype_size;
+
+        ret_value->conv_func = sel_info->conv_func;
+        ret_value->conv_buf = (char *)sel_info->mem_buf + first * sel_info->mem_dtype_size;
+        ret_value->conv_nelmts = size / sel_info->dtype_size;
+    }
 
     /* Will be populated after this task is inserted into queue */
     ret_value->next = NULL;
@@ -6074,6 +12689,17 @@ static herr_t
 bypass_task_release(Bypass_task_t *task) {
     herr_t ret_value = 0;
 
+    /* Tasks decoding a chunk hold on to the chunk list until they're done */
+    if (task->xlate)
+        release_chunk_xlate(task->xlate);
+
+    if (task->wb_size > 0) {
+        free(task->vec_buf);
+        release_write_behind_space(task->wb_size);
+    }
+
+    free(task->stage_buf);
+    free(task->iov);
     free(task);
 
     return ret_value;
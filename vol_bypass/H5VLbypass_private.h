@@ -20,6 +20,8 @@
 #include "H5VLbypass.h"        /* Public header for connector */
 #include <pthread.h>
 #include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 /* Private characteristics of the bypass VOL connector */
 #define H5VL_BYPASS_VERSION     0
@@ -34,24 +36,114 @@
 #define LOCAL_VECTOR_LEN   1024
 #define NUM_LOCAL_THREADS  4
 #define THREAD_STEP        1024
+#define XLATE_MIN_CHUNKS   256
+#define GLOBAL_LOCK_SPINS       64         /* Tries of the library lock before backing off */
+#define GLOBAL_LOCK_BACKOFFS    8          /* Sleeps between tries, doubling from 1 microsecond, before blocking */
+#define GLOBAL_LOCK_WAIT_USEC   1000       /* Longest block before trying the library lock again */
+#define SNAPSHOT_CHUNKS_MAX     (1 << 22)
+#define SNAPSHOT_MEM_TYPES_MAX  24
+#define FILTER_CD_VALUES_MAX    16         /* Client data values kept for each filter of a dataset */
+#define FILTER_PLUGINS_MAX      64         /* Filter plugins looked up, found or not */
+#define FILTER_ALLOWLIST_MAX    64
+#define FLETCHER32_SIZE         4          /* Bytes of the checksum at the end of a chunk */
+#define FILL_VALUE_MAX          16         /* Bytes of the largest fill value, in the memory datatype */
+#define THREAD_BUF_STAGING      0          /* Thread buffer for data read before being converted */
+#define THREAD_BUF_CHUNK        1          /* Thread buffers for a filtered chunk being decoded */
+#define THREAD_BUF_DECODE       2
+#define THREAD_BUF_COUNT        3
+#define THREAD_BUF_SPARES       16         /* Staging buffers of each kind kept for the stage they came from */
+#define WRITE_AGG_ALIGN         4096       /* Boundary the aggregated writes end on while more data follows */
+#define WRITE_AGG_MS            100        /* Longest time data waits in the aggregation buffer of a file, by default */
+#define DURABILITY_NONE         0          /* The data written is left to the page cache of the system */
+#define DURABILITY_CLOSE        1          /* Files are synced when flushed or closed */
+#define DURABILITY_GROUP        2          /* Each H5Dwrite through the Bypass VOL is synced too, sharing the syncs of a file */
+#define DURABILITY_WINDOW_MS    1          /* Time a sync waits for more writers to join it, by default */
+#define FUSED_IO_MAX            (16 * MB)  /* Largest piece of I/O put together from the tasks of a fused request */
+#define FUSED_IOV_MAX           1024       /* Most pieces of memory in the I/O put together */
+#define STAGE_IO                0          /* Pipeline stage reading or writing the file */
+#define STAGE_DECODE            1          /* Pipeline stage undoing filters, swapping bytes and converting data read */
+#define STAGE_SCATTER           2          /* Pipeline stage copying the selection of a decoded chunk to the application */
+#define NSTAGES                 3
 #define NTHREADS_MIN       1
 #define NTHREADS_MAX       32
 #define BYPASS_NAME_SIZE_LONG   1024
 #define MIN(a, b)          (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)          (((a) > (b)) ? (a) : (b))
 #define GB (1024 * 1024 * 1024)
 #define MB (1024 * 1024)
 
 pthread_mutex_t mutex_local;
 pthread_cond_t  cond_local;
+pthread_cond_t  cond_decode;
+pthread_cond_t  cond_scatter;
 
 int  nthreads_tpool       = NUM_LOCAL_THREADS;
 int  nsteps_tpool         = THREAD_STEP;
 int64_t  nelmts_max       = MB;
 bool no_tpool             = false;                 /* use the thread pool unless the application set the environment variable "BYPASS_VOL_NO_TPOOL" */
 int  info_pointer         = 0;
+int  xlate_min_chunks     = XLATE_MIN_CHUNKS;      /* minimal number of chunks for each thread in the pool translating chunk selections.  0 translates them in the calling thread */
+int  pipeline_chunks      = 0;                     /* number of chunks looked up at a time in the pipelined mode, set by "BYPASS_VOL_PIPELINE_CHUNKS".  0 disables the mode */
+int  simd_level           = 0;                     /* SIMD instructions for swapping bytes: 0 for none, 1 for SSSE3 or NEON, 2 for AVX2.  Detected at initialization unless "BYPASS_VOL_NO_SIMD" is set */
+
+/* Buffers of each thread for the data it stages, kept between tasks: the data to be converted, and
+ * the data of a filtered chunk as it's read and decoded */
+_Thread_local void  *thread_bufs[THREAD_BUF_COUNT];
+_Thread_local size_t thread_buf_sizes[THREAD_BUF_COUNT];
+
+/* Staging buffers a thread had before it was handed the buffer of a task from the stage before, which
+ * the threads of that stage take back instead of allocating new ones */
+void           *spare_bufs[THREAD_BUF_COUNT][THREAD_BUF_SPARES];
+size_t          spare_buf_sizes[THREAD_BUF_COUNT][THREAD_BUF_SPARES];
+int             nspare_bufs[THREAD_BUF_COUNT];
+pthread_mutex_t spare_bufs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Write-behind ("BYPASS_VOL_WRITE_BEHIND"): H5Dwrite returns once the data is copied into staging
+ * buffers taking at most write_behind_max bytes in all, and the thread pool writes them out in the
+ * background.  Flushing or closing a dataset or file waits for the writes still pending. */
+size_t          write_behind_max    = 0;            /* 0 disables write-behind */
+size_t          write_behind_used   = 0;            /* Bytes of staging buffers in use, protected by mutex_local */
+pthread_cond_t  write_behind_space_cond = PTHREAD_COND_INITIALIZER;  /* Signaled when staging buffers are freed */
+
+/* Write aggregation ("BYPASS_VOL_WRITE_AGG"): small writes are copied into a buffer of their file
+ * while they follow each other, and written out together once the buffer fills up, the data gets
+ * older than write_agg_ms, or a read, flush or close needs it in the file */
+size_t          write_agg_size      = 0;            /* Bytes of the buffer of each file, 0 disables aggregation */
+long            write_agg_ms        = WRITE_AGG_MS; /* "BYPASS_VOL_WRITE_AGG_MS", 0 for no time limit */
+
+/* Durability ("BYPASS_VOL_DURABILITY"): files written through the Bypass VOL are synced with
+ * fdatasync when flushed or closed, and with group commit after each H5Dwrite as well.  The writers
+ * waiting for the same file share one sync, started by the first of them once the window is over. */
+int             durability          = DURABILITY_NONE;
+long            durability_window_ms = DURABILITY_WINDOW_MS; /* "BYPASS_VOL_DURABILITY_MS", 0 for no wait */
+size_t          prealloc_min        = 0;            /* "BYPASS_VOL_FALLOCATE": storage of contiguous datasets this big is preallocated, 0 never */
+
+/* Prefetching ("BYPASS_VOL_PREFETCH"): reads of a dataset moving through it by the same step are
+ * followed by a hint to the system to read the next selection ahead, while the application works on
+ * the current one */
+size_t          prefetch_max        = 0;            /* Most bytes prefetched for a selection, 0 disables prefetching */
 
 bool stop_tpool           = false;                   /* Flag to tell the thread pool to terminate, turned on in H5VL_bypass_term */
-pthread_t th[NTHREADS_MAX];
+pthread_t th[NTHREADS_MAX * NSTAGES];
+
+/* Threads blocked for the global lock of the HDF5 library wait on this condition variable, signaled
+ * each time a thread of this connector lets the lock go */
+pthread_mutex_t global_lock_mutex;
+pthread_cond_t  global_lock_cond;
+unsigned long   global_lock_releases = 0;           /* Number of signaled releases, protected by global_lock_mutex */
+atomic_int      global_lock_waiters  = 0;           /* Number of threads blocked for the lock */
+bool            lock_stats           = false;       /* Collect the wait time for the lock if "BYPASS_VOL_LOCK_STATS" is set */
+
+/* Statistics of taking the global lock, reported when the connector terminates */
+typedef struct lock_stats_t {
+    atomic_ullong acquires;     /* Number of times the lock was taken */
+    atomic_ullong contended;    /* Number of times the first try failed */
+    atomic_ullong blocked;      /* Number of times the thread had to block */
+    atomic_ullong wait_ns;      /* Total time spent waiting, in nanoseconds */
+    atomic_ullong max_wait_ns;  /* Longest wait */
+} lock_stats_t;
+
+lock_stats_t global_lock_stats;
 
 /* Log info to be written out for the C program */
 typedef struct {
@@ -68,6 +160,7 @@ typedef struct {
 typedef struct {
     int      thread_id;
     int      fd;
+    int      stage;                      /* Pipeline stage whose queue the thread takes tasks from */
 } info_for_thread_t;
 
 typedef struct dtype_info_t {
@@ -75,11 +168,61 @@ typedef struct dtype_info_t {
     size_t size;
     H5T_sign_t sign; /* Signed vs. unsigned */
     H5T_order_t order; /* Bit order */
+    size_t precision; /* Number of significant bits */
+    int offset; /* Bit offset of the first significant bit */
+    H5T_pad_t lsb_pad, msb_pad; /* Padding of the unused bits */
+    /* Floating-point layout, only set for the H5T_FLOAT class */
+    size_t spos, epos, esize, mpos, msize; /* Sign, exponent and mantissa bit fields */
+    size_t ebias; /* Exponent bias */
+    H5T_norm_t norm; /* Mantissa normalization */
 } dtype_info_t;
 
+/* Bytes of a file the library may still hold in its caches after writing a dataset (the sieve buffer
+ * of a contiguous dataset, the chunk cache of a chunked one), so reads through the Bypass VOL must
+ * flush the dataset first */
+typedef struct dirty_range_t {
+    struct H5VL_bypass_t *dset;    /* Handle of the dataset whose flush writes the bytes out */
+    haddr_t               start;   /* HADDR_UNDEF if the bytes aren't known: only reads of the dataset flush it */
+    haddr_t               end;
+} dirty_range_t;
+
+/* A dataset as found in its file, shared by all the handles opened for it, whichever H5Fopen they
+ * came through */
+typedef struct Bypass_object_t {
+    H5O_token_t  token;                  /* Location of the object header in the file */
+    int          ref_count;              /* Dataset handles of the object, protected by shared_files_mutex */
+    atomic_uint  gen;                    /* Bumped when the dataset changes in a way its other handles can't see */
+    bool         wb_pending;             /* Writes done behind may be pending within the bounds below, protected by the global lock */
+    hsize_t      wb_start[H5S_MAX_RANK];
+    hsize_t      wb_end[H5S_MAX_RANK];
+    atomic_int   wb_tasks;               /* Tasks writing behind not done yet */
+    atomic_int   wb_errors;              /* Tasks writing behind failed since the last barrier */
+    pthread_cond_t wb_cond;              /* Signaled when the last pending task is done */
+    struct Bypass_object_t *next;
+} Bypass_object_t;
+
+/* What the handles of the same file have in common, found by the device and inode of the file */
+typedef struct Bypass_shared_file_t {
+    dev_t        dev;
+    ino_t        ino;
+    int          ref_count;              /* File handles of the file, protected by shared_files_mutex */
+    atomic_int   nagg;                   /* File handles with a write aggregation buffer */
+    Bypass_object_t *objects;            /* Datasets opened in the file */
+    pthread_mutex_t dirty_mutex;         /* Protects the dirty ranges */
+    dirty_range_t  *dirty;               /* One range for each dataset written by the library and not flushed since */
+    atomic_int      ndirty;              /* Checked without the mutex by reads, which mostly find none */
+    int             dirty_cap;
+    struct Bypass_shared_file_t *next;
+} Bypass_shared_file_t;
+
+/* Files opened through the Bypass VOL, each one once however many times it was opened */
+Bypass_shared_file_t *shared_files = NULL;
+pthread_mutex_t shared_files_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 typedef struct Bypass_file_t {
     char name[BYPASS_NAME_SIZE_LONG];
     int  fd;                /* C file descriptor  */
+    Bypass_shared_file_t *shared; /* Shared with the other handles of the same file */
     bool flags_set;         /* Whether the flag has been set */
     int  flags;             /* Saved flag for file open */
     /* void *vfd_file_handle;  Currently not used */
@@ -87,8 +230,25 @@ typedef struct Bypass_file_t {
     int  num_reads;         /* Number of reads still left undone */
     bool read_started;      /* Flag to indicate reads have started */
     pthread_cond_t close_ready;    /* Condition variable to indicate all reads are finished and the file can be close */
+    pthread_mutex_t agg_mutex;     /* Protects the write aggregation buffer */
+    void           *agg_buf;       /* Data of small writes not written yet, NULL without aggregation */
+    haddr_t         agg_addr;      /* Where the buffered data starts in the file */
+    size_t          agg_len;       /* Bytes buffered, 0 if none */
+    struct timespec agg_time;      /* When the oldest data buffered came in */
+    struct Bypass_file_t *agg_next; /* Next file with an aggregation buffer */
+    pthread_mutex_t sync_mutex;    /* Protects the counts of syncs below */
+    pthread_cond_t  sync_cond;     /* Signaled when a sync is done */
+    unsigned long   sync_requested; /* Syncs asked for by writers, each one waiting for a number */
+    unsigned long   sync_done;     /* All the syncs up to this number are done */
+    bool            syncing;       /* A writer is syncing the file for the others */
+    bool            sync_failed;   /* The file may have lost data, so no sync succeeds afterwards */
 } Bypass_file_t;
 
+/* Files with a write aggregation buffer, for reads to flush the buffers of the handles of the same file
+ * or of all of them */
+Bypass_file_t  *write_agg_files = NULL;
+pthread_mutex_t write_agg_files_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* Forward declaration of the bypass VOL connector's object */
 struct H5VL_bypass_t;
 
@@ -97,15 +257,92 @@ typedef struct Bypass_group_t {
     struct H5VL_bypass_t *file; /* File containing the group */
 } Bypass_group_t;
 
+/* A segment of the external files holding the raw data of a contiguous dataset (H5Pset_external).
+ * The segments follow each other in the dataset, each one at some offset of its own file. */
+typedef struct external_seg_t {
+    int     fd;                          /* Opened for reading by the first read through the Bypass VOL */
+    off_t   offset;                      /* Where the segment starts in its file */
+    hsize_t start;                       /* Where the segment starts in the dataset, in bytes */
+    hsize_t size;                        /* H5F_UNLIMITED for a last segment without limit */
+} external_seg_t;
+
+/* A mapping of a virtual dataset, whose source dataset is read through the Bypass VOL */
+typedef struct vds_source_t {
+    hid_t                 vspace_id;     /* Selection of the mapping in the virtual dataset */
+    hid_t                 src_space_id;  /* Selection of the mapping in the source dataset, with its extent */
+    struct H5VL_bypass_t *file;          /* File opened for the source, or NULL if another source opened it first
+                                          * or the source is in the virtual dataset's file */
+    struct H5VL_bypass_t *dset;          /* Source dataset */
+} vds_source_t;
+
+/* Copy of the dataset's metadata needed to map a read to the file, so that reads can be done without
+ * the global lock of the HDF5 library.  A snapshot never changes once published.  When the metadata
+ * changes, a new one replaces it and the old one is freed after the last read using it lets it go. */
+typedef struct Bypass_dset_snapshot_t {
+    atomic_int   ref_count;
+    bool         usable;                  /* Reads can be done with this snapshot */
+    H5D_layout_t layout;
+    int          rank;
+    hsize_t      dims[DIM_RANK_MAX];
+    hsize_t      chunk_dims[DIM_RANK_MAX];
+    hsize_t      grid_dims[DIM_RANK_MAX]; /* Number of chunks in each dimension */
+    haddr_t      addr;                    /* Location of a contiguous dataset */
+    haddr_t     *chunk_addrs;             /* Location of each chunk in the order of the chunk grid */
+    void        *compact_data;            /* Raw data of a compact dataset, read by the library when the snapshot was taken */
+    const external_seg_t *external;       /* External files of a contiguous dataset, owned by the dataset */
+    int          num_external;
+    dtype_info_t dtype_info;
+    H5D_space_status_t space_status;      /* Storage allocation when the snapshot was taken */
+    unsigned     gen;                     /* Generation of the dataset when the snapshot was taken */
+    hid_t        mem_type_ids[SNAPSHOT_MEM_TYPES_MAX]; /* Predefined memory types needing no conversion */
+    int          nmem_types;
+} Bypass_dset_snapshot_t;
+
+/* A filter plugin on the allowlist found in the plugin path of the HDF5 library, whose 'filter'
+ * callback the thread pool calls itself */
+typedef struct filter_plugin_t {
+    H5Z_filter_t        id;
+    const H5Z_class2_t *cls;             /* NULL if no plugin has the filter */
+    void               *handle;          /* From dlopen(), closed when the connector terminates */
+} filter_plugin_t;
+
+/* A filter of a dataset's pipeline, as set in its creation property list */
+typedef struct filter_info_t {
+    H5Z_filter_t id;
+    unsigned     flags;
+    size_t       cd_nelmts;
+    unsigned     cd_values[FILTER_CD_VALUES_MAX];
+    filter_plugin_t *plugin;             /* Plugin of a filter other than the ones built into the connector */
+} filter_info_t;
+
 typedef struct Bypass_dataset_t {
     hid_t dcpl_id;
     hid_t space_id;
     H5D_layout_t layout;
     int num_filters;
+    filter_info_t filters[H5Z_MAX_NFILTERS]; /* The filter pipeline, in the order the filters are applied when writing */
+    H5D_fill_time_t fill_time;   /* With H5D_FILL_TIME_NEVER, storage never written is left undefined */
+    H5D_fill_value_t fill_status; /* Whether the fill value is undefined, the default (zeros) or the application's */
+    int num_external;            /* Number of external files holding the raw data */
+    external_seg_t *external;    /* NULL until the external files are opened */
+    bool vds_resolved;           /* The mappings of a virtual dataset have been looked at by a read */
+    int num_vds_sources;         /* 0 if the virtual dataset is read by the library */
+    vds_source_t *vds_sources;
+    bool preallocated;           /* The storage was preallocated in the file, or didn't need to be */
+    pthread_mutex_t pattern_mutex;     /* Protects the access pattern below, updated by each read */
+    int pattern_rank;                  /* 0 until a read was seen */
+    hsize_t pattern_start[H5S_MAX_RANK];   /* Bounds of the file selection of the last read */
+    hsize_t pattern_end[H5S_MAX_RANK];
+    hssize_t pattern_delta[H5S_MAX_RANK];  /* Move of the selection between the last two reads */
+    int pattern_hits;                  /* Reads in a row which moved by the same delta */
     dtype_info_t dtype_info;
     bool use_native;             /* Indicating if using the native library for IO */
     bool use_native_checked;     /* Indicating if using the native library has been decided */
     struct H5VL_bypass_t *file;  /* Use the forward-declared type */
+    Bypass_object_t *object;           /* The dataset in the file, shared with its other handles */
+    Bypass_dset_snapshot_t *snapshot;  /* Current metadata snapshot for reads not holding the library lock */
+    unsigned space_gen;                /* Generation of the dataset when space_id was retrieved */
+    pthread_mutex_t snapshot_mutex;    /* Protects swapping the snapshot and taking a reference to it */
 } Bypass_dataset_t;
 
 /* The bypass VOL connector's object */
@@ -121,9 +358,15 @@ typedef struct H5VL_bypass_t {
     } u;
 } H5VL_bypass_t;
 
+/* Converts numbers from the datatype in the file to the one in memory (defined in H5VLbypass.c) */
+typedef void (*conv_func_t)(const void *src, void *dst, size_t nelmts);
+
 /* Forward declaration of Bypass_task_t and the task queue for the thread pool */
 typedef struct Bypass_task_t Bypass_task_t;
 
+/* Chunk list shared by the tasks translating chunk selections in the thread pool (defined in H5VLbypass.c) */
+struct chunk_xlate_t;
+
 typedef struct Bypass_task_t {
     H5VL_bypass_t *file;
     haddr_t        addr;                 /* Location of filesystem file to read from or write to*/
@@ -133,6 +376,26 @@ typedef struct Bypass_task_t {
     atomic_int    *task_count_ptr;       /* These two fields are used for multi-threaded application (not using the thread pool).
                                           * This pointer keeps track of the number of tasks in the queue for the current thread */
     pthread_cond_t *local_condition_ptr; /* This pointer passes the local condition variable for the current thread to the thread pool */
+    struct chunk_xlate_t *xlate;         /* If set, the task translates the chunks [first_chunk, first_chunk + nchunks)
+                                          * of this list into I/O and does the I/O instead of reading or writing 'addr' */
+    size_t         first_chunk;
+    size_t         nchunks;
+    size_t         swap_size;            /* Element size if the byte order of the data read is reversed, otherwise 0 */
+    conv_func_t    conv_func;            /* If set, the data is read into a staging buffer and converted into 'conv_buf' */
+    void          *conv_buf;
+    size_t         conv_nelmts;
+    size_t         fill_size;            /* If not 0, the task sets 'vec_buf' to 'fill_value' instead of doing I/O */
+    unsigned char  fill_value[FILL_VALUE_MAX];
+    int            ext_fd;               /* If not -1, the external file holding 'addr' instead of the HDF5 file */
+    size_t         wb_size;              /* If not 0, 'vec_buf' is a copy of the data written behind, owned by the task */
+    int            stage;                /* Pipeline stage the task is waiting for or going through */
+    void          *stage_buf;            /* Data handed from one stage to the next, with the size of its allocation */
+    size_t         stage_buf_size;
+    atomic_int    *task_error_ptr;       /* Counts the failed tasks of the request */
+    struct iovec  *iov;                  /* If set, the pieces of memory of the tasks put together into this one,
+                                          * doing the I/O of 'size' bytes from 'addr' instead of 'vec_buf' */
+    int            iovcnt;
+    int            iov_cap;
     Bypass_task_t *next;
 } Bypass_task_t;
 
@@ -140,6 +403,8 @@ typedef struct task_queue_t {
     Bypass_task_t *bypass_queue_head_g;
     Bypass_task_t *bypass_queue_tail_g;
     int            tasks_in_queue;      /* Used only by the queue local to each thread when the thread pool isn't used */
+    bool           fused;               /* The queue gathers the tasks of a request on many datasets, handed to the
+                                         * thread pool all at once in the order of the file */
 } task_queue_t;
 
 /* The task queue for the thread pool.  If the application chooses not to use the thread pool (running multi-threaded),
@@ -147,6 +412,26 @@ typedef struct task_queue_t {
  */
 task_queue_t queue_for_tpool;
 
+/* The thread pool is a pipeline: queue_for_tpool feeds the threads doing the I/O, which hand the data
+ * read to the decoding threads, which hand decoded chunks to the scattering threads.  A stage without
+ * threads of its own ("BYPASS_VOL_NTHREADS_DECODE", "BYPASS_VOL_NTHREADS_SCATTER") is run by the
+ * thread finishing the stage before it. */
+task_queue_t queue_for_decode;
+task_queue_t queue_for_scatter;
+
+task_queue_t   *stage_queues[NSTAGES] = {&queue_for_tpool, &queue_for_decode, &queue_for_scatter};
+pthread_cond_t *stage_conds[NSTAGES]  = {&cond_local, &cond_decode, &cond_scatter};
+int             nthreads_stage[NSTAGES];
+
+/* Filter plugins looked up so far, never removed until the connector terminates, and the filters
+ * whose plugins the application declared safe to call from many threads at once without the library
+ * lock with "BYPASS_VOL_FILTER_ALLOWLIST" */
+filter_plugin_t filter_plugins[FILTER_PLUGINS_MAX];
+int             nfilter_plugins = 0;
+pthread_mutex_t filter_plugins_mutex = PTHREAD_MUTEX_INITIALIZER;
+H5Z_filter_t    filter_allowlist[FILTER_ALLOWLIST_MAX];
+int             nfilter_allowlist = 0;
+
 typedef struct {
     size_t  counter;
 
@@ -164,6 +449,18 @@ typedef struct {
                                           * This pointer keeps track of the number of tasks in the queue for the current thread */
     pthread_cond_t *local_condition_ptr; /* This pointer passes the local condition variable for the current thread to the thread pool */
     bool    read_data;                   /* reading or writing data */
+    size_t  swap_size;                   /* Element size if the file and memory types differ only in byte order, otherwise 0 */
+    conv_func_t conv_func;               /* Converts the numbers read from the file's datatype to the memory's, or NULL */
+    size_t  mem_dtype_size;              /* Size of the memory datatype when the data is converted */
+    void   *mem_buf;                     /* Buffer of the application receiving the converted data */
+    bool    skip_edc;                    /* Fletcher32 checksums of chunks aren't verified (H5Pset_edc_check) */
+    atomic_int *task_error_ptr;          /* Counts the failed tasks of the request */
+    size_t  fill_size;                   /* Size of the fill value in memory if the storage not allocated is read as it, otherwise 0 */
+    unsigned char fill_value[FILL_VALUE_MAX];
+    const external_seg_t *external;      /* If set, the file offsets are in the external files of the dataset and 'chunk_addr' is 0 */
+    int     num_external;
+    bool    write_behind;                /* The data written is copied for the tasks, which are counted by the write-behind globals */
+    bool    alloc_chunks;                /* The chunks of a write's selection not allocated yet are created first */
 } sel_info_t;
 
 static info_t *info_stuff;
@@ -7,7 +7,7 @@
 void
 usage(void)
 {
-    printf("    [-h] [-c --dimsChunk] [-d --dimsDset] [-e --enableChunkCache] [-f --nFiles] [-k --checkData] [-m -stepSize] [-n --nDsets] [-q --nSections] [-r --randomData] [-s --spaceSelect] [-t --nThreads]\n");
+    printf("    [-h] [-c --dimsChunk] [-d --dimsDset] [-e --enableChunkCache] [-f --nFiles] [-k --checkData] [-m -stepSize] [-n --nDsets] [-o --layout] [-p --sparse] [-q --nSections] [-r --randomData] [-s --spaceSelect] [-t --nThreads] [-y --dataType] [-z --filters]\n");
     printf("    [-h --help]: this help page\n");
     printf("    [-c --dimsChunk]: the 2D dimensions of the chunks.  The default is no chunking.\n");
     printf("    [-d --dimsDset]: the 2D dimensions of the datasets.  The default is 1024 x 1024.\n");
@@ -17,14 +17,35 @@ usage(void)
     printf("    [-l --multiDsets]: read multiple datasets using H5Dread_multi. The default is false.\n");
     printf("    [-m --stepSize]: the number of data pieces passed into the thread pool.  The default is 1.\n");
     printf("    [-n --nDsets]: number of datasets in a single file.  The default is 1.\n");
+    printf("    [-o --layout]: storage layout of the datasets when they are created: compact, external (two external files) or virtual (two source datasets).  Can't be used with -c.  The default is contiguous, or chunked with -c.\n");
+    printf("    [-p --sparse]: only the first half of the rows is written when the datasets are created, the other rows keep the fill value (%d).  The default is false.\n", SPARSE_FILL_VALUE);
     printf("    [-q --nSections]: number of data sections to break down a large dataset.  The default is 1.\n");
     printf("    [-r --randomData]: the data has random values. The default is false.\n");
     printf("    [-s --spaceSelect]: hyperslab selection of data space.  The default is the rows divided by the number of threads - value 1\n");
     printf("            The other options are unsurppoted\n");
     printf("    [-t --nThreads]: number of child threads in addition to the main process.  The default is 1.\n");
+    printf("    [-y --dataType]: datatype of the data: int, int8, uint8, int16, uint16, uint32, int64, uint64, float or double, with the suffix be (e.g. int16be) to store it big-endian in the file.  A different datatype in memory follows a colon (e.g. int16:float).  The default is int.\n");
+    printf("    [-z --filters]: comma-separated list of the filters of the chunks when the datasets are created: deflate, shuffle or fletcher32.  Needs -c.  The default is no filter.\n");
     printf("\n");
 }
 
+/*------------------------------------------------------------
+ * Find a datatype of the data by its name in --dataType
+ *------------------------------------------------------------
+ */
+static data_type_t
+find_data_type(const char *name, const char **dtype_names, int ntypes)
+{
+    int i;
+
+    for (i = 0; i < ntypes; i++)
+        if (!strcmp(name, dtype_names[i]))
+            return (data_type_t)i;
+
+    printf("Error: unknown datatype %s\n", name);
+    exit(1);
+}
+
 /*------------------------------------------------------------
  * Parse command line option
  *------------------------------------------------------------
@@ -32,7 +53,11 @@ usage(void)
 void
 parse_command_line(int argc, char *argv[])
 {
+    const char   *dtype_names[] = {"int", "int8", "uint8", "int16", "uint16", "uint32", "int64", "uint64", "float", "double"};
+    const size_t  dtype_sizes[] = {sizeof(int), 1, 1, 2, 2, 4, 8, 8, sizeof(float), sizeof(double)};
+    const char   *layout_names[] = {"default", "compact", "external", "virtual"};
     int           opt;
+    int           i;
     struct option long_options[] = {
                                     {"dimsChunk=", required_argument, NULL, 'c'},
                                     {"dimsDset=", required_argument, NULL, 'd'},
@@ -47,6 +72,10 @@ parse_command_line(int argc, char *argv[])
                                     {"spaceSelect=", required_argument, NULL, 's'},
                                     {"nThreads=", required_argument, NULL, 't'},
                                     {"multiDsets", no_argument, NULL, 'l'},
+                                    {"dataType=", required_argument, NULL, 'y'},
+                                    {"layout=", required_argument, NULL, 'o'},
+                                    {"sparse", no_argument, NULL, 'p'},
+                                    {"filters=", required_argument, NULL, 'z'},
                                     {NULL, 0, NULL, 0}};
 
     /* Initialize the command line options */
@@ -66,8 +95,16 @@ parse_command_line(int argc, char *argv[])
     hand.chunk_dim1               = 0; /* No chunking.  Contiguous is the default. */
     hand.chunk_dim2               = 0; /* No chunking.  Contiguous is the default. */
     hand.space_select             = 1; /* Other values are not supported           */
-
-    while ((opt = getopt_long(argc, argv, "c:d:ef:hklm:n:q:rs:t:", long_options, NULL)) != -1) {
+    hand.data_type                = DTYPE_INT;
+    hand.dtype_size               = sizeof(int);
+    hand.file_type                = DTYPE_INT;
+    hand.file_dtype_size          = sizeof(int);
+    hand.big_endian               = false;
+    hand.filters                  = 0; /* No filter                                */
+    hand.layout                   = LAYOUT_DEFAULT;
+    hand.sparse                   = false;
+
+    while ((opt = getopt_long(argc, argv, "c:d:ef:hklm:n:o:pq:rs:t:y:z:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'c':
                 /* The dimensions of the chunks */
@@ -151,6 +188,30 @@ parse_command_line(int argc, char *argv[])
                 else
                     printf("optarg is null\n");
                 break;
+            case 'o':
+                /* The storage layout of the datasets */
+                if (optarg) {
+                    for (i = 1; i < sizeof(layout_names) / sizeof(layout_names[0]); i++)
+                        if (!strcmp(optarg, layout_names[i]))
+                            break;
+
+                    if (i == sizeof(layout_names) / sizeof(layout_names[0])) {
+                        printf("Error: unknown layout %s\n", optarg);
+                        exit(1);
+                    }
+
+                    fprintf(stdout, "storage layout of the datasets:\t\t\t\t%s\n", optarg);
+                    hand.layout = (layout_type_t)i;
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'p':
+                /* Write only the first half of the rows, leaving the rest to the fill value */
+                fprintf(stdout, "write only the first half of the rows:\t\t\tTrue\n");
+                hand.sparse = true;
+
+                break;
             case 'q':
                 /* The number of data sections to break down a large dataset */
                 if (optarg) {
@@ -190,6 +251,70 @@ parse_command_line(int argc, char *argv[])
                 else
                     printf("optarg is null\n");
                 break;
+            case 'y':
+                /* The datatype of the data in the file, stored big-endian with the suffix "be",
+                 * then the one in memory if it's different (e.g. int16be:double) */
+                if (optarg) {
+                    char   *dtype_str, *file_str, *mem_str;
+                    size_t len;
+
+                    dtype_str = strdup(optarg);
+                    file_str  = strtok(dtype_str, ":");
+                    mem_str   = strtok(NULL, ":");
+
+                    if (!file_str) {
+                        printf("Error: unknown datatype %s\n", optarg);
+                        exit(1);
+                    }
+
+                    len = strlen(file_str);
+
+                    if (len > 2 && !strcmp(file_str + len - 2, "be")) {
+                        file_str[len - 2] = '\0';
+                        hand.big_endian   = true;
+                    }
+
+                    fprintf(stdout, "datatype of the data:\t\t\t\t\t%s\n", optarg);
+                    hand.file_type       = find_data_type(file_str, dtype_names, sizeof(dtype_names) / sizeof(dtype_names[0]));
+                    hand.file_dtype_size = dtype_sizes[hand.file_type];
+
+                    if (mem_str)
+                        hand.data_type = find_data_type(mem_str, dtype_names, sizeof(dtype_names) / sizeof(dtype_names[0]));
+                    else
+                        hand.data_type = hand.file_type;
+
+                    hand.dtype_size = dtype_sizes[hand.data_type];
+
+                    free(dtype_str);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
+            case 'z':
+                /* The filters of the chunks */
+                if (optarg) {
+                    char *filters_str, *filter_str;
+                    fprintf(stdout, "filters of the chunks:\t\t\t\t\t%s\n", optarg);
+                    filters_str = strdup(optarg);
+
+                    for (filter_str = strtok(filters_str, ","); filter_str; filter_str = strtok(NULL, ",")) {
+                        if (!strcmp(filter_str, "deflate"))
+                            hand.filters |= FILTER_DEFLATE;
+                        else if (!strcmp(filter_str, "shuffle"))
+                            hand.filters |= FILTER_SHUFFLE;
+                        else if (!strcmp(filter_str, "fletcher32"))
+                            hand.filters |= FILTER_FLETCHER32;
+                        else {
+                            printf("Error: unknown filter %s\n", filter_str);
+                            exit(1);
+                        }
+                    }
+
+                    free(filters_str);
+                }
+                else
+                    printf("optarg is null\n");
+                break;
             case ':':
                 printf("option needs a value\n");
                 break;
@@ -240,6 +365,31 @@ parse_command_line(int argc, char *argv[])
         printf("Error: Can't verify the correctness of the data if its values are random\n");
         exit(1);
     }
+
+    if (hand.filters && (hand.chunk_dim1 <= 0 || hand.chunk_dim2 <= 0)) {
+        printf("Error: Filters can only be applied to chunked datasets\n");
+        exit(1);
+    }
+
+    if (hand.layout != LAYOUT_DEFAULT && (hand.chunk_dim1 > 0 || hand.chunk_dim2 > 0)) {
+        printf("Error: Compact, external and virtual datasets can't be chunked\n");
+        exit(1);
+    }
+
+    if (hand.layout == LAYOUT_COMPACT && hand.dset_dim1 * hand.dset_dim2 * hand.file_dtype_size > COMPACT_MAX_BYTES) {
+        printf("Error: The data of compact datasets can't be bigger than %d bytes\n", COMPACT_MAX_BYTES);
+        exit(1);
+    }
+
+    if (hand.layout == LAYOUT_VIRTUAL && hand.dset_dim1 < 2) {
+        printf("Error: Virtual datasets need at least two rows, one for each source dataset\n");
+        exit(1);
+    }
+
+    if (hand.sparse && (hand.layout == LAYOUT_EXTERNAL || hand.layout == LAYOUT_VIRTUAL)) {
+        printf("Error: Only contiguous, chunked and compact datasets can be sparse\n");
+        exit(1);
+    }
 }
 
 /*------------------------------------------------------------
@@ -253,11 +403,11 @@ save_statistics(struct timeval begin, struct timeval end)
     double total_data = 0;
 
     if (hand.num_files == 1 && hand.num_dsets == 1)
-        total_data = hand.dset_dim1 * hand.dset_dim2 * sizeof(int) / MB;
+        total_data = hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size / MB;
     else if (hand.num_files == 1 && hand.num_dsets > 1) {
-        total_data = hand.num_dsets * hand.dset_dim1 * hand.dset_dim2 * sizeof(int) / MB;
+        total_data = hand.num_dsets * hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size / MB;
     } else if (hand.num_files > 1) {
-        total_data = (hand.num_files * hand.dset_dim1 * hand.dset_dim2 * sizeof(int)) / MB;
+        total_data = (hand.num_files * hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size) / MB;
     }
 
     statistics.data_amount = total_data;
@@ -279,16 +429,237 @@ report_statistics()
     printf("total data = %.2lfMB, time = %lfseconds, speed = %.2lfMB/second\n", statistics.data_amount, statistics.time, statistics.speed);
 }
 
+/*------------------------------------------------------------
+ * Store a value in the datatype of the data and return the
+ * position of the next element
+ *------------------------------------------------------------
+ */
+void *
+set_data_value(void *buf, long long value)
+{
+    switch (hand.data_type) {
+        case DTYPE_INT8:   *(int8_t *)buf   = (int8_t)value;   break;
+        case DTYPE_UINT8:  *(uint8_t *)buf  = (uint8_t)value;  break;
+        case DTYPE_INT16:  *(int16_t *)buf  = (int16_t)value;  break;
+        case DTYPE_UINT16: *(uint16_t *)buf = (uint16_t)value; break;
+        case DTYPE_UINT32: *(uint32_t *)buf = (uint32_t)value; break;
+        case DTYPE_INT64:  *(int64_t *)buf  = (int64_t)value;  break;
+        case DTYPE_UINT64: *(uint64_t *)buf = (uint64_t)value; break;
+        case DTYPE_FLOAT:  *(float *)buf    = (float)value;    break;
+        case DTYPE_DOUBLE: *(double *)buf   = (double)value;   break;
+        default:           *(int *)buf      = (int)value;      break;
+    }
+
+    return (char *)buf + hand.dtype_size;
+}
+
+/*------------------------------------------------------------
+ * Retrieve a value in the datatype of the data
+ *------------------------------------------------------------
+ */
+double
+get_data_value(const void *buf)
+{
+    switch (hand.data_type) {
+        case DTYPE_INT8:   return *(const int8_t *)buf;
+        case DTYPE_UINT8:  return *(const uint8_t *)buf;
+        case DTYPE_INT16:  return *(const int16_t *)buf;
+        case DTYPE_UINT16: return *(const uint16_t *)buf;
+        case DTYPE_UINT32: return *(const uint32_t *)buf;
+        case DTYPE_INT64:  return (double)*(const int64_t *)buf;
+        case DTYPE_UINT64: return (double)*(const uint64_t *)buf;
+        case DTYPE_FLOAT:  return *(const float *)buf;
+        case DTYPE_DOUBLE: return *(const double *)buf;
+        default:           return *(const int *)buf;
+    }
+}
+
+/*------------------------------------------------------------
+ * The number of rows to be written among nrows rows starting
+ * at first_row.  Only the first half of the rows of sparse
+ * datasets (--sparse) is written.
+ *------------------------------------------------------------
+ */
+long long
+sparse_row_count(long long first_row, long long nrows)
+{
+    long long written_rows = hand.sparse ? hand.dset_dim1 / 2 : hand.dset_dim1;
+
+    if (first_row >= written_rows)
+        return 0;
+
+    return MIN(nrows, written_rows - first_row);
+}
+
+/*------------------------------------------------------------
+ * Convert a value to a datatype of the data the way the HDF5
+ * library does: integers out of range are clamped.  The data
+ * checks pass the values through the datatype in the file and
+ * then the one in memory, when --dataType makes them differ.
+ *------------------------------------------------------------
+ */
+double
+convert_data_value(double value, data_type_t type)
+{
+    double low, high;
+
+    switch (type) {
+        case DTYPE_INT8:   low = INT8_MIN;  high = INT8_MAX;   break;
+        case DTYPE_UINT8:  low = 0;         high = UINT8_MAX;  break;
+        case DTYPE_INT16:  low = INT16_MIN; high = INT16_MAX;  break;
+        case DTYPE_UINT16: low = 0;         high = UINT16_MAX; break;
+        case DTYPE_UINT32: low = 0;         high = UINT32_MAX; break;
+        case DTYPE_INT64:  low = INT64_MIN; high = INT64_MAX;  break;
+        case DTYPE_UINT64: low = 0;         high = UINT64_MAX; break;
+        case DTYPE_FLOAT:  return (float)value;
+        case DTYPE_DOUBLE: return value;
+        default:           low = INT_MIN;   high = INT_MAX;    break;
+    }
+
+    if (value < low)
+        return low;
+
+    if (value > high)
+        return high;
+
+    return value;
+}
+
+#ifdef H5_VERS_MAJOR
+/*------------------------------------------------------------
+ * The HDF5 native datatype of a datatype of the data
+ *------------------------------------------------------------
+ */
+static hid_t
+get_native_dtype_of(data_type_t type)
+{
+    switch (type) {
+        case DTYPE_INT8:   return H5T_NATIVE_INT8;
+        case DTYPE_UINT8:  return H5T_NATIVE_UINT8;
+        case DTYPE_INT16:  return H5T_NATIVE_INT16;
+        case DTYPE_UINT16: return H5T_NATIVE_UINT16;
+        case DTYPE_UINT32: return H5T_NATIVE_UINT32;
+        case DTYPE_INT64:  return H5T_NATIVE_INT64;
+        case DTYPE_UINT64: return H5T_NATIVE_UINT64;
+        case DTYPE_FLOAT:  return H5T_NATIVE_FLOAT;
+        case DTYPE_DOUBLE: return H5T_NATIVE_DOUBLE;
+        default:           return H5T_NATIVE_INT;
+    }
+}
+
+/*------------------------------------------------------------
+ * The HDF5 memory datatype of the data
+ *------------------------------------------------------------
+ */
+hid_t
+get_native_dtype(void)
+{
+    return get_native_dtype_of(hand.data_type);
+}
+
+/*------------------------------------------------------------
+ * A copy of the HDF5 datatype of the data in the file, in the
+ * byte order from --dataType.  The caller closes it.
+ *------------------------------------------------------------
+ */
+hid_t
+create_file_dtype(void)
+{
+    hid_t datatype = H5Tcopy(get_native_dtype_of(hand.file_type));
+
+    if (datatype >= 0 && H5Tset_order(datatype, hand.big_endian ? H5T_ORDER_BE : H5T_ORDER_LE) < 0) {
+        printf("H5Tset_order failed at line %d\n", __LINE__);
+        H5Tclose(datatype);
+        return H5I_INVALID_HID;
+    }
+
+    return datatype;
+}
+
+/*------------------------------------------------------------
+ * Set the filters (--filters), the compact or external layout
+ * (--layout) and the fill value of sparse datasets (--sparse)
+ * in the creation property list of a dataset.  The external
+ * files are named after the file and the dataset, with the
+ * data split between them at an element boundary.
+ *------------------------------------------------------------
+ */
+int
+set_creation_properties(hid_t dcpl, const char *file_name, const char *dset_name)
+{
+    char      ext_name[1024];
+    long long fill_buf;
+    hsize_t   nbytes;
+
+    if (hand.filters & FILTER_SHUFFLE) {
+        if (H5Pset_shuffle(dcpl) < 0) {
+            printf("H5Pset_shuffle failed at line %d\n", __LINE__);
+            return -1;
+        }
+    }
+
+    if (hand.filters & FILTER_DEFLATE) {
+        if (H5Pset_deflate(dcpl, 6) < 0) {
+            printf("H5Pset_deflate failed at line %d\n", __LINE__);
+            return -1;
+        }
+    }
+
+    if (hand.filters & FILTER_FLETCHER32) {
+        if (H5Pset_fletcher32(dcpl) < 0) {
+            printf("H5Pset_fletcher32 failed at line %d\n", __LINE__);
+            return -1;
+        }
+    }
+
+    if (hand.layout == LAYOUT_COMPACT) {
+        if (H5Pset_layout(dcpl, H5D_COMPACT) < 0) {
+            printf("H5Pset_layout failed at line %d\n", __LINE__);
+            return -1;
+        }
+    } else if (hand.layout == LAYOUT_EXTERNAL) {
+        /* The first half of the elements goes to the first file, the rest to the second one */
+        nbytes = (hsize_t)(hand.dset_dim1 * hand.dset_dim2 / 2) * hand.file_dtype_size;
+
+        sprintf(ext_name, "%.*s_%s_1.ext", (int)strcspn(file_name, "."), file_name, dset_name);
+        if (H5Pset_external(dcpl, ext_name, 0, nbytes) < 0) {
+            printf("H5Pset_external failed at line %d\n", __LINE__);
+            return -1;
+        }
+
+        sprintf(ext_name, "%.*s_%s_2.ext", (int)strcspn(file_name, "."), file_name, dset_name);
+        if (H5Pset_external(dcpl, ext_name, 0, (hsize_t)(hand.dset_dim1 * hand.dset_dim2) * hand.file_dtype_size - nbytes) < 0) {
+            printf("H5Pset_external failed at line %d\n", __LINE__);
+            return -1;
+        }
+    }
+
+    if (hand.sparse) {
+        set_data_value(&fill_buf, SPARSE_FILL_VALUE);
+
+        if (H5Pset_fill_value(dcpl, get_native_dtype(), &fill_buf) < 0) {
+            printf("H5Pset_fill_value failed at line %d\n", __LINE__);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+#endif
+
 /*------------------------------------------------------------
  * Check the correctness of the data
  *------------------------------------------------------------
  */
 int
-check_data(int *data, int file_or_dset_index, int data_section)
+check_data(void *data, int file_or_dset_index, int data_section)
 {
-    int *p = data;
+    char *p = (char *)data;
+    long long expected_buf;
+    double expected_value;
     int original_value;
     int num_rows;
+    long long row;
     int nerrors = 0;
     int i, j;
 
@@ -306,12 +677,22 @@ check_data(int *data, int file_or_dset_index, int data_section)
              */
             original_value = i + j + data_section * 10 + file_or_dset_index * hand.dset_dim1 * hand.dset_dim2;
 
-            if (*p != original_value) {
-                printf("Data (section %d) error at index (%d, %d) in line %d: actual value is %d; expected value is %d\n", data_section, i, j, __LINE__, *p, original_value);
+            /* The rows of sparse datasets left unwritten have the fill value */
+            row = (data_in_section ? (long long)data_section * num_rows : 0) + i;
+
+            if (sparse_row_count(row, 1) == 0)
+                original_value = SPARSE_FILL_VALUE;
+
+            /* The value as it was stored in the datatype of the data, passed through the datatype in the file */
+            set_data_value(&expected_buf, original_value);
+            expected_value = convert_data_value(convert_data_value(get_data_value(&expected_buf), hand.file_type), hand.data_type);
+
+            if (get_data_value(p) != expected_value) {
+                printf("Data (section %d) error at index (%d, %d) in line %d: actual value is %g; expected value is %g\n", data_section, i, j, __LINE__, get_data_value(p), expected_value);
                 nerrors++;
             }
 
-            p++;
+            p += hand.dtype_size;
         }
     }
 
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include <assert.h>
 #include <getopt.h>
@@ -26,6 +27,36 @@
 #define MB                 (1024 * 1024)
 #define GB                 (1024 * 1024 * 1024)
 
+/* Datatypes of the benchmark data, chosen with the --dataType option */
+typedef enum {
+    DTYPE_INT = 0,      /* native int, the default */
+    DTYPE_INT8,
+    DTYPE_UINT8,
+    DTYPE_INT16,
+    DTYPE_UINT16,
+    DTYPE_UINT32,
+    DTYPE_INT64,
+    DTYPE_UINT64,
+    DTYPE_FLOAT,
+    DTYPE_DOUBLE
+} data_type_t;
+
+/* Storage layouts of the datasets other than contiguous or chunked (--dimsChunk), chosen with the --layout option */
+typedef enum {
+    LAYOUT_DEFAULT = 0, /* contiguous, or chunked with --dimsChunk */
+    LAYOUT_COMPACT,
+    LAYOUT_EXTERNAL,    /* contiguous data in two external files   */
+    LAYOUT_VIRTUAL      /* two source datasets, one half of the rows each */
+} layout_type_t;
+
+/* Filters of the chunks, chosen with the --filters option */
+#define FILTER_DEFLATE     0x01
+#define FILTER_SHUFFLE     0x02
+#define FILTER_FLETCHER32  0x04
+
+#define SPARSE_FILL_VALUE  (-1)    /* Fill value of the rows left unwritten with --sparse */
+#define COMPACT_MAX_BYTES  60000   /* Compact data must fit in the 64KB object header     */
+
 typedef struct {
     int   num_threads;
     int   num_files;
@@ -43,6 +74,14 @@ typedef struct {
     bool  plain_hdf5;
     bool  read_in_c;
     bool  multi_dsets;
+    data_type_t data_type;      /* Datatype in memory */
+    size_t dtype_size;
+    data_type_t file_type;      /* Datatype in the file, the same as in memory unless given with --dataType */
+    size_t file_dtype_size;
+    bool  big_endian;
+    unsigned filters;
+    layout_type_t layout;
+    bool  sparse;
 } handler_t;
 
 typedef struct {
@@ -73,6 +112,10 @@ bool data_in_section = false;
 void usage(void);
 void parse_command_line(int argc, char *argv[]);
 int read_data(int fd, int *buf, size_t size, off_t offset);
+void *set_data_value(void *buf, long long value);
+double get_data_value(const void *buf);
+double convert_data_value(double value, data_type_t type);
+long long sparse_row_count(long long first_row, long long nrows);
 int read_info_log_file(int *finfo_entry_num);
 void free_file_info_array();
 
@@ -13,13 +13,78 @@
  * Create the file for benchmarking the performance of data reading
  */
 #include "common.h"
-#include "common.c"
 #include "hdf5.h"
+#include "common.c"
 
 #define FILE_NAME   "mt_file"
 #define DATASETNAME "dset"
 #define RANK        2
 
+/*------------------------------------------------------------
+ * Create a virtual dataset (--layout=virtual) whose first and
+ * second halves of rows are mapped to two source datasets in
+ * the same file
+ *------------------------------------------------------------
+ */
+hid_t
+create_virtual_dset(hid_t file, const char *dset_name, hid_t datatype)
+{
+    char    src_name[1024];
+    hid_t   vspace, src_space, src_dset;
+    hid_t   dcpl;
+    hid_t   dataset = H5I_INVALID_HID;
+    hsize_t dims[2], src_dims[2], offset[2];
+    int     i;
+
+    dims[0] = hand.dset_dim1;
+    dims[1] = hand.dset_dim2;
+    vspace  = H5Screate_simple(RANK, dims, NULL);
+
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+
+    for (i = 0; i < 2; i++) {
+        /* Each source dataset holds one half of the rows */
+        offset[0]   = i * (hand.dset_dim1 / 2);
+        offset[1]   = 0;
+        src_dims[0] = (i == 0) ? hand.dset_dim1 / 2 : hand.dset_dim1 - hand.dset_dim1 / 2;
+        src_dims[1] = hand.dset_dim2;
+
+        sprintf(src_name, "%s_src%d", dset_name, i + 1);
+
+        src_space = H5Screate_simple(RANK, src_dims, NULL);
+        src_dset  = H5Dcreate2(file, src_name, datatype, src_space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+        if (src_dset < 0) {
+            printf("H5Dcreate2 failed at line %d\n", __LINE__);
+            H5Sclose(src_space);
+            goto done;
+        }
+
+        H5Dclose(src_dset);
+
+        /* Map the rows of the virtual dataset to the whole source dataset in the same file */
+        H5Sselect_hyperslab(vspace, H5S_SELECT_SET, offset, NULL, src_dims, NULL);
+
+        if (H5Pset_virtual(dcpl, vspace, ".", src_name, src_space) < 0) {
+            printf("H5Pset_virtual failed at line %d\n", __LINE__);
+            H5Sclose(src_space);
+            goto done;
+        }
+
+        H5Sclose(src_space);
+    }
+
+    H5Sselect_all(vspace);
+
+    dataset = H5Dcreate2(file, dset_name, datatype, vspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+done:
+    H5Sclose(vspace);
+    H5Pclose(dcpl);
+
+    return dataset;
+}
+
 /*------------------------------------------------------------
  * Create HDF5 file(s) for the test
  *------------------------------------------------------------
@@ -34,8 +99,9 @@ int create_files()
     hsize_t dimsm[2];
     hsize_t dimsf[2];            /* dataset dimensions */
     hsize_t chunk_dims[2];       /* chunk dimensions */
-    hid_t   dcpl;
+    hid_t   dcpl, dset_dcpl;
     hsize_t count[2], offset[2];
+    hsize_t moffset[2] = {0, 0};
     time_t  t;
     herr_t  status;
     int     *data, *p;
@@ -54,7 +120,7 @@ int create_files()
 
 	memspace = H5Screate_simple(RANK, dimsm, NULL);
 
-        data = (int *)malloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2 * sizeof(int)); /* output buffer */
+        data = (int *)malloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2 * hand.dtype_size); /* output buffer */
     } else {
 	/* Define the memory dataspace */
 	dimsm[0] = hand.dset_dim1;
@@ -62,7 +128,7 @@ int create_files()
 
 	memspace = H5Screate_simple(RANK, dimsm, NULL);
 
-        data = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * sizeof(int)); /* output buffer */
+        data = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size); /* output buffer */
     }
 
     dcpl = H5Pcreate(H5P_DATASET_CREATE);
@@ -80,9 +146,8 @@ int create_files()
     dimsf[1]  = hand.dset_dim2;
     dataspace = H5Screate_simple(RANK, dimsf, NULL);
 
-    /* Define datatype for the data in the file */
-    datatype = H5Tcopy(H5T_NATIVE_INT);
-    status   = H5Tset_order(datatype, H5T_ORDER_LE);
+    /* Define datatype for the data in the file, which may differ from the one in memory */
+    datatype = create_file_dtype();
 
     for (k = 0; k < hand.num_files; k++) {
         /* Create a new file using H5F_ACC_TRUNC access */
@@ -106,8 +171,24 @@ int create_files()
             } else
                 sprintf(dset_name, "%s%d", DATASETNAME, n + 1);
 
-            /* Create a new dataset */
-            dataset = H5Dcreate2(file, dset_name, datatype, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+            /* Create a new dataset with the filters, layout and fill value from the command line */
+            if (hand.layout == LAYOUT_VIRTUAL)
+                dataset = create_virtual_dset(file, dset_name, datatype);
+            else {
+                dset_dcpl = H5Pcopy(dcpl);
+
+                if (set_creation_properties(dset_dcpl, file_name, dset_name) < 0)
+                    goto error;
+
+                dataset = H5Dcreate2(file, dset_name, datatype, dataspace, H5P_DEFAULT, dset_dcpl, H5P_DEFAULT);
+
+                H5Pclose(dset_dcpl);
+            }
+
+            if (dataset < 0) {
+                printf("H5Dcreate2 failed at line %d\n", __LINE__);
+                goto error;
+            }
 
             /* 
              * dset1        dset2
@@ -135,11 +216,16 @@ int create_files()
 		     */
 		    offset[0] = m * (hand.dset_dim1 / hand.num_data_sections);
 		    offset[1] = 0;
-		    count[0]  = hand.dset_dim1 / hand.num_data_sections;
+		    count[0]  = sparse_row_count(offset[0], hand.dset_dim1 / hand.num_data_sections);
 		    count[1]  = hand.dset_dim2;
 
+                    /* Sections past the first half of the rows of sparse datasets are left unwritten */
+                    if (count[0] == 0)
+                        continue;
+
                     status = H5Sselect_none(dataspace);
 		    status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offset, NULL, count, NULL);
+		    status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, moffset, NULL, count, NULL);
 
                     /* Data buffer initialization */
                     p = data;
@@ -147,11 +233,11 @@ int create_files()
 		    for (j = 0; j < hand.dset_dim1 / hand.num_data_sections; j++)
 			for (i = 0; i < hand.dset_dim2; i++)
 			    if (hand.random_data)
-				*p++ = i + j + rand() % 50;
+				p = set_data_value(p, i + j + rand() % 50);
 			    else
-				*p++ = i + j + m * 10 + k * hand.dset_dim1 * hand.dset_dim2 + n * hand.dset_dim1 * hand.dset_dim2;
+				p = set_data_value(p, i + j + m * 10 + k * hand.dset_dim1 * hand.dset_dim2 + n * hand.dset_dim1 * hand.dset_dim2);
 
-                    status = H5Dwrite(dataset, H5T_NATIVE_INT, memspace, dataspace, H5P_DEFAULT, data);
+                    status = H5Dwrite(dataset, get_native_dtype(), memspace, dataspace, H5P_DEFAULT, data);
                 }
             } else {
 		/* Data buffer initialization */
@@ -160,11 +246,21 @@ int create_files()
 		for (j = 0; j < hand.dset_dim1; j++)
 		    for (i = 0; i < hand.dset_dim2; i++)
 			if (hand.random_data)
-			    *p++ = i + j + rand() % 50;
+			    p = set_data_value(p, i + j + rand() % 50);
 			else
-			    *p++ = i + j + k * hand.dset_dim1 * hand.dset_dim2 + n * hand.dset_dim1 * hand.dset_dim2;
+			    p = set_data_value(p, i + j + k * hand.dset_dim1 * hand.dset_dim2 + n * hand.dset_dim1 * hand.dset_dim2);
+
+                if (hand.sparse) {
+                    /* Only write the first half of the rows of sparse datasets */
+                    count[0] = sparse_row_count(0, hand.dset_dim1);
+                    count[1] = hand.dset_dim2;
+
+                    status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, moffset, NULL, count, NULL);
+                    status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, moffset, NULL, count, NULL);
 
-                status = H5Dwrite(dataset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+                    status = H5Dwrite(dataset, get_native_dtype(), memspace, dataspace, H5P_DEFAULT, data);
+                } else
+                    status = H5Dwrite(dataset, get_native_dtype(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
             }
 
             H5Dclose(dataset);
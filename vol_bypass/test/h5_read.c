@@ -13,8 +13,8 @@
  *   Benchmark the performance of reading data
  */
 #include "common.h"
-#include "common.c"
 #include "hdf5.h"
+#include "common.c"
 
 #define FILE_NAME   "mt_file"
 #define DATASETNAME "dset"
@@ -116,7 +116,7 @@ void* read_partial_dset_with_hdf5(void* arg)
 	    status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, moffset, NULL, mcount, NULL);
 
 	    /* Read data from hyperslab in the file into the memory. */
-	    status = H5Dread(dataset, H5T_NATIVE_INT, memspace, dataspace, H5P_DEFAULT, data);
+	    status = H5Dread(dataset, get_native_dtype(), memspace, dataspace, H5P_DEFAULT, data);
 
 	    if (status < 0)
 		printf("H5Dread failed\n");
@@ -137,7 +137,7 @@ void* read_partial_dset_with_hdf5(void* arg)
 	    status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, offset, NULL, count, NULL);
 
 	    /* Read data from hyperslab in the file into the hyperslab in memory. */
-	    status = H5Dread(dataset, H5T_NATIVE_INT, memspace, dataspace, H5P_DEFAULT, data);
+	    status = H5Dread(dataset, get_native_dtype(), memspace, dataspace, H5P_DEFAULT, data);
 
 	    if (status < 0)
 		printf("H5Dread failed\n");
@@ -184,7 +184,7 @@ void* read_multiple_dsets_with_hdf5(void* arg)
         num_dsets_local = hand.num_dsets; 
 
 
-    data = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * sizeof(int)); /* output buffer */
+    data = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size); /* output buffer */
 
     if (!data)
         printf("data buffer is NULL\n");
@@ -218,7 +218,7 @@ void* read_multiple_dsets_with_hdf5(void* arg)
         H5Sselect_hyperslab(memspace, H5S_SELECT_SET, offset, NULL, count, NULL);
 
         /* Read data */
-        H5Dread(dataset, H5T_NATIVE_INT, memspace, dataspace, H5P_DEFAULT, data);
+        H5Dread(dataset, get_native_dtype(), memspace, dataspace, H5P_DEFAULT, data);
 
         /* Close/release resources */
         H5Sclose(dataspace);
@@ -282,7 +282,7 @@ void* read_multiple_dsets_with_hdf5_tmp(void* arg)
         num_dsets_local = hand.num_dsets; 
 
 
-    data = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * sizeof(int)); /* output buffer */
+    data = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size); /* output buffer */
 
     if (!data)
         printf("data buffer is NULL\n");
@@ -291,7 +291,7 @@ void* read_multiple_dsets_with_hdf5_tmp(void* arg)
         //printf("thread_id=%d. dset_id_list[%d]=%ld\n", thread_id, k, dset_id_list[k]);
 
 	/* Read data */
-        H5Dread(dset_id_list[k], H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+        H5Dread(dset_id_list[k], get_native_dtype(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
 
         /* Data verification if enabled */
         if (hand.check_data && !hand.random_data) {
@@ -336,7 +336,7 @@ void* read_multiple_dsets_with_hdf5_multi(void* arg)
     int nerrors = 0;
     int i, j, k;
 
-    data = (void *)malloc(hand.num_dsets * hand.dset_dim1 * hand.dset_dim2 * sizeof(int)); /* output buffer */
+    data = (void *)malloc(hand.num_dsets * hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size); /* output buffer */
     
     if (!data)
         printf("data buffer is NULL\n");
@@ -344,7 +344,7 @@ void* read_multiple_dsets_with_hdf5_multi(void* arg)
     rbufs = (void **)malloc(sizeof(void *) * hand.num_dsets);
 
     for (i = 0; i < hand.num_dsets; i++)
-        rbufs[i] = data + i * hand.dset_dim1 * hand.dset_dim2 * sizeof(int);
+        rbufs[i] = data + i * hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size;
 
     dset_ids       = (hid_t *)malloc(hand.num_dsets * sizeof(hid_t));
     dataspace_ids  = (hid_t *)malloc(hand.num_dsets * sizeof(hid_t));
@@ -357,7 +357,7 @@ void* read_multiple_dsets_with_hdf5_multi(void* arg)
         /* Open the dataset */
         dset_ids[i] = H5Dopen2(file, dset_name, H5P_DEFAULT);
 
-        mem_dtype_ids[i] = H5T_NATIVE_INT;
+        mem_dtype_ids[i] = get_native_dtype();
 
         dataspace_ids[i] = H5S_ALL;
         memspace_ids[i] = H5S_ALL;
@@ -416,14 +416,14 @@ void* read_multiple_files_with_hdf5_tmp(void* arg)
     else
         num_files_local = hand.num_files; 
 
-    data      = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * sizeof(int)); /* output buffer */
+    data      = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size); /* output buffer */
 
     if (!data)
         printf("data_out is NULL\n");
 
     for (i = 0; i < num_files_local; i++) {
         /* Read data */
-        H5Dread(dset_id_list[i], H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+        H5Dread(dset_id_list[i], get_native_dtype(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
 
         /* Data verification if enabled */
         if (hand.check_data && !hand.random_data) {
@@ -467,7 +467,7 @@ void* read_multiple_files_with_hdf5(void* arg)
     else
         num_files_local = hand.num_files; 
 
-    data      = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * sizeof(int)); /* output buffer */
+    data      = (int *)malloc(hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size); /* output buffer */
     file      = (hid_t *)malloc(num_files_local * sizeof(hid_t));
     dataset   = (hid_t *)malloc(num_files_local * sizeof(hid_t));
     dataspace = (hid_t *)malloc(num_files_local * sizeof(hid_t));
@@ -489,7 +489,7 @@ void* read_multiple_files_with_hdf5(void* arg)
 	    sprintf(dset_name, "%s%d", DATASETNAME, i + 1);
         }
 
-        memset(data, 0, (hand.dset_dim1 * hand.dset_dim2 * sizeof(int)));
+        memset(data, 0, (hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size));
 
         /* Open the file and the dataset */
         file[i]    = H5Fopen(file_name, H5F_ACC_RDONLY, H5P_DEFAULT);
@@ -516,7 +516,7 @@ void* read_multiple_files_with_hdf5(void* arg)
 
     for (i = 0; i < num_files_local; i++) {
         /* Read data */
-        H5Dread(dataset[i], H5T_NATIVE_INT, memspace[i], dataspace[i], H5P_DEFAULT, data);
+        H5Dread(dataset[i], get_native_dtype(), memspace[i], dataspace[i], H5P_DEFAULT, data);
 
         /* Data verification if enabled */
         if (hand.check_data && !hand.random_data) {
@@ -583,7 +583,7 @@ void* read_multiple_files_with_hdf5_multi(void* arg)
     else
         num_files_local = hand.num_files; 
 
-    data      = (void *)malloc(num_files_local * hand.dset_dim1 * hand.dset_dim2 * sizeof(int)); /* output buffer */
+    data      = (void *)malloc(num_files_local * hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size); /* output buffer */
 
     if (!data)
         printf("data is NULL\n");
@@ -591,7 +591,7 @@ void* read_multiple_files_with_hdf5_multi(void* arg)
     rbufs = (void **)malloc(sizeof(void *) * num_files_local);
 
     for (i = 0; i < num_files_local; i++)
-        rbufs[i] = data + i * hand.dset_dim1 * hand.dset_dim2 * sizeof(int);
+        rbufs[i] = data + i * hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size;
 
     file      = (hid_t *)malloc(num_files_local * sizeof(hid_t));
     dataset   = (hid_t *)malloc(num_files_local * sizeof(hid_t));
@@ -617,7 +617,7 @@ void* read_multiple_files_with_hdf5_multi(void* arg)
 
         dataset[i] = H5Dopen2(file[i], dset_name, H5P_DEFAULT);
 
-        mem_dtype_ids[i] = H5T_NATIVE_INT;
+        mem_dtype_ids[i] = get_native_dtype();
 
         dataspace[i] = H5Dget_space(dataset[i]); /* dataspace handle */
 
@@ -745,7 +745,7 @@ launch_single_file_single_dset_read(void)
             /* Set this global flag, mainly for check_data() */
 	    data_in_section = true;
 
-	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
@@ -774,7 +774,7 @@ launch_single_file_single_dset_read(void)
 	    /* Stop time */
 	    gettimeofday(&end, 0);
         } else {
-	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
@@ -809,7 +809,7 @@ launch_single_file_single_dset_read(void)
             /* Set this global flag, mainly for check_data() */
 	    data_in_section = true;
 
-	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
@@ -846,7 +846,7 @@ launch_single_file_single_dset_read(void)
             /* Stop time */
 	    gettimeofday(&end, 0);
         } else {
-	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
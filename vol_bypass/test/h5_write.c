@@ -13,8 +13,8 @@
  * Benchmark the performance of data writing
  */
 #include "common.h"
-#include "common.c"
 #include "hdf5.h"
+#include "common.c"
 
 #define FILE_NAME   "test_write_file"
 #define DATASETNAME "dset"
@@ -94,21 +94,24 @@ void* write_partial_dset_with_hdf5(void* arg)
 		count[0]  = hand.dset_dim1 / (hand.num_data_sections * hand.num_threads);
 	    }
 
+	    /* Only the first half of the rows of sparse datasets is written */
+	    count[0]  = sparse_row_count(offset[0], count[0]);
 	    offset[1] = 0;
 	    count[1]  = hand.dset_dim2;
 
+	    if (count[0] == 0)
+		goto done;
+
 	    status = H5Sselect_none(dataspace);
 	    status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offset, NULL, count, NULL);
 
-	    /* Selection in memory */
-	    if (hand.num_threads == 0) {
+	    /* Selection in memory, the same rows as in the file */
+	    if (hand.num_threads == 0)
 		moffset[0] = 0;
-		mcount[0]  = hand.dset_dim1 / hand.num_data_sections;
-	    } else {
+	    else
 		moffset[0] = thread_id * (hand.dset_dim1 / (hand.num_data_sections * hand.num_threads));
-		mcount[0]  = hand.dset_dim1 / (hand.num_data_sections * hand.num_threads);
-	    }
 
+	    mcount[0]  = count[0];
 	    moffset[1] = 0;
 	    mcount[1]  = hand.dset_dim2;
 
@@ -116,7 +119,7 @@ void* write_partial_dset_with_hdf5(void* arg)
 	    status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, moffset, NULL, mcount, NULL);
 
 	    /* Read data from hyperslab in the file into the memory. */
-	    status = H5Dwrite(dataset, H5T_NATIVE_INT, memspace, dataspace, H5P_DEFAULT, data);
+	    status = H5Dwrite(dataset, get_native_dtype(), memspace, dataspace, H5P_DEFAULT, data);
 
 	    if (status < 0)
 		printf("H5Dwrite failed\n");
@@ -129,21 +132,27 @@ void* write_partial_dset_with_hdf5(void* arg)
 	        count[0]  = hand.dset_dim1 / hand.num_threads;
             }
 
+	    /* Only the first half of the rows of sparse datasets is written */
+	    count[0]  = sparse_row_count(offset[0], count[0]);
 	    offset[1] = 0;
 	    count[1]  = hand.dset_dim2;
 
+	    if (count[0] == 0)
+		goto done;
+
 //printf("In %s, thread_id=%d: offset[0]=%d, offset[1]=%d, count[0]=%d, count[1]=%d\n", __func__, thread_id, offset[0], offset[1], count[0], count[1]);
 	    status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offset, NULL, count, NULL);
 	    status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, offset, NULL, count, NULL);
 
 	    /* Read data from hyperslab in the file into the hyperslab in memory. */
-	    status = H5Dwrite(dataset, H5T_NATIVE_INT, memspace, dataspace, H5P_DEFAULT, data);
+	    status = H5Dwrite(dataset, get_native_dtype(), memspace, dataspace, H5P_DEFAULT, data);
 
 	    if (status < 0)
 		printf("H5Dwrite failed\n");
         }
     }
 
+done:
     H5Sclose(memspace);
     H5Sclose(dataspace);
 
@@ -153,6 +162,66 @@ void* write_partial_dset_with_hdf5(void* arg)
     return NULL;
 } /* write_partial_dset_with_hdf5 */
 
+/*------------------------------------------------------------
+ * Read the whole dataset back and check the values written by
+ * write_partial_dset_with_hdf5: i + j at row i (counted from
+ * the start of its section) and column j, or the fill value in
+ * the rows of sparse datasets left unwritten
+ *------------------------------------------------------------
+ */
+int
+check_written_data(hid_t dataset)
+{
+    char      *data, *p;
+    long long expected_buf;
+    double    expected_value;
+    long long num_rows;
+    long long i, j;
+    int       nerrors = 0;
+
+    if (data_in_section)
+        num_rows = hand.dset_dim1 / hand.num_data_sections;
+    else
+        num_rows = hand.dset_dim1;
+
+    data = (char *)malloc(hand.dset_dim1 * hand.dset_dim2 * hand.dtype_size);
+
+    if (!data) {
+        printf("data is NULL\n");
+        return -1;
+    }
+
+    if (H5Dread(dataset, get_native_dtype(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data) < 0) {
+        printf("H5Dread failed at line %d\n", __LINE__);
+        free(data);
+        return -1;
+    }
+
+    p = data;
+
+    for (i = 0; i < hand.dset_dim1; i++) {
+        for (j = 0; j < hand.dset_dim2; j++) {
+            if (sparse_row_count(i, 1) == 0)
+                set_data_value(&expected_buf, SPARSE_FILL_VALUE);
+            else
+                set_data_value(&expected_buf, i % num_rows + j);
+
+            expected_value = convert_data_value(convert_data_value(get_data_value(&expected_buf), hand.file_type), hand.data_type);
+
+            if (get_data_value(p) != expected_value) {
+                printf("Data error at index (%lld, %lld) in line %d: actual value is %g; expected value is %g\n", i, j, __LINE__, get_data_value(p), expected_value);
+                nerrors++;
+            }
+
+            p += hand.dtype_size;
+        }
+    }
+
+    free(data);
+
+    return nerrors;
+} /* check_written_data */
+
 /*------------------------------------------------------------
  * Start to test the case of a single dataset in a single file
  * with multi-thread with HDF5
@@ -215,7 +284,17 @@ launch_single_file_single_dset_write(void)
         H5Pset_chunk(dcpl, RANK, chunk_dims); 
     }
 
-    /* Bypass VOL only handles early allocation */
+    /* The filters, layout and fill value from the command line */
+    if (set_creation_properties(dcpl, FILE_NAME, DATASETNAME) < 0)
+        goto error;
+
+    /* Allocate the storage up front, so the timed writes don't allocate chunks.  The storage
+     * of sparse datasets is allocated as it is written, so the chunks left out are never
+     * allocated and read as the fill value.  Compact datasets are always allocated early.
+     */
+    if (hand.sparse && hand.layout != LAYOUT_COMPACT)
+        alloc_time = H5D_ALLOC_TIME_DEFAULT;
+
     if (H5Pset_alloc_time(dcpl, alloc_time) < 0) {
         printf("H5Pset_alloc_time failed at line %d\n", __LINE__);
         goto error;
@@ -226,9 +305,8 @@ launch_single_file_single_dset_write(void)
     dimsf[1]  = hand.dset_dim2;
     dataspace = H5Screate_simple(RANK, dimsf, NULL);
 
-    /* Define datatype for the data in the file */
-    datatype = H5Tcopy(H5T_NATIVE_INT);
-    status   = H5Tset_order(datatype, H5T_ORDER_LE);
+    /* Define datatype for the data in the file, which may differ from the one in memory */
+    datatype = create_file_dtype();
 
     /* Create the file */
     sprintf(file_name, "%s.h5", FILE_NAME);
@@ -240,6 +318,11 @@ launch_single_file_single_dset_write(void)
 
     dataset = H5Dcreate2(file, dset_name, datatype, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
 
+    if (dataset < 0) {
+        printf("H5Dcreate2 failed at line %d\n", __LINE__);
+        goto error;
+    }
+
     if (hand.num_threads == 0) {
         args_t info;
 
@@ -248,7 +331,7 @@ launch_single_file_single_dset_write(void)
             /* Set this global flag, mainly for check_data() */
 	    data_in_section = true;
 
-	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
@@ -261,9 +344,9 @@ launch_single_file_single_dset_write(void)
 	    for (j = 0; j < hand.dset_dim1 / hand.num_data_sections; j++) {
 		for (i = 0; i < hand.dset_dim2; i++) {
 		    if (hand.random_data)
-			*p++ = i + j + rand() % 50;
+			p = set_data_value(p, i + j + rand() % 50);
 		    else
-			*p++ = i + j;
+			p = set_data_value(p, i + j);
                 }
             }
 
@@ -282,7 +365,7 @@ launch_single_file_single_dset_write(void)
             /* Stop the time */
             gettimeofday(&end, 0);
         } else {
-	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
@@ -295,9 +378,9 @@ launch_single_file_single_dset_write(void)
 	    for (j = 0; j < hand.dset_dim1; j++) {
 		for (i = 0; i < hand.dset_dim2; i++) {
 		    if (hand.random_data)
-			*p++ = i + j + rand() % 50;
+			p = set_data_value(p, i + j + rand() % 50);
 		    else
-			*p++ = i + j;
+			p = set_data_value(p, i + j);
                 }
             }
 
@@ -322,7 +405,7 @@ launch_single_file_single_dset_write(void)
             /* Set this global flag, mainly for check_data() */
 	    data_in_section = true;
 
-	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc((hand.dset_dim1 / hand.num_data_sections) * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
@@ -335,9 +418,9 @@ launch_single_file_single_dset_write(void)
 	    for (j = 0; j < hand.dset_dim1 / hand.num_data_sections; j++) {
 		for (i = 0; i < hand.dset_dim2; i++) {
 		    if (hand.random_data)
-			*p++ = i + j + rand() % 50;
+			p = set_data_value(p, i + j + rand() % 50);
 		    else
-			*p++ = i + j;
+			p = set_data_value(p, i + j);
                 }
             }
 
@@ -364,7 +447,7 @@ launch_single_file_single_dset_write(void)
             /* Stop the time */
             gettimeofday(&end, 0);
         } else {
-	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, sizeof(int)); /* output buffer */
+	    data_out = (int *)calloc(hand.dset_dim1 * hand.dset_dim2, hand.dtype_size); /* output buffer */
 
 	    if (!data_out) {
 		printf("data_out is NULL\n");
@@ -377,9 +460,9 @@ launch_single_file_single_dset_write(void)
 	    for (j = 0; j < hand.dset_dim1; j++) {
 		for (i = 0; i < hand.dset_dim2; i++) {
 		    if (hand.random_data)
-			*p++ = i + j + rand() % 50;
+			p = set_data_value(p, i + j + rand() % 50);
 		    else
-			*p++ = i + j;
+			p = set_data_value(p, i + j);
                 }
             }
 
@@ -407,6 +490,13 @@ launch_single_file_single_dset_write(void)
     /* Calculate and print the performance data */
     save_statistics(begin, end);
 
+    /* Data verification if enabled.  Do not enable this option (-k) for performance study */
+    if (hand.check_data && !hand.random_data)
+        nerrors = check_written_data(dataset);
+
+    if (nerrors > 0)
+        printf("%d errors during data verification at line %d in the function %s\n", nerrors, __LINE__, __func__);
+
     /* Close/release resources */
     H5Sclose(dataspace);
     H5Tclose(datatype);
@@ -430,6 +520,12 @@ int main(int argc, char **argv)
 
     parse_command_line(argc, argv);
 
+    /* The source datasets of virtual datasets are only created by h5_create */
+    if (hand.layout == LAYOUT_VIRTUAL) {
+        printf("Error: h5_write doesn't create virtual datasets\n");
+        exit(1);
+    }
+
     if (hand.num_files == 1 && hand.num_dsets == 1)
         launch_single_file_single_dset_write();
     else if (hand.num_files == 1 && hand.num_dsets > 1)
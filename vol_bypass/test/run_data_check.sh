@@ -0,0 +1,96 @@
+#! /bin/sh
+
+# Check the data read and written with Bypass VOL for the datasets it handles besides plain contiguous and
+# chunked ones.  Each dataset is created with h5_create, then read back with h5_read and checked (-k).
+# Some of them are also written with h5_write and read back to be checked.  Any error is printed by the
+# test programs.
+#     NTHREADS_FOR_MULTI: number of threads for the multi-threaded application
+#     NTHREADS_FOR_TPOOL: number of threads for the thread pool
+#     NDATA_SECTIONS:     number of dataset sections to break down the datasets by rows
+#     DIM1:               dataset dimension one
+#     DIM2:               dataset dimension two
+#     CHUNK_DIM1:         chunk dimension one
+#     CHUNK_DIM2:         chunk dimension two
+NTHREADS_FOR_MULTI=4
+NTHREADS_FOR_TPOOL=4
+NDATA_SECTIONS=4
+
+# Dataset size = 16KB
+DIM1=64
+DIM2=64
+CHUNK_DIM1=16
+CHUNK_DIM2=16
+
+# Set the environment variables to use Bypass VOL. Need to modify them with your own paths
+export HDF5_PLUGIN_PATH=/Users/raylu/Lifeboat/HDF/Matt/MT-HDF5_no_tpool/vol_bypass
+export HDF5_VOL_CONNECTOR="bypass under_vol=0;under_info={};"
+export DYLD_LIBRARY_PATH=$DYLD_LIBRARY_PATH:/Users/raylu/Lifeboat/HDF/Jordan/build/hdf5/lib:$HDF5_PLUGIN_PATH
+
+export BYPASS_VOL_NTHREADS=${NTHREADS_FOR_TPOOL}
+
+# The options of each case shape the dataset, and are the same for h5_create, h5_read and h5_write
+check_read()
+{
+    echo ""
+    echo ""
+    echo "Checking a dataset created with the options: $*"
+    ./h5_create -d ${DIM1}x${DIM2} -q ${NDATA_SECTIONS} "$@"
+    ./h5_read -t 0 -d ${DIM1}x${DIM2} -q ${NDATA_SECTIONS} -k "$@"
+    ./h5_read -t ${NTHREADS_FOR_MULTI} -d ${DIM1}x${DIM2} -q ${NDATA_SECTIONS} -k "$@"
+}
+
+check_write()
+{
+    echo ""
+    echo ""
+    echo "Checking a dataset written with the options: $*"
+    ./h5_write -t 0 -d ${DIM1}x${DIM2} -q ${NDATA_SECTIONS} -k "$@"
+    ./h5_write -t ${NTHREADS_FOR_MULTI} -d ${DIM1}x${DIM2} -k "$@"
+}
+
+echo "Test 1: Filtered chunks"
+check_read -c ${CHUNK_DIM1}x${CHUNK_DIM2} -z deflate
+check_read -c ${CHUNK_DIM1}x${CHUNK_DIM2} -z shuffle,deflate,fletcher32 -y int16
+check_write -c ${CHUNK_DIM1}x${CHUNK_DIM2} -z shuffle,deflate,fletcher32
+
+echo ""
+echo ""
+echo "Test 2: Sparse datasets (the rows left unwritten read as the fill value)"
+check_read -p
+check_read -p -c ${CHUNK_DIM1}x${CHUNK_DIM2}
+check_write -p -c ${CHUNK_DIM1}x${CHUNK_DIM2}
+
+echo ""
+echo ""
+echo "Test 3: Compact datasets (no bigger than 60000 bytes)"
+check_read -o compact
+check_read -o compact -p
+check_write -o compact
+
+echo ""
+echo ""
+echo "Test 4: Datasets stored in two external files"
+check_read -o external
+check_write -o external
+
+echo ""
+echo ""
+echo "Test 5: Virtual datasets with two source datasets in the same file"
+check_read -o virtual
+
+echo ""
+echo ""
+echo "Test 6: Data stored big-endian in the file (bytes swapped by the thread pool)"
+check_read -y int16be
+check_read -y doublebe -c ${CHUNK_DIM1}x${CHUNK_DIM2}
+check_read -y uint32be -c ${CHUNK_DIM1}x${CHUNK_DIM2} -z shuffle,deflate
+check_write -y int64be
+
+echo ""
+echo ""
+echo "Test 7: Data converted between the datatype in the file and the one in memory by the thread pool"
+check_read -y int16:float
+check_read -y double:float -c ${CHUNK_DIM1}x${CHUNK_DIM2}
+check_read -y uint8:int64
+check_read -y int16be:double -c ${CHUNK_DIM1}x${CHUNK_DIM2}
+check_write -y float:int